@@ -96,6 +96,17 @@ set(TEST_AVX512 [[
     return d[0]==0;
   }]])
 
+set(TEST_VAES [[
+  #include <immintrin.h>
+  int main(){
+    alignas(64) int d[16] = {1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16};
+    volatile int u = d[0];
+    __m512i X = _mm512_loadu_si512((const void*)d);
+    __m512i Y = _mm512_aesenc_epi128(X, _mm512_set1_epi32(u));
+    _mm512_storeu_si512((void*)d, Y);
+    return d[0]==0;
+  }]])
+
   set(TEST_BMI2 [[
       #include <immintrin.h> 
       #include <cstdlib>
@@ -111,6 +122,7 @@ if (MSVC)
   set(FLAG_AVX    "/arch:AVX")
   set(FLAG_AVX2   "/arch:AVX2")
   set(FLAG_AVX512 "/arch:AVX512")
+  set(FLAG_VAES   "/arch:AVX512")
   set(FLAG_BMI2    "/arch:AVX2") # no /arch flag for BMI2
 else()
   # clang/gcc (helps when using clang-cl or mingw)
@@ -118,6 +130,7 @@ else()
   set(FLAG_AVX    "-mavx")
   set(FLAG_AVX2   "-mavx2")
   set(FLAG_AVX512 "-mavx512f")
+  set(FLAG_VAES   "-mavx512f -mvaes")
   set(FLAG_BMI2   "-mbmi2")
 endif()
 
@@ -125,6 +138,7 @@ check_isa_runs("SSE2"   "${FLAG_SSE2}"   "${TEST_SSE2}"   SSE2_RUNS)
 check_isa_runs("AVX"    "${FLAG_AVX}"    "${TEST_AVX}"    AVX_RUNS)
 check_isa_runs("AVX2"   "${FLAG_AVX2}"   "${TEST_AVX2}"   AVX2_RUNS)
 check_isa_runs("AVX512" "${FLAG_AVX512}" "${TEST_AVX512}" AVX512_RUNS)
+check_isa_runs("VAES"   "${FLAG_VAES}"   "${TEST_VAES}"   VAES_RUNS)
 check_isa_runs("BMI2"   "${FLAG_BMI2}"   "${TEST_BMI2}"   BMI2_RUNS)
 
 
@@ -133,4 +147,5 @@ set(ENABLE_SSE_DEFAULT   ${SSE2_RUNS}   CACHE BOOL "Enable SSE2 codepaths by def
 set(ENABLE_AVX_DEFAULT    ${AVX_RUNS}    CACHE BOOL "Enable AVX codepaths by default")
 set(ENABLE_AVX2_DEFAULT   ${AVX2_RUNS}   CACHE BOOL "Enable AVX2 codepaths by default")
 set(ENABLE_AVX512_DEFAULT ${AVX512_RUNS} CACHE BOOL "Enable AVX-512 codepaths by default")
+set(ENABLE_VAES_DEFAULT   ${VAES_RUNS}   CACHE BOOL "Enable VAES codepaths by default")
 set(ENABLE_BMI2_DEFAULT ${AVX512_RUNS} CACHE BOOL "Enable AVX-512 codepaths by default")
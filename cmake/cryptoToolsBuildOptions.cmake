@@ -27,10 +27,13 @@ if(CMAKE_SYSTEM_PROCESSOR MATCHES "arm")
 	set(ENABLE_AVX_DEFAULT false)
 	set(ENABLE_AVX2_DEFAULT false)
 	set(ENABLE_AVX512_DEFAULT false)
+	set(ENABLE_VAES_DEFAULT false)
+	set(ENABLE_CPU_DISPATCH_DEFAULT false)
 else()
     # Code for other architectures
     message(STATUS "Building for x86-64")
 	set(ENABLE_ARM_AES_DEFAULT false)
+	set(ENABLE_CPU_DISPATCH_DEFAULT true)
 	
 	# defines ENABLE_SSE_DEFAULT, etc
 	include(${CMAKE_CURRENT_LIST_DIR}/CheckISA.cmake)
@@ -69,9 +72,12 @@ option(ENABLE_SSE       "compile with SSE instructions" ${ENABLE_SSE_DEFAULT})
 option(ENABLE_AVX       "compile with AVX instructions" ${ENABLE_AVX_DEFAULT})
 option(ENABLE_AVX2      "compile with AVX2 instructions" ${ENABLE_AVX2_DEFAULT})
 option(ENABLE_AVX512    "compile with AVX512 instructions" ${ENABLE_AVX512_DEFAULT})
+option(ENABLE_VAES      "compile with VAES instructions (requires AVX512)" ${ENABLE_VAES_DEFAULT})
 option(ENABLE_BMI2      "compile with BMI2 instructions" ${ENABLE_BMI2_DEFAULT})
+option(ENABLE_CPU_DISPATCH "select AES/GF128/Blake2 kernels for newer instruction sets at runtime" ${ENABLE_CPU_DISPATCH_DEFAULT})
 option(ENABLE_BOOST     "compile with BOOST networking integration" OFF)
 option(ENABLE_OPENSSL   "compile with OpenSSL networking integration" OFF)
+option(ENABLE_IO_URING  "compile the io_uring socket (Linux, requires boost)" OFF)
 option(ENABLE_ASAN      "build with asan" OFF)
 option(ENABLE_PIC       "compile with -fPIC " OFF)
 option(ENABLE_EDWARDS25519_ASM "use the x86-64 Edwards25519 assembly backend" OFF)
@@ -86,6 +92,10 @@ if(NOT ENABLE_SSE AND ENABLE_AVX)
 	message("AVX requires SSE to be enabled.")
 	set(ENABLE_AVX OFF)
 endif()
+if(NOT ENABLE_AVX512 AND ENABLE_VAES)
+	message("VAES requires AVX512 to be enabled.")
+	set(ENABLE_VAES OFF)
+endif()
 
 if(ENABLE_EDWARDS25519_ASM AND
    (NOT CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64)$" OR
@@ -104,6 +114,11 @@ if(ENABLE_BOOST AND (CRYPTO_TOOLS_STD_VER EQUAL 14 OR CRYPTO_TOOLS_STD_VER EQUAL
 	message(FATAL_ERROR "boost requires cpp 20 or newer.")
 endif()
 
+if(ENABLE_IO_URING AND (NOT ENABLE_BOOST OR NOT CMAKE_SYSTEM_NAME STREQUAL "Linux"))
+	message(WARNING "The io_uring socket requires Linux and ENABLE_BOOST; disabling it")
+	set(ENABLE_IO_URING OFF CACHE BOOL "compile the io_uring socket (Linux, requires boost)" FORCE)
+endif()
+
 option(FETCH_AUTO      "automatically download and build dependencies" OFF)
 
 #option(FETCH_SPAN_LITE		"download and build span" OFF))
@@ -182,6 +197,7 @@ message(STATUS "Option: ENABLE_RELIC        = ${ENABLE_RELIC}")
 message(STATUS "Option: ENABLE_SODIUM       = ${ENABLE_SODIUM}")
 message(STATUS "Option: ENABLE_BOOST        = ${ENABLE_BOOST}")
 message(STATUS "Option: ENABLE_OPENSSL      = ${ENABLE_OPENSSL}")
+message(STATUS "Option: ENABLE_IO_URING     = ${ENABLE_IO_URING}")
 message(STATUS "Option: ENABLE_COPROTO      = ${ENABLE_COPROTO}")
 message(STATUS "Option: ENABLE_CIRCUITS     = ${ENABLE_CIRCUITS}")
 										    
@@ -192,7 +208,9 @@ message(STATUS "Option: ENABLE_SSE          = ${ENABLE_SSE}")
 message(STATUS "Option: ENABLE_AVX          = ${ENABLE_AVX}")
 message(STATUS "Option: ENABLE_AVX2         = ${ENABLE_AVX2}")
 message(STATUS "Option: ENABLE_AVX512       = ${ENABLE_AVX512}")
+message(STATUS "Option: ENABLE_VAES         = ${ENABLE_VAES}")
 message(STATUS "Option: ENABLE_BMI2         = ${ENABLE_BMI2}")
+message(STATUS "Option: ENABLE_CPU_DISPATCH = ${ENABLE_CPU_DISPATCH}")
 message(STATUS "Option: ENABLE_PIC          = ${ENABLE_PIC}")
 message(STATUS "Option: ENABLE_EDWARDS25519_ASM = ${ENABLE_EDWARDS25519_ASM}")
 message(STATUS "Option: ENABLE_EDWARDS25519_IFMA = ${ENABLE_EDWARDS25519_IFMA}")
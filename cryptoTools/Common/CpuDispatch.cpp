@@ -0,0 +1,170 @@
+#include "CpuDispatch.h"
+#include <ostream>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define OC_CPUID_MSVC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define OC_CPUID_GNU
+#endif
+
+namespace osuCrypto
+{
+    namespace
+    {
+        struct CpuidRegs
+        {
+            std::uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+        };
+
+        CpuidRegs cpuid(std::uint32_t leaf, std::uint32_t subleaf)
+        {
+            CpuidRegs r;
+#if defined(OC_CPUID_MSVC)
+            int regs[4];
+            __cpuidex(regs, (int)leaf, (int)subleaf);
+            r.eax = regs[0]; r.ebx = regs[1]; r.ecx = regs[2]; r.edx = regs[3];
+#elif defined(OC_CPUID_GNU)
+            __cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#else
+            (void)leaf;
+            (void)subleaf;
+#endif
+            return r;
+        }
+
+        // the register state the os saves on a context switch.
+        std::uint64_t xgetbv0()
+        {
+#if defined(OC_CPUID_MSVC)
+            return _xgetbv(0);
+#elif defined(OC_CPUID_GNU)
+            std::uint32_t eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return ((std::uint64_t)edx << 32) | eax;
+#else
+            return 0;
+#endif
+        }
+
+        bool bit(std::uint32_t reg, int i) { return (reg >> i) & 1; }
+
+        CpuFeatures queryCpuFeatures()
+        {
+            CpuFeatures f;
+#if defined(OC_CPUID_MSVC) || defined(OC_CPUID_GNU)
+            auto maxLeaf = cpuid(0, 0).eax;
+            if (maxLeaf < 1)
+                return f;
+
+            auto l1 = cpuid(1, 0);
+            f.mSSE2 = bit(l1.edx, 26);
+            f.mSSSE3 = bit(l1.ecx, 9);
+            f.mSSE41 = bit(l1.ecx, 19);
+            f.mAESNI = bit(l1.ecx, 25);
+            f.mPCLMUL = bit(l1.ecx, 1);
+
+            // the ymm/zmm registers can only be used if the os saves them.
+            auto osxsave = bit(l1.ecx, 27);
+            auto xcr0 = osxsave ? xgetbv0() : 0;
+            auto osYmm = (xcr0 & 0x6) == 0x6;
+            auto osZmm = osYmm && (xcr0 & 0xE0) == 0xE0;
+
+            f.mAVX = osYmm && bit(l1.ecx, 28);
+
+            if (maxLeaf >= 7)
+            {
+                auto l7 = cpuid(7, 0);
+                f.mBMI2 = bit(l7.ebx, 8);
+                f.mAVX2 = f.mAVX && bit(l7.ebx, 5);
+                f.mAVX512F = osZmm && bit(l7.ebx, 16);
+                f.mVAES = f.mAVX && bit(l7.ecx, 9);
+                f.mVPCLMULQDQ = f.mAVX && bit(l7.ecx, 10);
+            }
+#endif
+            return f;
+        }
+    }
+
+    const CpuFeatures& getCpuFeatures()
+    {
+        static const CpuFeatures features = queryCpuFeatures();
+        return features;
+    }
+
+    std::ostream& operator<<(std::ostream& o, const CpuFeatures& f)
+    {
+        auto p = [&](bool b, const char* name) { if (b) o << name << " "; };
+        p(f.mSSE2, "sse2");
+        p(f.mSSSE3, "ssse3");
+        p(f.mSSE41, "sse4.1");
+        p(f.mAESNI, "aes");
+        p(f.mPCLMUL, "pclmul");
+        p(f.mAVX, "avx");
+        p(f.mAVX2, "avx2");
+        p(f.mAVX512F, "avx512f");
+        p(f.mVAES, "vaes");
+        p(f.mVPCLMULQDQ, "vpclmulqdq");
+        p(f.mBMI2, "bmi2");
+        return o;
+    }
+
+    namespace details
+    {
+        CpuKernels selectCpuKernels(const CpuFeatures& f)
+        {
+            CpuKernels k;
+#ifdef OC_ENABLE_CPU_DISPATCH
+            // the aesni translation unit also uses pclmul and sse4.1.
+            auto westmere = f.mAESNI && f.mPCLMUL && f.mSSE41 && f.mSSSE3;
+            (void)westmere;
+
+#ifndef OC_ENABLE_VAES
+            auto vaes = getVaesAesKernels();
+            if (vaes && westmere && f.mAVX512F && f.mVAES)
+            {
+                k.mAes = *vaes;
+#ifdef OC_ENABLE_AESNI
+                // for short inputs the inlined aes-ni code is as fast.
+                k.mAes.mMinBlocks = 32;
+#endif
+            }
+#endif
+
+#ifndef OC_ENABLE_AESNI
+            auto aesni = getAesniAesKernels();
+            if (aesni && westmere && k.mAes.mEcbEncBlocks == nullptr)
+                k.mAes = *aesni;
+#endif
+
+#if !defined(OC_ENABLE_PCLMUL) && !defined(ENABLE_ARM_AES)
+            auto gf128 = getPclmulGf128Kernels();
+            if (gf128 && westmere)
+                k.mGf128 = *gf128;
+#endif
+
+            // only the bulk kernels gain from the wider registers.
+            auto vpclmul = getVpclmulGf128Kernels();
+            if (vpclmul && westmere && f.mAVX512F && f.mVPCLMULQDQ)
+            {
+                k.mGf128.mMulBlocks = vpclmul->mMulBlocks;
+                k.mGf128.mMulScalar = vpclmul->mMulScalar;
+                k.mGf128.mInnerProduct = vpclmul->mInnerProduct;
+            }
+
+            // the compiled in blake2b only uses sse4.1 when built with avx.
+#if !defined(ENABLE_SSE_BLAKE2) || !defined(ENABLE_AVX)
+            auto blake2b = getSse41Blake2bKernels();
+            if (blake2b && westmere)
+                k.mBlake2b = *blake2b;
+#endif
+#else
+            (void)f;
+#endif
+            return k;
+        }
+
+        CpuKernels gCpuKernels = selectCpuKernels(getCpuFeatures());
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include "cryptoTools/Common/config.h"
+#include <cstdint>
+#include <iosfwd>
+
+namespace osuCrypto
+{
+    struct block;
+
+    // The instruction set extensions that the current cpu and os support.
+    // This can differ from what the library was compiled with, e.g. a
+    // portable build running on a modern cpu.
+    struct CpuFeatures
+    {
+        bool mSSE2 = false;
+        bool mSSSE3 = false;
+        bool mSSE41 = false;
+        bool mAESNI = false;
+        bool mPCLMUL = false;
+        bool mAVX = false;
+        bool mAVX2 = false;
+        bool mAVX512F = false;
+        bool mVAES = false;
+        bool mVPCLMULQDQ = false;
+        bool mBMI2 = false;
+    };
+
+    // Returns the features of the current cpu. cpuid is queried once.
+    const CpuFeatures& getCpuFeatures();
+
+    std::ostream& operator<<(std::ostream& o, const CpuFeatures& f);
+
+    namespace details
+    {
+        // Bulk AES-128 kernels which operate on the expanded encryption
+        // key schedule, i.e. AES<type>::mRoundKey.
+        struct AesKernels
+        {
+            // the smallest input, in blocks, for which the kernels are
+            // faster than the compiled in implementation.
+            std::uint64_t mMinBlocks = 0;
+
+            void(*mEcbEncBlocks)(const block* roundKeys, const block* plaintext, std::uint64_t blocks, block* ciphertext) = nullptr;
+            void(*mHashBlocks)(const block* roundKeys, const block* plaintext, std::uint64_t blocks, block* ciphertext) = nullptr;
+            void(*mEcbEncCounterMode)(const block* roundKeys, const block& baseIdx, std::uint64_t blocks, block* ciphertext) = nullptr;
+        };
+
+        // GF(2^128) kernels with the same semantics as block::gf128Mul(y, xy1, xy2)
+        // and block::gf128Reduce(x1), along with the bulk kernels behind Gf128.h.
+        struct Gf128Kernels
+        {
+            void(*mMul)(const block& x, const block& y, block& xy1, block& xy2) = nullptr;
+            void(*mReduce)(const block& x0, const block& x1, block& r) = nullptr;
+
+            // xy[i] = x[i] * y[i].
+            void(*mMulBlocks)(const block* x, const block* y, std::uint64_t n, block* xy) = nullptr;
+
+            // xy[i] = x[i] * y.
+            void(*mMulScalar)(const block* x, const block& y, std::uint64_t n, block* xy) = nullptr;
+
+            // the unreduced sum of x[i] * y[i], i.e. the xy1, xy2 of gf128Mul.
+            void(*mInnerProduct)(const block* x, const block* y, std::uint64_t n, block& xy1, block& xy2) = nullptr;
+        };
+
+        // The blake2b compression function. t and f are the counter and
+        // finalization words of the blake2b_state.
+        struct Blake2bKernels
+        {
+            void(*mCompress)(std::uint64_t* h, const std::uint64_t* t, const std::uint64_t* f, const std::uint8_t* block) = nullptr;
+        };
+
+        struct CpuKernels
+        {
+            AesKernels mAes;
+            Gf128Kernels mGf128;
+            Blake2bKernels mBlake2b;
+        };
+
+        // The kernels selected for the current cpu. A null kernel means the
+        // compiled in implementation is the best available and should be used.
+        // Populated during static initialization.
+        extern CpuKernels gCpuKernels;
+
+        // Select the kernels for a cpu with the given features.
+        CpuKernels selectCpuKernels(const CpuFeatures& features);
+
+        // The kernels implemented by the ISA specific translation units in
+        // Common/dispatch. Each returns nullptr if the compiler could not
+        // target that instruction set.
+        const AesKernels* getAesniAesKernels();
+        const Gf128Kernels* getPclmulGf128Kernels();
+        const Blake2bKernels* getSse41Blake2bKernels();
+        const AesKernels* getVaesAesKernels();
+        const Gf128Kernels* getVpclmulGf128Kernels();
+    }
+}
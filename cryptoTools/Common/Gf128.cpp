@@ -0,0 +1,175 @@
+#include "Gf128.h"
+#include <algorithm>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        // xy1, xy2 = the unreduced sum of x[i] * y[i].
+        void innerProduct(const block* x, const block* y, u64 n, block& xy1, block& xy2)
+        {
+#ifdef OC_ENABLE_CPU_DISPATCH
+            if (details::gCpuKernels.mGf128.mInnerProduct)
+                return details::gCpuKernels.mGf128.mInnerProduct(x, y, n, xy1, xy2);
+#endif
+            block lo = ZeroBlock, hi = ZeroBlock;
+            for (u64 i = 0; i < n; ++i)
+            {
+                block l, h;
+                x[i].gf128Mul(y[i], l, h);
+                lo = lo ^ l;
+                hi = hi ^ h;
+            }
+            xy1 = lo;
+            xy2 = hi;
+        }
+    }
+
+    void gf128Mul(span<const block> x, span<const block> y, span<block> xy)
+    {
+        if (x.size() != y.size() || x.size() != xy.size())
+            throw RTE_LOC;
+
+#ifdef OC_ENABLE_CPU_DISPATCH
+        if (details::gCpuKernels.mGf128.mMulBlocks)
+            return details::gCpuKernels.mGf128.mMulBlocks(x.data(), y.data(), x.size(), xy.data());
+#endif
+        auto xp = x.data();
+        auto yp = y.data();
+        auto dst = xy.data();
+        for (u64 i = 0; i < x.size(); ++i)
+            dst[i] = xp[i].gf128Mul(yp[i]);
+    }
+
+    void gf128Mul(span<const block> x, const block& y, span<block> xy)
+    {
+        if (x.size() != xy.size())
+            throw RTE_LOC;
+
+#ifdef OC_ENABLE_CPU_DISPATCH
+        if (details::gCpuKernels.mGf128.mMulScalar)
+            return details::gCpuKernels.mGf128.mMulScalar(x.data(), y, x.size(), xy.data());
+#endif
+        auto xp = x.data();
+        auto dst = xy.data();
+        for (u64 i = 0; i < x.size(); ++i)
+            dst[i] = xp[i].gf128Mul(y);
+    }
+
+    block gf128InnerProduct(span<const block> x, span<const block> y)
+    {
+        if (x.size() != y.size())
+            throw RTE_LOC;
+
+        block lo, hi;
+        innerProduct(x.data(), y.data(), x.size(), lo, hi);
+        return lo.gf128Reduce(hi);
+    }
+
+    block gf128PolyEval(span<const block> coeffs, const block& x)
+    {
+        if (coeffs.size() == 0)
+            return ZeroBlock;
+
+        // p(x) = c_0 + x q(x), where x q(x) is evaluated from the top m <= k
+        // coefficients at a time as
+        //
+        //   acc = acc * x^m + sum_j c_{b+j} * x^{j+1},
+        //
+        // which is an inner product with the powers x^1, ..., x^k and only
+        // needs to be reduced once.
+        constexpr u64 k = 16;
+        auto c = coeffs.data() + 1;
+        auto n = coeffs.size() - 1;
+
+        block pows[k];
+        pows[0] = x;
+        for (u64 j = 1; j < std::min<u64>(k, n); ++j)
+            pows[j] = pows[j - 1].gf128Mul(x);
+
+        block acc = ZeroBlock;
+        for (u64 end = n; end; )
+        {
+            auto m = std::min<u64>(k, end);
+            end -= m;
+
+            block lo, hi, l, h;
+            innerProduct(c + end, pows, m, lo, hi);
+            acc.gf128Mul(pows[m - 1], l, h);
+            acc = (lo ^ l).gf128Reduce(hi ^ h);
+        }
+
+        return acc ^ coeffs[0];
+    }
+
+    block gf128Inv(const block& x)
+    {
+        if (x == ZeroBlock)
+            throw RTE_LOC;
+
+        // x^-1 = x^(2^128 - 2) = (x^(2^127 - 1))^2. Let a_k = x^(2^k - 1), then
+        // a_2k = a_k^(2^k) * a_k and a_k+1 = a_k^2 * x. Following the bits of
+        // 127 takes 126 squarings and 12 multiplications (Itoh-Tsujii).
+        block a = x;
+        u64 k = 1;
+        for (int bit = 5; bit >= 0; --bit)
+        {
+            auto s = a;
+            for (u64 i = 0; i < k; ++i)
+                s = s.gf128Mul(s);
+            a = s.gf128Mul(a);
+            k *= 2;
+
+            if ((127 >> bit) & 1)
+            {
+                a = a.gf128Mul(a).gf128Mul(x);
+                k += 1;
+            }
+        }
+        return a.gf128Mul(a);
+    }
+
+    void gf128Inv(span<const block> x, span<block> inv)
+    {
+        if (x.size() != inv.size())
+            throw RTE_LOC;
+
+        auto n = x.size();
+        if (n == 0)
+            return;
+
+        // w interleaved chains of prefix products so that the multiplications
+        // of different chains can be pipelined. inv[i] is the product of
+        // x[j] for all j <= i with j = i mod w.
+        constexpr u64 maxW = 8;
+        const u64 w = n >= 8 * maxW ? maxW : 1;
+        auto xp = x.data();
+        auto ip = inv.data();
+        for (u64 i = 0; i < n; ++i)
+        {
+            if (xp[i] == ZeroBlock)
+                throw RTE_LOC;
+            ip[i] = i < w ? xp[i] : ip[i - w].gf128Mul(xp[i]);
+        }
+
+        // t[j] is the inverse of the chain j product.
+        block t[maxW], last[maxW];
+        for (u64 i = n - w; i < n; ++i)
+            last[i % w] = ip[i];
+        if (w == 1)
+            t[0] = gf128Inv(last[0]);
+        else
+            gf128Inv(span<const block>(last, w), span<block>(t, w));
+
+        // peel off one element of each chain at a time.
+        for (u64 i = n - 1; i >= w; --i)
+        {
+            auto& tj = t[i % w];
+            auto r = tj.gf128Mul(ip[i - w]);
+            tj = tj.gf128Mul(xp[i]);
+            ip[i] = r;
+        }
+        for (u64 i = 0; i < w; ++i)
+            ip[i] = t[i];
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include "cryptoTools/Common/Defines.h"
+#include "cryptoTools/Common/block.h"
+
+namespace osuCrypto
+{
+    // Batched arithmetic in GF(2^128), with the same field and representation
+    // as block::gf128Mul. The products are computed with PCLMUL or ARM PMULL
+    // when the library is compiled with them, and with VPCLMULQDQ when the
+    // cpu supports it and ENABLE_CPU_DISPATCH is on. Sums of products are
+    // reduced once rather than once per product.
+
+    // xy[i] = x[i] * y[i].
+    void gf128Mul(span<const block> x, span<const block> y, span<block> xy);
+
+    // xy[i] = x[i] * y.
+    void gf128Mul(span<const block> x, const block& y, span<block> xy);
+
+    // Returns sum_i x[i] * y[i].
+    block gf128InnerProduct(span<const block> x, span<const block> y);
+
+    // Returns sum_i coeffs[i] * x^i, evaluated with Horner's rule on 16
+    // coefficients at a time.
+    block gf128PolyEval(span<const block> coeffs, const block& x);
+
+    // Returns the inverse of x. Throws if x is zero.
+    block gf128Inv(const block& x);
+
+    // inv[i] = x[i]^-1 using Montgomery's trick, i.e. one inversion and three
+    // multiplications per element. x and inv must not overlap. Throws if
+    // any x[i] is zero.
+    void gf128Inv(span<const block> x, span<block> inv);
+}
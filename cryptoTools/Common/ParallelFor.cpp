@@ -0,0 +1,120 @@
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        // Shared between the caller and the helpers. Helpers that start after
+        // the caller returned find no chunks left and never touch mFn.
+        struct ParallelForState
+        {
+            u64 mN = 0, mChunkSize = 0, mNumChunks = 0;
+            const std::function<void(u64, u64)>* mFn = nullptr;
+
+            std::atomic<u64> mNext{ 0 };
+            u64 mDone = 0;
+            std::exception_ptr mException;
+            std::mutex mMtx;
+            std::condition_variable mCV;
+
+            void work()
+            {
+                u64 i;
+                while ((i = mNext.fetch_add(1, std::memory_order_relaxed)) < mNumChunks)
+                {
+                    auto begin = i * mChunkSize;
+                    auto end = std::min<u64>(begin + mChunkSize, mN);
+                    std::exception_ptr ex;
+                    try {
+                        (*mFn)(begin, end);
+                    }
+                    catch (...) {
+                        ex = std::current_exception();
+                    }
+
+                    std::lock_guard<std::mutex> lock(mMtx);
+                    if (ex && !mException)
+                        mException = ex;
+                    if (++mDone == mNumChunks)
+                        mCV.notify_all();
+                }
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(mMtx);
+                mCV.wait(lock, [this] { return mDone == mNumChunks; });
+                if (mException)
+                    std::rethrow_exception(mException);
+            }
+        };
+    }
+
+    void parallelFor(u64 n, u64 chunkSize, u64 numTasks, const TaskScheduler& schedule,
+        const std::function<void(u64 begin, u64 end)>& fn)
+    {
+        if (chunkSize == 0)
+            throw RTE_LOC;
+        if (n == 0)
+            return;
+
+        auto numChunks = divCeil(n, chunkSize);
+        if (numChunks == 1 || numTasks == 0)
+        {
+            for (u64 begin = 0; begin < n; begin += chunkSize)
+                fn(begin, std::min<u64>(begin + chunkSize, n));
+            return;
+        }
+
+        auto state = std::make_shared<ParallelForState>();
+        state->mN = n;
+        state->mChunkSize = chunkSize;
+        state->mNumChunks = numChunks;
+        state->mFn = &fn;
+
+        // there is no point in starting more helpers than chunks.
+        numTasks = std::min<u64>(numTasks, numChunks - 1);
+        try {
+            for (u64 i = 0; i < numTasks; ++i)
+                schedule([state] { state->work(); });
+        }
+        catch (...) {
+            // the caller processes whatever the missing helpers would have.
+        }
+
+        state->work();
+        state->wait();
+    }
+
+    void parallelFor(u64 n, u64 chunkSize, u64 numThreads,
+        const std::function<void(u64 begin, u64 end)>& fn)
+    {
+        if (numThreads == 0)
+            numThreads = std::max<u64>(1, std::thread::hardware_concurrency());
+
+        std::vector<std::thread> thrds;
+        thrds.reserve(numThreads - 1);
+        auto spawn = [&](std::function<void()> task) { thrds.emplace_back(std::move(task)); };
+
+        std::exception_ptr ex;
+        try {
+            parallelFor(n, chunkSize, numThreads - 1, spawn, fn);
+        }
+        catch (...) {
+            ex = std::current_exception();
+        }
+
+        for (auto& t : thrds)
+            t.join();
+        if (ex)
+            std::rethrow_exception(ex);
+    }
+}
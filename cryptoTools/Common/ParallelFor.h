@@ -0,0 +1,24 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include "cryptoTools/Common/Defines.h"
+#include <functional>
+
+namespace osuCrypto
+{
+    // Runs the task on some other thread, e.g. by posting it to a thread pool.
+    using TaskScheduler = std::function<void(std::function<void()>)>;
+
+    // Calls fn(begin, end) for the chunks [0, chunkSize), [chunkSize, 2 * chunkSize), ...
+    // of [0, n). The chunks are processed by numThreads threads, including the
+    // calling thread. numThreads = 0 uses std::thread::hardware_concurrency().
+    // The first exception thrown by fn is rethrown once all threads are done.
+    void parallelFor(u64 n, u64 chunkSize, u64 numThreads,
+        const std::function<void(u64 begin, u64 end)>& fn);
+
+    // Same as above except that numTasks helpers are started with schedule
+    // instead of new threads. The calling thread also processes chunks and
+    // only waits for chunks that have been started, so this completes even if
+    // the scheduler is busy or the caller is one of its threads.
+    void parallelFor(u64 n, u64 chunkSize, u64 numTasks, const TaskScheduler& schedule,
+        const std::function<void(u64 begin, u64 end)>& fn);
+}
@@ -15,6 +15,9 @@
 #ifdef OC_ENABLE_PCLMUL
 #include <wmmintrin.h>
 #endif
+#ifdef OC_ENABLE_CPU_DISPATCH
+#include "cryptoTools/Common/CpuDispatch.h"
+#endif
 
 #ifdef ENABLE_ARM_AES
 #if defined(__arm__) || defined(__aarch32__) || defined(__arm64__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64)
@@ -738,6 +741,10 @@ namespace osuCrypto
 #elif defined(ENABLE_ARM_AES)
 			arm_gf128Mul(y, xy1, xy2);
 #else
+#ifdef OC_ENABLE_CPU_DISPATCH
+			if (details::gCpuKernels.mGf128.mMul)
+				return details::gCpuKernels.mGf128.mMul(*this, y, xy1, xy2);
+#endif
 			cc_gf128Mul(y, xy1, xy2);
 #endif // !OC_ENABLE_PCLMUL
 		}
@@ -745,13 +752,7 @@ namespace osuCrypto
 		OC_CUDA_CALLABLE OC_FORCEINLINE  block gf128Mul(const block& y) const
 		{
 			block xy1, xy2;
-#ifdef OC_ENABLE_PCLMUL
-			mm_gf128Mul(y, xy1, xy2);
-#elif defined(ENABLE_ARM_AES)
-			arm_gf128Mul(y, xy1, xy2);
-#else
-			cc_gf128Mul(y, xy1, xy2);
-#endif // !OC_ENABLE_PCLMUL
+			gf128Mul(y, xy1, xy2);
 
 			return xy1.gf128Reduce(xy2);
 		}
@@ -863,6 +864,14 @@ namespace osuCrypto
 #elif defined(ENABLE_ARM_AES)
 			return arm_gf128Reduce(x1);
 #else
+#ifdef OC_ENABLE_CPU_DISPATCH
+			if (details::gCpuKernels.mGf128.mReduce)
+			{
+				block r;
+				details::gCpuKernels.mGf128.mReduce(*this, x1, r);
+				return r;
+			}
+#endif
 			return cc_gf128Reduce(x1);
 #endif
 		}
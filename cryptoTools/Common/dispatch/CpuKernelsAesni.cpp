@@ -0,0 +1,282 @@
+// Kernels for cpus with AES-NI, PCLMUL and SSE4.1. This translation unit is
+// compiled with those instructions enabled regardless of the library wide
+// flags and is only called after cpuid confirms they are supported. It must
+// not include headers that define inline functions, e.g. block.h, since the
+// linker could then pick the copy compiled here for the rest of the library.
+#include "cryptoTools/Common/CpuDispatch.h"
+
+#if defined(OC_ENABLE_CPU_DISPATCH) && (defined(_MSC_VER) || (defined(__AES__) && defined(__PCLMUL__) && defined(__SSE4_1__)))
+#define OC_CPU_KERNELS_AESNI
+#endif
+
+#ifdef OC_CPU_KERNELS_AESNI
+
+#ifndef ENABLE_SSE_BLAKE2
+#define ENABLE_SSE_BLAKE2 ON
+#endif
+#define HAVE_SSE2
+#define HAVE_SSSE3
+#define HAVE_SSE41
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#include "cryptoTools/Crypto/blake2/sse/blake2b-round.h"
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        namespace
+        {
+            constexpr int rounds = 10;
+
+            struct RoundKeys
+            {
+                __m128i k[rounds + 1];
+
+                RoundKeys(const block* roundKeys)
+                {
+                    auto src = reinterpret_cast<const __m128i*>(roundKeys);
+                    for (int i = 0; i < rounds + 1; ++i)
+                        k[i] = _mm_loadu_si128(src + i);
+                }
+            };
+
+            template<int n>
+            inline void encN(const RoundKeys& key, __m128i* x)
+            {
+                for (int j = 0; j < n; ++j) x[j] = _mm_xor_si128(x[j], key.k[0]);
+                for (int i = 1; i < rounds; ++i)
+                    for (int j = 0; j < n; ++j) x[j] = _mm_aesenc_si128(x[j], key.k[i]);
+                for (int j = 0; j < n; ++j) x[j] = _mm_aesenclast_si128(x[j], key.k[rounds]);
+            }
+
+            template<bool xorInput>
+            void encBlocks(const block* roundKeys, const block* plaintext, std::uint64_t blocks, block* ciphertext)
+            {
+                RoundKeys key(roundKeys);
+                auto src = reinterpret_cast<const __m128i*>(plaintext);
+                auto dst = reinterpret_cast<__m128i*>(ciphertext);
+
+                constexpr std::uint64_t step = 8;
+                std::uint64_t i = 0;
+                __m128i x[step], p[step];
+                for (; i + step <= blocks; i += step)
+                {
+                    for (std::uint64_t j = 0; j < step; ++j) p[j] = x[j] = _mm_loadu_si128(src + i + j);
+                    encN<step>(key, x);
+                    for (std::uint64_t j = 0; j < step; ++j)
+                        _mm_storeu_si128(dst + i + j, xorInput ? _mm_xor_si128(x[j], p[j]) : x[j]);
+                }
+                for (; i < blocks; ++i)
+                {
+                    p[0] = x[0] = _mm_loadu_si128(src + i);
+                    encN<1>(key, x);
+                    _mm_storeu_si128(dst + i, xorInput ? _mm_xor_si128(x[0], p[0]) : x[0]);
+                }
+            }
+
+            void ecbEncCounterMode(const block* roundKeys, const block& baseIdx, std::uint64_t blocks, block* ciphertext)
+            {
+                RoundKeys key(roundKeys);
+                auto base = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&baseIdx));
+                auto dst = reinterpret_cast<__m128i*>(ciphertext);
+
+                constexpr std::uint64_t step = 8;
+                std::uint64_t i = 0;
+                __m128i x[step];
+                for (; i + step <= blocks; i += step)
+                {
+                    for (std::uint64_t j = 0; j < step; ++j)
+                        x[j] = _mm_add_epi64(base, _mm_set_epi64x(0, i + j));
+                    encN<step>(key, x);
+                    for (std::uint64_t j = 0; j < step; ++j)
+                        _mm_storeu_si128(dst + i + j, x[j]);
+                }
+                for (; i < blocks; ++i)
+                {
+                    x[0] = _mm_add_epi64(base, _mm_set_epi64x(0, i));
+                    encN<1>(key, x);
+                    _mm_storeu_si128(dst + i, x[0]);
+                }
+            }
+
+            // the 256 bit product of a and b as the low, middle and high
+            // 128 bits, where the middle overlaps the other two by 64 bits.
+            // The parts of several products can be summed before combining.
+            inline void clmul(__m128i a, __m128i b, __m128i& lo, __m128i& mid, __m128i& hi)
+            {
+                lo = _mm_clmulepi64_si128(a, b, 0x00);
+                mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+                hi = _mm_clmulepi64_si128(a, b, 0x11);
+            }
+
+            inline void combine(__m128i& lo, __m128i mid, __m128i& hi)
+            {
+                lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+                hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+            }
+
+            inline __m128i reduce(__m128i low, __m128i high)
+            {
+                const __m128i modulus = _mm_set_epi64x(0, 0b10000111);
+
+                // reduce w.r.t. the high half of high
+                auto tmp = _mm_clmulepi64_si128(high, modulus, 0x01);
+                low = _mm_xor_si128(low, _mm_slli_si128(tmp, 8));
+                high = _mm_xor_si128(high, _mm_srli_si128(tmp, 8));
+
+                // reduce w.r.t. the low half of high
+                tmp = _mm_clmulepi64_si128(high, modulus, 0x00);
+                return _mm_xor_si128(low, tmp);
+            }
+
+            void gf128Mul(const block& x, const block& y, block& xy1, block& xy2)
+            {
+                auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x));
+                auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&y));
+                __m128i lo, mid, hi;
+                clmul(a, b, lo, mid, hi);
+                combine(lo, mid, hi);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&xy1), lo);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&xy2), hi);
+            }
+
+            void gf128Reduce(const block& x0, const block& x1, block& r)
+            {
+                auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x0));
+                auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&r), reduce(low, high));
+            }
+
+            void gf128MulBlocks(const block* x, const block* y, std::uint64_t n, block* xy)
+            {
+                auto src0 = reinterpret_cast<const __m128i*>(x);
+                auto src1 = reinterpret_cast<const __m128i*>(y);
+                auto dst = reinterpret_cast<__m128i*>(xy);
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    __m128i lo, mid, hi;
+                    clmul(_mm_loadu_si128(src0 + i), _mm_loadu_si128(src1 + i), lo, mid, hi);
+                    combine(lo, mid, hi);
+                    _mm_storeu_si128(dst + i, reduce(lo, hi));
+                }
+            }
+
+            void gf128MulScalar(const block* x, const block& y, std::uint64_t n, block* xy)
+            {
+                auto src = reinterpret_cast<const __m128i*>(x);
+                auto dst = reinterpret_cast<__m128i*>(xy);
+                auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&y));
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    __m128i lo, mid, hi;
+                    clmul(_mm_loadu_si128(src + i), b, lo, mid, hi);
+                    combine(lo, mid, hi);
+                    _mm_storeu_si128(dst + i, reduce(lo, hi));
+                }
+            }
+
+            void gf128InnerProduct(const block* x, const block* y, std::uint64_t n, block& xy1, block& xy2)
+            {
+                auto src0 = reinterpret_cast<const __m128i*>(x);
+                auto src1 = reinterpret_cast<const __m128i*>(y);
+                auto lo = _mm_setzero_si128();
+                auto mid = _mm_setzero_si128();
+                auto hi = _mm_setzero_si128();
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    __m128i l, m, h;
+                    clmul(_mm_loadu_si128(src0 + i), _mm_loadu_si128(src1 + i), l, m, h);
+                    lo = _mm_xor_si128(lo, l);
+                    mid = _mm_xor_si128(mid, m);
+                    hi = _mm_xor_si128(hi, h);
+                }
+                combine(lo, mid, hi);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&xy1), lo);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&xy2), hi);
+            }
+
+            const std::uint64_t blake2b_IV[8] =
+            {
+              0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+              0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+              0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+              0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+            };
+
+            // the sse4.1 path of sse/blake2b.cpp.
+            void blake2bCompress(std::uint64_t* h, const std::uint64_t* t, const std::uint64_t* f, const std::uint8_t* block)
+            {
+                __m128i row1l, row1h;
+                __m128i row2l, row2h;
+                __m128i row3l, row3h;
+                __m128i row4l, row4h;
+                __m128i b0, b1;
+                __m128i t0, t1;
+                const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+                const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+                const __m128i m0 = LOADU(block + 00);
+                const __m128i m1 = LOADU(block + 16);
+                const __m128i m2 = LOADU(block + 32);
+                const __m128i m3 = LOADU(block + 48);
+                const __m128i m4 = LOADU(block + 64);
+                const __m128i m5 = LOADU(block + 80);
+                const __m128i m6 = LOADU(block + 96);
+                const __m128i m7 = LOADU(block + 112);
+                row1l = LOADU(&h[0]);
+                row1h = LOADU(&h[2]);
+                row2l = LOADU(&h[4]);
+                row2h = LOADU(&h[6]);
+                row3l = LOADU(&blake2b_IV[0]);
+                row3h = LOADU(&blake2b_IV[2]);
+                row4l = _mm_xor_si128(LOADU(&blake2b_IV[4]), LOADU(&t[0]));
+                row4h = _mm_xor_si128(LOADU(&blake2b_IV[6]), LOADU(&f[0]));
+                ROUND(0);
+                ROUND(1);
+                ROUND(2);
+                ROUND(3);
+                ROUND(4);
+                ROUND(5);
+                ROUND(6);
+                ROUND(7);
+                ROUND(8);
+                ROUND(9);
+                ROUND(10);
+                ROUND(11);
+                row1l = _mm_xor_si128(row3l, row1l);
+                row1h = _mm_xor_si128(row3h, row1h);
+                STOREU(&h[0], _mm_xor_si128(LOADU(&h[0]), row1l));
+                STOREU(&h[2], _mm_xor_si128(LOADU(&h[2]), row1h));
+                row2l = _mm_xor_si128(row4l, row2l);
+                row2h = _mm_xor_si128(row4h, row2h);
+                STOREU(&h[4], _mm_xor_si128(LOADU(&h[4]), row2l));
+                STOREU(&h[6], _mm_xor_si128(LOADU(&h[6]), row2h));
+            }
+
+            const AesKernels aesKernels{ 1, encBlocks<false>, encBlocks<true>, ecbEncCounterMode };
+            const Gf128Kernels gf128Kernels{ gf128Mul, gf128Reduce, gf128MulBlocks, gf128MulScalar, gf128InnerProduct };
+            const Blake2bKernels blake2bKernels{ blake2bCompress };
+        }
+
+        const AesKernels* getAesniAesKernels() { return &aesKernels; }
+        const Gf128Kernels* getPclmulGf128Kernels() { return &gf128Kernels; }
+        const Blake2bKernels* getSse41Blake2bKernels() { return &blake2bKernels; }
+    }
+}
+
+#else
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        const AesKernels* getAesniAesKernels() { return nullptr; }
+        const Gf128Kernels* getPclmulGf128Kernels() { return nullptr; }
+        const Blake2bKernels* getSse41Blake2bKernels() { return nullptr; }
+    }
+}
+
+#endif
@@ -0,0 +1,317 @@
+// Kernels for cpus with VAES, VPCLMULQDQ and AVX512F. This translation unit
+// is compiled with those instructions enabled regardless of the library wide
+// flags and is only called after cpuid confirms they are supported. See
+// CpuKernelsAesni.cpp for why it must not include headers that define inline
+// functions.
+#include "cryptoTools/Common/CpuDispatch.h"
+
+#if defined(OC_ENABLE_CPU_DISPATCH) && (defined(_MSC_VER) || (defined(__VAES__) && defined(__AVX512F__) && defined(__AES__)))
+#define OC_CPU_KERNELS_VAES
+#endif
+
+#if defined(OC_CPU_KERNELS_VAES) && (defined(_MSC_VER) || (defined(__VPCLMULQDQ__) && defined(__PCLMUL__)))
+#define OC_CPU_KERNELS_VPCLMUL
+#endif
+
+#ifdef OC_CPU_KERNELS_VAES
+
+#include <immintrin.h>
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        namespace
+        {
+            constexpr int rounds = 10;
+
+            // the round keys broadcast to all four lanes of a zmm register
+            // along with the single lane copy for the tail.
+            struct RoundKeys
+            {
+                __m512i k512[rounds + 1];
+                __m128i k128[rounds + 1];
+
+                RoundKeys(const block* roundKeys)
+                {
+                    auto src = reinterpret_cast<const __m128i*>(roundKeys);
+                    for (int i = 0; i < rounds + 1; ++i)
+                    {
+                        k128[i] = _mm_loadu_si128(src + i);
+                        // maskz avoids a spurious uninitialized warning from gcc.
+                        k512[i] = _mm512_maskz_broadcast_i32x4(0xFFFF, k128[i]);
+                    }
+                }
+            };
+
+            template<int n>
+            inline void enc512(const RoundKeys& key, __m512i* x)
+            {
+                for (int j = 0; j < n; ++j) x[j] = _mm512_xor_si512(x[j], key.k512[0]);
+                for (int i = 1; i < rounds; ++i)
+                    for (int j = 0; j < n; ++j) x[j] = _mm512_aesenc_epi128(x[j], key.k512[i]);
+                for (int j = 0; j < n; ++j) x[j] = _mm512_aesenclast_epi128(x[j], key.k512[rounds]);
+            }
+
+            inline __m128i enc128(const RoundKeys& key, __m128i x)
+            {
+                x = _mm_xor_si128(x, key.k128[0]);
+                for (int i = 1; i < rounds; ++i)
+                    x = _mm_aesenc_si128(x, key.k128[i]);
+                return _mm_aesenclast_si128(x, key.k128[rounds]);
+            }
+
+            template<bool xorInput>
+            void encBlocks(const block* roundKeys, const block* plaintext, std::uint64_t blocks, block* ciphertext)
+            {
+                RoundKeys key(roundKeys);
+                auto src = reinterpret_cast<const __m128i*>(plaintext);
+                auto dst = reinterpret_cast<__m128i*>(ciphertext);
+
+                // 4 zmm registers of 4 blocks each keeps the aes unit busy.
+                constexpr std::uint64_t n512 = 4;
+                constexpr std::uint64_t step = n512 * 4;
+                std::uint64_t i = 0;
+                __m512i x[n512], p[n512];
+                for (; i + step <= blocks; i += step)
+                {
+                    for (std::uint64_t j = 0; j < n512; ++j) p[j] = x[j] = _mm512_loadu_si512(src + i + 4 * j);
+                    enc512<n512>(key, x);
+                    for (std::uint64_t j = 0; j < n512; ++j)
+                        _mm512_storeu_si512(dst + i + 4 * j, xorInput ? _mm512_xor_si512(x[j], p[j]) : x[j]);
+                }
+                for (; i + 4 <= blocks; i += 4)
+                {
+                    p[0] = x[0] = _mm512_loadu_si512(src + i);
+                    enc512<1>(key, x);
+                    _mm512_storeu_si512(dst + i, xorInput ? _mm512_xor_si512(x[0], p[0]) : x[0]);
+                }
+                for (; i < blocks; ++i)
+                {
+                    auto b = _mm_loadu_si128(src + i);
+                    auto c = enc128(key, b);
+                    _mm_storeu_si128(dst + i, xorInput ? _mm_xor_si128(c, b) : c);
+                }
+            }
+
+            void ecbEncCounterMode(const block* roundKeys, const block& baseIdx, std::uint64_t blocks, block* ciphertext)
+            {
+                RoundKeys key(roundKeys);
+                auto base128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&baseIdx));
+                auto dst = reinterpret_cast<__m128i*>(ciphertext);
+
+                // {base, base + 1, base + 2, base + 3} where only the low 64 bits are incremented.
+                const __m512i base = _mm512_add_epi64(
+                    _mm512_maskz_broadcast_i32x4(0xFFFF, base128),
+                    _mm512_set_epi64(0, 3, 0, 2, 0, 1, 0, 0));
+                const __m512i four = _mm512_set_epi64(0, 4, 0, 4, 0, 4, 0, 4);
+
+                constexpr std::uint64_t n512 = 4;
+                constexpr std::uint64_t step = n512 * 4;
+                std::uint64_t i = 0;
+                __m512i ctr = base;
+                __m512i x[n512];
+                for (; i + step <= blocks; i += step)
+                {
+                    for (std::uint64_t j = 0; j < n512; ++j)
+                    {
+                        x[j] = ctr;
+                        ctr = _mm512_add_epi64(ctr, four);
+                    }
+                    enc512<n512>(key, x);
+                    for (std::uint64_t j = 0; j < n512; ++j)
+                        _mm512_storeu_si512(dst + i + 4 * j, x[j]);
+                }
+                for (; i + 4 <= blocks; i += 4)
+                {
+                    x[0] = ctr;
+                    ctr = _mm512_add_epi64(ctr, four);
+                    enc512<1>(key, x);
+                    _mm512_storeu_si512(dst + i, x[0]);
+                }
+                for (; i < blocks; ++i)
+                {
+                    auto c = _mm_add_epi64(base128, _mm_set_epi64x(0, i));
+                    _mm_storeu_si128(dst + i, enc128(key, c));
+                }
+            }
+
+            const AesKernels aesKernels{ 1, encBlocks<false>, encBlocks<true>, ecbEncCounterMode };
+        }
+
+        const AesKernels* getVaesAesKernels() { return &aesKernels; }
+    }
+}
+
+#else
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        const AesKernels* getVaesAesKernels() { return nullptr; }
+    }
+}
+
+#endif
+
+#ifdef OC_CPU_KERNELS_VPCLMUL
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        namespace
+        {
+            // four independent versions of the pclmul code in CpuKernelsAesni.cpp,
+            // one per 128 bit lane.
+
+            // the 64 bit lane shifts, which avoid the avx512bw byte shifts.
+            inline __m512i shiftUp64(__m512i x) { return _mm512_maskz_unpacklo_epi64(0xFF, _mm512_setzero_si512(), x); }
+            inline __m512i shiftDown64(__m512i x) { return _mm512_maskz_unpackhi_epi64(0xFF, x, _mm512_setzero_si512()); }
+
+            inline void clmul(__m512i a, __m512i b, __m512i& lo, __m512i& mid, __m512i& hi)
+            {
+                lo = _mm512_clmulepi64_epi128(a, b, 0x00);
+                mid = _mm512_xor_si512(_mm512_clmulepi64_epi128(a, b, 0x10), _mm512_clmulepi64_epi128(a, b, 0x01));
+                hi = _mm512_clmulepi64_epi128(a, b, 0x11);
+            }
+
+            inline void combine(__m512i& lo, __m512i mid, __m512i& hi)
+            {
+                lo = _mm512_xor_si512(lo, shiftUp64(mid));
+                hi = _mm512_xor_si512(hi, shiftDown64(mid));
+            }
+
+            inline __m512i reduce(__m512i low, __m512i high)
+            {
+                const __m512i modulus = _mm512_set1_epi64(0b10000111);
+
+                auto tmp = _mm512_clmulepi64_epi128(high, modulus, 0x01);
+                low = _mm512_xor_si512(low, shiftUp64(tmp));
+                high = _mm512_xor_si512(high, shiftDown64(tmp));
+
+                tmp = _mm512_clmulepi64_epi128(high, modulus, 0x00);
+                return _mm512_xor_si512(low, tmp);
+            }
+
+            // the mask of the 64 bit words of the first n < 4 blocks.
+            inline __mmask8 tailMask(std::uint64_t n)
+            {
+                return __mmask8((1u << (2 * n)) - 1);
+            }
+
+            // xor the four lanes together. maskz avoids spurious uninitialized
+            // warnings from gcc.
+            inline __m128i sumLanes(__m512i x)
+            {
+                // swap the 256 bit halves and then neighboring lanes.
+                x = _mm512_xor_si512(x, _mm512_maskz_shuffle_i64x2(0xFF, x, x, 0x4E));
+                x = _mm512_xor_si512(x, _mm512_maskz_shuffle_i64x2(0xFF, x, x, 0xB1));
+                return _mm512_maskz_extracti32x4_epi32(0xF, x, 0);
+            }
+
+            void gf128MulBlocks(const block* x, const block* y, std::uint64_t n, block* xy)
+            {
+                auto src0 = reinterpret_cast<const __m128i*>(x);
+                auto src1 = reinterpret_cast<const __m128i*>(y);
+                auto dst = reinterpret_cast<__m128i*>(xy);
+                std::uint64_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    __m512i lo, mid, hi;
+                    clmul(_mm512_loadu_si512(src0 + i), _mm512_loadu_si512(src1 + i), lo, mid, hi);
+                    combine(lo, mid, hi);
+                    _mm512_storeu_si512(dst + i, reduce(lo, hi));
+                }
+                if (i < n)
+                {
+                    auto mask = tailMask(n - i);
+                    __m512i lo, mid, hi;
+                    clmul(_mm512_maskz_loadu_epi64(mask, src0 + i), _mm512_maskz_loadu_epi64(mask, src1 + i), lo, mid, hi);
+                    combine(lo, mid, hi);
+                    _mm512_mask_storeu_epi64(dst + i, mask, reduce(lo, hi));
+                }
+            }
+
+            void gf128MulScalar(const block* x, const block& y, std::uint64_t n, block* xy)
+            {
+                auto src = reinterpret_cast<const __m128i*>(x);
+                auto dst = reinterpret_cast<__m128i*>(xy);
+                auto b = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&y)));
+                std::uint64_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    __m512i lo, mid, hi;
+                    clmul(_mm512_loadu_si512(src + i), b, lo, mid, hi);
+                    combine(lo, mid, hi);
+                    _mm512_storeu_si512(dst + i, reduce(lo, hi));
+                }
+                if (i < n)
+                {
+                    auto mask = tailMask(n - i);
+                    __m512i lo, mid, hi;
+                    clmul(_mm512_maskz_loadu_epi64(mask, src + i), b, lo, mid, hi);
+                    combine(lo, mid, hi);
+                    _mm512_mask_storeu_epi64(dst + i, mask, reduce(lo, hi));
+                }
+            }
+
+            void gf128InnerProduct(const block* x, const block* y, std::uint64_t n, block& xy1, block& xy2)
+            {
+                auto src0 = reinterpret_cast<const __m128i*>(x);
+                auto src1 = reinterpret_cast<const __m128i*>(y);
+
+                // two sets of accumulators so that the xors of one can
+                // overlap the multiplications of the other.
+                __m512i lo[2], mid[2], hi[2];
+                for (int j = 0; j < 2; ++j)
+                    lo[j] = mid[j] = hi[j] = _mm512_setzero_si512();
+
+                std::uint64_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    for (int j = 0; j < 2; ++j)
+                    {
+                        __m512i l, m, h;
+                        clmul(_mm512_loadu_si512(src0 + i + 4 * j), _mm512_loadu_si512(src1 + i + 4 * j), l, m, h);
+                        lo[j] = _mm512_xor_si512(lo[j], l);
+                        mid[j] = _mm512_xor_si512(mid[j], m);
+                        hi[j] = _mm512_xor_si512(hi[j], h);
+                    }
+                }
+                for (; i < n; i += 4)
+                {
+                    auto mask = n - i < 4 ? tailMask(n - i) : __mmask8(0xFF);
+                    __m512i l, m, h;
+                    clmul(_mm512_maskz_loadu_epi64(mask, src0 + i), _mm512_maskz_loadu_epi64(mask, src1 + i), l, m, h);
+                    lo[0] = _mm512_xor_si512(lo[0], l);
+                    mid[0] = _mm512_xor_si512(mid[0], m);
+                    hi[0] = _mm512_xor_si512(hi[0], h);
+                }
+
+                auto l = _mm512_xor_si512(lo[0], lo[1]);
+                auto h = _mm512_xor_si512(hi[0], hi[1]);
+                combine(l, _mm512_xor_si512(mid[0], mid[1]), h);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&xy1), sumLanes(l));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&xy2), sumLanes(h));
+            }
+
+            const Gf128Kernels gf128Kernels{ nullptr, nullptr, gf128MulBlocks, gf128MulScalar, gf128InnerProduct };
+        }
+
+        const Gf128Kernels* getVpclmulGf128Kernels() { return &gf128Kernels; }
+    }
+}
+
+#else
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        const Gf128Kernels* getVpclmulGf128Kernels() { return nullptr; }
+    }
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <cryptoTools/Crypto/AES.h>
+#include <algorithm>
 #include <array>
 #include <cstring>
 
@@ -66,7 +67,7 @@ namespace osuCrypto {
         {
             block keyRcon = [&]() {
 #ifdef OC_ENABLE_AESNI
-                if constexpr (type == AESTypes::NI)
+                if constexpr (type == AESTypes::NI || type == AESTypes::VAES)
                     return _mm_aeskeygenassist_si128(key, imm8);
 #endif
 #if defined(OC_ENABLE_PORTABLE_AES) || defined(ENABLE_ARM_AES)
@@ -287,7 +288,7 @@ namespace osuCrypto {
             else
 #endif
 #ifdef OC_ENABLE_AESNI
-                if constexpr (type == AESTypes::NI)
+                if constexpr (type == AESTypes::NI || type == AESTypes::VAES)
                 {
                     state_ = _mm_aesimc_si128(state_);
                 }
@@ -398,19 +399,108 @@ namespace osuCrypto {
         }
 
         template<AESTypes type>
-        void AESDec<type>::ecbDecBlock(const block& ciphertext, block& plaintext)
+        void AESDec<type>::cbcDecBlocks(block iv, span<const block> ciphertext, span<block> plaintext) const
         {
-            plaintext = firstFn(ciphertext, mRoundKey[0]);
-            plaintext = roundFn(plaintext, mRoundKey[1]);
-            plaintext = roundFn(plaintext, mRoundKey[2]);
-            plaintext = roundFn(plaintext, mRoundKey[3]);
-            plaintext = roundFn(plaintext, mRoundKey[4]);
-            plaintext = roundFn(plaintext, mRoundKey[5]);
-            plaintext = roundFn(plaintext, mRoundKey[6]);
-            plaintext = roundFn(plaintext, mRoundKey[7]);
-            plaintext = roundFn(plaintext, mRoundKey[8]);
-            plaintext = roundFn(plaintext, mRoundKey[9]);
-            plaintext = finalFn(plaintext, mRoundKey[10]);
+            if (ciphertext.size() != plaintext.size())
+                throw RTE_LOC;
+            assert(
+                ciphertext.data() == plaintext.data() ||
+                ciphertext.data() + ciphertext.size() <= plaintext.data() ||
+                plaintext.data() + plaintext.size() <= ciphertext.data());
+
+            // the ciphertext is copied out a step at a time before it is
+            // decrypted so that the chaining values survive an in place
+            // decryption. ct[0] holds the previous ciphertext block.
+            constexpr u64 step = type == AESTypes::VAES ? 32 : 8;
+            block ct[step + 1], pt[step];
+            ct[0] = iv;
+
+            auto n = ciphertext.size();
+            auto src = ciphertext.data();
+            auto dst = plaintext.data();
+            u64 i = 0;
+            for (; i + step <= n; i += step)
+            {
+                for (u64 j = 0; j < step; ++j)
+                    ct[j + 1] = src[i + j];
+                ecbDecBlocks<step>(ct + 1, pt);
+                for (u64 j = 0; j < step; ++j)
+                    dst[i + j] = pt[j] ^ ct[j];
+                ct[0] = ct[step];
+            }
+
+            auto rem = n - i;
+            for (u64 j = 0; j < rem; ++j)
+                ct[j + 1] = src[i + j];
+            ecbDecBlocks(ct + 1, rem, pt);
+            for (u64 j = 0; j < rem; ++j)
+                dst[i + j] = pt[j] ^ ct[j];
+        }
+
+        template<AESTypes type>
+        void AES<type>::ecbEncCounterMode(block baseIdx, span<block> ciphertext, u64 numThreads) const
+        {
+            parallelFor(ciphertext.size(), parallelChunkSize, numThreads, [&](u64 begin, u64 end) {
+                ecbEncCounterMode(baseIdx.add_epi64(block(begin)), end - begin, ciphertext.data() + begin);
+                });
+        }
+
+        template<AESTypes type>
+        void AES<type>::ecbEncCounterMode(block baseIdx, span<block> ciphertext, const TaskScheduler& schedule, u64 numTasks) const
+        {
+            parallelFor(ciphertext.size(), parallelChunkSize, numTasks, schedule, [&](u64 begin, u64 end) {
+                ecbEncCounterMode(baseIdx.add_epi64(block(begin)), end - begin, ciphertext.data() + begin);
+                });
+        }
+
+        template<AESTypes type>
+        void AES<type>::ctrEncBlocks(block baseIdx, span<const block> input, span<block> output) const
+        {
+            if (input.size() != output.size())
+                throw RTE_LOC;
+
+            // the key stream is generated a chunk at a time so that it stays in the L1 cache.
+            constexpr u64 chunkSize = 128;
+            AlignedArray<block, chunkSize> keyStream;
+            for (u64 i = 0; i < input.size(); i += chunkSize)
+            {
+                auto n = std::min<u64>(chunkSize, input.size() - i);
+                auto src = input.data() + i;
+                auto dst = output.data() + i;
+                ecbEncCounterMode(baseIdx.add_epi64(block(i)), n, keyStream.data());
+                for (u64 j = 0; j < n; ++j)
+                    dst[j] = src[j] ^ keyStream[j];
+            }
+        }
+
+        template<AESTypes type>
+        void AES<type>::ctrEncBlocks(block baseIdx, span<const block> input, span<block> output, u64 numThreads) const
+        {
+            if (input.size() != output.size())
+                throw RTE_LOC;
+            parallelFor(input.size(), parallelChunkSize, numThreads, [&](u64 begin, u64 end) {
+                ctrEncBlocks(baseIdx.add_epi64(block(begin)), input.subspan(begin, end - begin), output.subspan(begin, end - begin));
+                });
+        }
+
+        template<AESTypes type>
+        void AES<type>::hashBlocks(span<const block> plaintext, span<block> ciphertext, u64 numThreads) const
+        {
+            if (plaintext.size() != ciphertext.size())
+                throw RTE_LOC;
+            parallelFor(plaintext.size(), parallelChunkSize, numThreads, [&](u64 begin, u64 end) {
+                hashBlocks(plaintext.data() + begin, end - begin, ciphertext.data() + begin);
+                });
+        }
+
+        template<AESTypes type>
+        void AES<type>::hashBlocks(span<const block> plaintext, span<block> ciphertext, const TaskScheduler& schedule, u64 numTasks) const
+        {
+            if (plaintext.size() != ciphertext.size())
+                throw RTE_LOC;
+            parallelFor(plaintext.size(), parallelChunkSize, numTasks, schedule, [&](u64 begin, u64 end) {
+                hashBlocks(plaintext.data() + begin, end - begin, ciphertext.data() + begin);
+                });
         }
     }
 
@@ -424,6 +514,11 @@ namespace osuCrypto {
     template class details::AESDec<details::NI>;
 #endif
 
+#ifdef OC_ENABLE_VAES
+    template class details::AES<details::VAES>;
+    template class details::AESDec<details::VAES>;
+#endif
+
 #ifdef ENABLE_ARM_AES
     template class details::AES<details::ARM>;
     template class details::AESDec<details::ARM>;
@@ -2,10 +2,15 @@
 // This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
 #include <cryptoTools/Common/Defines.h>
 #include <cryptoTools/Common/Aligned.h>
+#include <cryptoTools/Common/ParallelFor.h>
 #include <type_traits>
 #include <cassert>
 #include <utility>
 
+#ifdef OC_ENABLE_VAES
+#include <immintrin.h>
+#endif
+
 #ifdef ARM
 #undef ARM
 #endif
@@ -18,12 +23,17 @@ namespace osuCrypto {
 		{
 			NI,
 			Portable,
-			ARM
+			ARM,
+			VAES
 		};
 
 		// templated implementation of AES 128. Each type has a different
 		// implmentation of the round function which maps to native hardware 
-		// for x86 AES NI and ARM64 platforms.
+		// for x86 AES NI and ARM64 platforms. VAES uses the AES NI round
+		// function for single blocks and the 256/512 bit VAES instructions,
+		// which encrypt 2/4 blocks per instruction, for the bulk operations.
+		// With OC_ENABLE_CPU_DISPATCH the bulk operations of the other types
+		// forward to a faster kernel if cpuid reports one, see CpuDispatch.h.
 		template<AESTypes type>
 		class AES
 		{
@@ -86,6 +96,31 @@ namespace osuCrypto {
 			// Encryption is performed in ECB mode.
 			void ecbEncCounterMode(block baseIdx, span<block> ciphertext) const;
 
+			// The number of blocks a thread processes at a time in the multi-threaded
+			// functions. 2^14 blocks is 256KiB, which fits in the L2 cache.
+			static const u64 parallelChunkSize = 1ull << 14;
+
+			// Multi-threaded ecbEncCounterMode(baseIdx, ciphertext) using numThreads
+			// threads, including the caller. 0 uses all hardware threads. The output
+			// is identical to the single threaded version.
+			void ecbEncCounterMode(block baseIdx, span<block> ciphertext, u64 numThreads) const;
+
+			// Multi-threaded ecbEncCounterMode(baseIdx, ciphertext) where numTasks
+			// helpers are run by schedule, e.g. a thread pool, along with the caller.
+			void ecbEncCounterMode(block baseIdx, span<block> ciphertext, const TaskScheduler& schedule, u64 numTasks) const;
+
+
+			///////////////////////////////////////////////
+			// CTR mode
+
+			// for i = 0,...,input.size()-1, set output[i] = input[i] ^ AES.Enc(baseIdx + i).
+			// CTR mode decryption is the same operation. input and output may be equal.
+			void ctrEncBlocks(block baseIdx, span<const block> input, span<block> output) const;
+
+			// Multi-threaded ctrEncBlocks(baseIdx, input, output) using numThreads
+			// threads, including the caller. 0 uses all hardware threads.
+			void ctrEncBlocks(block baseIdx, span<const block> input, span<block> output, u64 numThreads) const;
+
 
 			///////////////////////////////////////////////
 			// Tweakable correlation robust hash function.
@@ -132,6 +167,14 @@ namespace osuCrypto {
 			// H(x) = AES(x) + x.
 			inline void hashBlocks(const block* plaintext, u64 blockLength, block* ciphertext) const;
 
+			// Multi-threaded hashBlocks(plaintext, ciphertext) using numThreads threads,
+			// including the caller. 0 uses all hardware threads.
+			void hashBlocks(span<const block> plaintext, span<block> ciphertext, u64 numThreads) const;
+
+			// Multi-threaded hashBlocks(plaintext, ciphertext) where numTasks helpers
+			// are run by schedule, e.g. a thread pool, along with the caller.
+			void hashBlocks(span<const block> plaintext, span<block> ciphertext, const TaskScheduler& schedule, u64 numTasks) const;
+
 			// The expanded key.
 			std::array<block, rounds + 1> mRoundKey;
 
@@ -427,6 +470,98 @@ namespace osuCrypto {
 #undef OC_AES_HASH_CAT2
 		}
 
+#ifdef OC_ENABLE_VAES
+
+		// Encrypts blocks with the VAES instructions. The first blocks / 4 * 4 blocks
+		// are processed four at a time in zmm registers. The remaining (at most three)
+		// blocks use one ymm and/or one xmm register. All lanes are interleaved
+		// round by round so that the AES pipeline stays full. If xorInput is set
+		// the plaintext is XORed into the output, i.e. H(x) = AES(x) + x.
+		template<u64 blocks, bool xorInput>
+		OC_FORCEINLINE void vaesEncBlocks(
+			const AES<VAES>& aes,
+			const block* plaintext,
+			block* ciphertext)
+		{
+			static_assert(blocks >= 1 && blocks <= 32);
+			static_assert(AES<VAES>::rounds == 10);
+			constexpr u64 rounds = AES<VAES>::rounds;
+			constexpr u64 n512 = blocks / 4;
+			constexpr bool has256 = (blocks % 4) >= 2;
+			constexpr bool has128 = (blocks % 2) == 1;
+			constexpr u64 offset256 = n512 * 4;
+			constexpr u64 offset128 = offset256 + (has256 ? 2 : 0);
+
+			if constexpr (n512 != 0)
+			{
+				__m512i key[rounds + 1];
+				__m512i x[n512];
+				// the maskz form avoids gcc's spurious -Wmaybe-uninitialized
+				// from _mm512_broadcast_i32x4.
+				for (u64 i = 0; i <= rounds; ++i)
+					key[i] = _mm512_maskz_broadcast_i32x4(0xFFFF, aes.mRoundKey[i]);
+
+				for (u64 j = 0; j < n512; ++j)
+					x[j] = _mm512_xor_si512(_mm512_loadu_si512(plaintext + 4 * j), key[0]);
+				for (u64 i = 1; i < rounds; ++i)
+					for (u64 j = 0; j < n512; ++j)
+						x[j] = _mm512_aesenc_epi128(x[j], key[i]);
+				for (u64 j = 0; j < n512; ++j)
+				{
+					x[j] = _mm512_aesenclast_epi128(x[j], key[rounds]);
+					if constexpr (xorInput)
+						x[j] = _mm512_xor_si512(x[j], _mm512_loadu_si512(plaintext + 4 * j));
+					_mm512_storeu_si512(ciphertext + 4 * j, x[j]);
+				}
+			}
+
+			if constexpr (has256)
+			{
+				auto in = _mm256_loadu_si256((const __m256i*)(plaintext + offset256));
+				auto y = _mm256_xor_si256(in, _mm256_broadcastsi128_si256(aes.mRoundKey[0]));
+				for (u64 i = 1; i < rounds; ++i)
+					y = _mm256_aesenc_epi128(y, _mm256_broadcastsi128_si256(aes.mRoundKey[i]));
+				y = _mm256_aesenclast_epi128(y, _mm256_broadcastsi128_si256(aes.mRoundKey[rounds]));
+				if constexpr (xorInput)
+					y = _mm256_xor_si256(y, in);
+				_mm256_storeu_si256((__m256i*)(ciphertext + offset256), y);
+			}
+
+			if constexpr (has128)
+			{
+				block x = plaintext[offset128] ^ aes.mRoundKey[0];
+				for (u64 i = 1; i < rounds; ++i)
+					x = _mm_aesenc_si128(x, aes.mRoundKey[i]);
+				x = _mm_aesenclast_si128(x, aes.mRoundKey[rounds]);
+				if constexpr (xorInput)
+					x = x ^ plaintext[offset128];
+				ciphertext[offset128] = x;
+			}
+		}
+
+		template<u64 blocks, std::enable_if_t<(blocks >= 2), int> = 0>
+		OC_FORCEINLINE void aesEcbEncBlocksSmall(
+			const AES<VAES>& aes,
+			const block* plaintext,
+			block* ciphertext,
+			std::integral_constant<u64, blocks>)
+		{
+			static_assert(blocks <= 8);
+			vaesEncBlocks<blocks, false>(aes, plaintext, ciphertext);
+		}
+
+		template<u64 blocks, std::enable_if_t<(blocks >= 2), int> = 0>
+		OC_FORCEINLINE void aesHashBlocksSmall(
+			const AES<VAES>& aes,
+			const block* plaintext,
+			block* ciphertext,
+			std::integral_constant<u64, blocks>)
+		{
+			static_assert(blocks <= 8);
+			vaesEncBlocks<blocks, true>(aes, plaintext, ciphertext);
+		}
+#endif
+
 		template<AESTypes type>
 		template<u64 blocks>
 		OC_FORCEINLINE void AES<type>::ecbEncBlocks(const block* plaintext, block* ciphertext) const
@@ -438,6 +573,12 @@ namespace osuCrypto {
 			{
 				aesEcbEncBlocksSmall(*this, plaintext, ciphertext, std::integral_constant<u64, blocks>{});
 			}
+#ifdef OC_ENABLE_VAES
+			else if constexpr (type == AESTypes::VAES && blocks <= 32)
+			{
+				vaesEncBlocks<blocks, false>(*this, plaintext, ciphertext);
+			}
+#endif
 			else if constexpr (blocks <= 16)
 			{
 				oc::AlignedArray<block, blocks> buffer;
@@ -488,10 +629,33 @@ namespace osuCrypto {
 				plaintext == ciphertext || 
 				isOverlapping(plaintext, blockLength, ciphertext, blockLength) == false);
 
+#ifdef OC_ENABLE_CPU_DISPATCH
+			if constexpr (type != AESTypes::VAES)
+			{
+				auto& kernels = gCpuKernels.mAes;
+				if (kernels.mEcbEncBlocks && blockLength >= kernels.mMinBlocks)
+					return kernels.mEcbEncBlocks(mRoundKey.data(), plaintext, blockLength, ciphertext);
+			}
+#endif
+
 			const u64 step = 8;
 			u64 idx = 0;
 
-			if constexpr (type == AESTypes::NI)
+			if constexpr (type == AESTypes::VAES)
+			{
+				constexpr u64 step32 = 32;
+				for (; idx + step32 <= blockLength; idx += step32)
+				{
+					ecbEncBlocks<step32>(plaintext + idx, ciphertext + idx);
+				}
+
+				constexpr u64 step16 = 16;
+				for (; idx + step16 <= blockLength; idx += step16)
+				{
+					ecbEncBlocks<step16>(plaintext + idx, ciphertext + idx);
+				}
+			}
+			else if constexpr (type == AESTypes::NI)
 			{
 #define OC_AES_DO_STEP_8(offset) \
 				ecbEncBlocks<step>(plaintext + idx + (offset) * step, ciphertext + idx + (offset) * step)
@@ -584,11 +748,44 @@ namespace osuCrypto {
 		template<AESTypes type>
 		inline void AES<type>::ecbEncCounterMode(block baseIdx, u64 blockLength, block* ciphertext) const
 		{
+#ifdef OC_ENABLE_CPU_DISPATCH
+			if constexpr (type != AESTypes::VAES)
+			{
+				auto& kernels = gCpuKernels.mAes;
+				if (kernels.mEcbEncCounterMode && blockLength >= kernels.mMinBlocks)
+					return kernels.mEcbEncCounterMode(mRoundKey.data(), baseIdx, blockLength, ciphertext);
+			}
+#endif
 
 			constexpr u64 step = 8;
 			u64 idx = 0;
 			oc::AlignedArray<block, step> plaintext;
 
+#ifdef OC_ENABLE_VAES
+			if constexpr (type == AESTypes::VAES)
+			{
+				// the counters for 32 blocks are generated four at a time by
+				// adding {idx, idx + 1, idx + 2, idx + 3} to the low 64 bits.
+				constexpr u64 step32 = 32;
+				oc::AlignedArray<block, step32> counters;
+				const __m512i base = _mm512_add_epi64(
+					_mm512_maskz_broadcast_i32x4(0xFFFF, baseIdx),
+					_mm512_set_epi64(0, 3, 0, 2, 0, 1, 0, 0));
+				const __m512i four = _mm512_set_epi64(0, 4, 0, 4, 0, 4, 0, 4);
+
+				for (; idx + step32 <= blockLength; idx += step32)
+				{
+					__m512i ctr = _mm512_add_epi64(base, _mm512_set_epi64(0, idx, 0, idx, 0, idx, 0, idx));
+					for (u64 j = 0; j < step32; j += 4)
+					{
+						_mm512_store_si512(counters.data() + j, ctr);
+						ctr = _mm512_add_epi64(ctr, four);
+					}
+					ecbEncBlocks<step32>(counters.data(), ciphertext + idx);
+				}
+			}
+#endif
+
 			for (; idx + step <= blockLength; idx += step)
 			{
 				plaintext[0] = baseIdx.add_epi64(block(idx + 0));
@@ -723,6 +920,12 @@ namespace osuCrypto {
 			{
 				aesHashBlocksSmall(*this, plaintext, ciphertext, std::integral_constant<u64, blocks>{});
 			}
+#ifdef OC_ENABLE_VAES
+			else if constexpr (type == AESTypes::VAES && blocks <= 32)
+			{
+				vaesEncBlocks<blocks, true>(*this, plaintext, ciphertext);
+			}
+#endif
 			else if constexpr (blocks <= 16)
 			{
 				oc::AlignedArray<block, blocks> buff;
@@ -763,10 +966,33 @@ namespace osuCrypto {
 		template<AESTypes type>
 		inline void AES<type>::hashBlocks(const block* plaintext, u64 blockLength, block* ciphertext) const
 		{
+#ifdef OC_ENABLE_CPU_DISPATCH
+			if constexpr (type != AESTypes::VAES)
+			{
+				auto& kernels = gCpuKernels.mAes;
+				if (kernels.mHashBlocks && blockLength >= kernels.mMinBlocks)
+					return kernels.mHashBlocks(mRoundKey.data(), plaintext, blockLength, ciphertext);
+			}
+#endif
+
 			const u64 step = 8;
 			u64 idx = 0;
 
-			if constexpr (type == AESTypes::NI)
+			if constexpr (type == AESTypes::VAES)
+			{
+				constexpr u64 step32 = 32;
+				for (; idx + step32 <= blockLength; idx += step32)
+				{
+					hashBlocks<step32>(plaintext + idx, ciphertext + idx);
+				}
+
+				constexpr u64 step16 = 16;
+				for (; idx + step16 <= blockLength; idx += step16)
+				{
+					hashBlocks<step16>(plaintext + idx, ciphertext + idx);
+				}
+			}
+			else if constexpr (type == AESTypes::NI)
 			{
 #define OC_AES_DO_HASH_STEP_8(offset) \
 				hashBlocks<step>(plaintext + idx + (offset) * step, ciphertext + idx + (offset) * step)
@@ -882,6 +1108,32 @@ namespace osuCrypto {
 			return _mm_aesenclast_si128(state, roundKey);
 		}
 
+#ifdef OC_ENABLE_VAES
+		template<>
+		OC_FORCEINLINE block AES<VAES>::firstFn(block state, const block& roundKey)
+		{
+			return state ^ roundKey;
+		}
+
+		template<>
+		OC_FORCEINLINE block AES<VAES>::roundFn(block state, const block& roundKey)
+		{
+			return _mm_aesenc_si128(state, roundKey);
+		}
+
+		template<>
+		OC_FORCEINLINE block AES<VAES>::penultimateFn(block state, const block& roundKey)
+		{
+			return roundFn(state, roundKey);
+		}
+
+		template<>
+		OC_FORCEINLINE block AES<VAES>::finalFn(block state, const block& roundKey)
+		{
+			return _mm_aesenclast_si128(state, roundKey);
+		}
+#endif
+
 #elif defined(ENABLE_ARM_AES)
 
 		template<>
@@ -932,15 +1184,40 @@ namespace osuCrypto {
 			}
 
 			void setKey(const block& userKey);
-			void ecbDecBlock(const block& ciphertext, block& plaintext);
 
-			block ecbDecBlock(const block& ciphertext)
+			// set plaintext = AES.Dec(ciphertext). Decryption is performed in ECB mode.
+			void ecbDecBlock(const block& ciphertext, block& plaintext) const
+			{
+				ecbDecBlocks<1>(&ciphertext, &plaintext);
+			}
+
+			// return AES.Dec(ciphertext). Decryption is performed in ECB mode.
+			block ecbDecBlock(const block& ciphertext) const
 			{
 				block ret;
 				ecbDecBlock(ciphertext, ret);
 				return ret;
 			}
 
+			// for i = 0,...,blocks-1, set plaintext[i] = AES.Dec(ciphertext[i]).
+			// The blocks are interleaved round by round to keep the AES pipeline full.
+			template<u64 blocks>
+			OC_FORCEINLINE void ecbDecBlocks(const block* ciphertext, block* plaintext) const;
+
+			// for i = 0,...,blocks-1, set plaintext[i] = AES.Dec(ciphertext[i]).
+			// Decryption is performed in ECB mode.
+			inline void ecbDecBlocks(const block* ciphertext, u64 blocks, block* plaintext) const;
+
+			// for i = 0,...,ciphertext.size()-1, set plaintext[i] = AES.Dec(ciphertext[i]).
+			// Decryption is performed in ECB mode.
+			inline void ecbDecBlocks(span<const block> ciphertext, span<block> plaintext) const;
+
+			// CBC mode decryption, for i = 0,...,ciphertext.size()-1, set
+			// plaintext[i] = AES.Dec(ciphertext[i]) ^ ciphertext[i-1] where
+			// ciphertext[-1] = iv. Unlike encryption, CBC decryption is pipelined.
+			// ciphertext and plaintext may be equal.
+			void cbcDecBlocks(block iv, span<const block> ciphertext, span<block> plaintext) const;
+
 			std::array<block, rounds + 1> mRoundKey;
 
 
@@ -1022,9 +1299,159 @@ namespace osuCrypto {
 		}
 #endif
 
+#ifdef OC_ENABLE_VAES
+
+		template<>
+		inline block AESDec<VAES>::firstFn(block state, const block& roundKey)
+		{
+			return state ^ roundKey;
+		}
+
+		template<>
+		inline block AESDec<VAES>::roundFn(block state, const block& roundKey)
+		{
+			return _mm_aesdec_si128(state, roundKey);
+		}
+
+		template<>
+		inline block AESDec<VAES>::finalFn(block state, const block& roundKey)
+		{
+			return _mm_aesdeclast_si128(state, roundKey);
+		}
+
+		// Decrypts blocks / 4 * 4 blocks four at a time in zmm registers and
+		// the remaining (at most three) blocks in xmm registers.
+		template<u64 blocks>
+		OC_FORCEINLINE void vaesDecBlocks(
+			const AESDec<VAES>& aes,
+			const block* ciphertext,
+			block* plaintext)
+		{
+			static_assert(blocks >= 4 && blocks <= 32);
+			constexpr u64 rounds = AESDec<VAES>::rounds;
+			constexpr u64 n512 = blocks / 4;
+			constexpr u64 n128 = blocks % 4;
+
+			__m512i key[rounds + 1];
+			__m512i x[n512];
+			// maskz avoids a spurious uninitialized warning from gcc.
+			for (u64 i = 0; i <= rounds; ++i)
+				key[i] = _mm512_maskz_broadcast_i32x4(0xFFFF, aes.mRoundKey[i]);
+
+			for (u64 j = 0; j < n512; ++j)
+				x[j] = _mm512_xor_si512(_mm512_loadu_si512(ciphertext + 4 * j), key[0]);
+			for (u64 i = 1; i < rounds; ++i)
+				for (u64 j = 0; j < n512; ++j)
+					x[j] = _mm512_aesdec_epi128(x[j], key[i]);
+			for (u64 j = 0; j < n512; ++j)
+				x[j] = _mm512_aesdeclast_epi128(x[j], key[rounds]);
+
+			if constexpr (n128 != 0)
+			{
+				// computed before the zmm stores in case the decryption is in place.
+				block y[n128];
+				for (u64 j = 0; j < n128; ++j)
+					y[j] = ciphertext[4 * n512 + j] ^ aes.mRoundKey[0];
+				for (u64 i = 1; i < rounds; ++i)
+					for (u64 j = 0; j < n128; ++j)
+						y[j] = _mm_aesdec_si128(y[j], aes.mRoundKey[i]);
+				for (u64 j = 0; j < n128; ++j)
+					plaintext[4 * n512 + j] = _mm_aesdeclast_si128(y[j], aes.mRoundKey[rounds]);
+			}
+
+			for (u64 j = 0; j < n512; ++j)
+				_mm512_storeu_si512(plaintext + 4 * j, x[j]);
+		}
+#endif
+
+		template<AESTypes type>
+		template<u64 blocks>
+		OC_FORCEINLINE void AESDec<type>::ecbDecBlocks(const block* ciphertext, block* plaintext) const
+		{
+#ifdef OC_ENABLE_VAES
+			if constexpr (type == AESTypes::VAES && blocks >= 4 && blocks <= 32)
+			{
+				vaesDecBlocks<blocks>(*this, ciphertext, plaintext);
+			}
+			else
+#endif
+			if constexpr (blocks <= 16)
+			{
+				block x[blocks];
+				for (u64 j = 0; j < blocks; ++j)
+					x[j] = firstFn(ciphertext[j], mRoundKey[0]);
+
+				for (u64 i = 1; i < rounds; ++i)
+				{
+					for (u64 j = 0; j < blocks; ++j)
+						x[j] = roundFn(x[j], mRoundKey[i]);
+				}
+
+				for (u64 j = 0; j < blocks; ++j)
+					plaintext[j] = finalFn(x[j], mRoundKey[rounds]);
+			}
+			else
+			{
+				ecbDecBlocks(ciphertext, blocks, plaintext);
+			}
+		}
+
+		template<AESTypes type>
+		inline void AESDec<type>::ecbDecBlocks(const block* ciphertext, u64 blockLength, block* plaintext) const
+		{
+			assert(
+				ciphertext == plaintext ||
+				ciphertext + blockLength <= plaintext ||
+				plaintext + blockLength <= ciphertext);
+
+			const u64 step = 8;
+			u64 idx = 0;
+
+#ifdef OC_ENABLE_VAES
+			if constexpr (type == AESTypes::VAES)
+			{
+				constexpr u64 step32 = 32;
+				for (; idx + step32 <= blockLength; idx += step32)
+					ecbDecBlocks<step32>(ciphertext + idx, plaintext + idx);
+			}
+#endif
+
+			for (; idx + step <= blockLength; idx += step)
+			{
+				ecbDecBlocks<step>(ciphertext + idx, plaintext + idx);
+			}
+
+			i32 misalignment = blockLength % step;
+			switch (misalignment) {
+#define SWITCH_CASE(n) \
+		    case n: \
+		        ecbDecBlocks<n>(ciphertext + idx, plaintext + idx); \
+		        break
+				SWITCH_CASE(1);
+				SWITCH_CASE(2);
+				SWITCH_CASE(3);
+				SWITCH_CASE(4);
+				SWITCH_CASE(5);
+				SWITCH_CASE(6);
+				SWITCH_CASE(7);
+#undef SWITCH_CASE
+			}
+		}
+
+		template<AESTypes type>
+		inline void AESDec<type>::ecbDecBlocks(span<const block> ciphertext, span<block> plaintext) const
+		{
+			if (ciphertext.size() != plaintext.size())
+				throw RTE_LOC;
+			ecbDecBlocks(ciphertext.data(), ciphertext.size(), plaintext.data());
+		}
+
 	}
 
-#ifdef OC_ENABLE_AESNI
+#ifdef OC_ENABLE_VAES
+	using AES = details::AES<details::VAES>;
+	using AESDec = details::AESDec<details::VAES>;
+#elif defined(OC_ENABLE_AESNI)
 	using AES = details::AES<details::NI>;
 	using AESDec = details::AESDec<details::NI>;
 #elif defined(ENABLE_ARM_AES)
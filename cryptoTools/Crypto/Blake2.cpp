@@ -1,13 +1,455 @@
 #include <cryptoTools/Crypto/Blake2.h>
+#include <cryptoTools/Common/ParallelFor.h>
+#include <algorithm>
+#include <thread>
+
+#ifdef OC_ENABLE_AVX2
+#include <immintrin.h>
+#endif
 
 namespace osuCrypto
 {
 	const u64 Blake2::HashSize;
 	const u64 Blake2::MaxHashSize;
+	const u64 Blake2bp::HashSize;
+	const u64 Blake2bp::MaxHashSize;
+	const u64 Blake2bp::parallelThreshold;
+	const u64 Blake2Xb::MaxOutputLength;
 
     const Blake2& Blake2::operator=(const Blake2& src)
     {
         state = src.state;
         return *this;
     }
+
+    namespace
+    {
+        void hashEach(const u8* in, u64 inLength, u64 n, u8* out, u64 outLength)
+        {
+            blake2b_state state;
+            for (u64 i = 0; i < n; ++i)
+            {
+                blake2b_init(&state, outLength);
+                blake2b_update(&state, in + i * inLength, inLength);
+                blake2b_final(&state, out + i * outLength, outLength);
+            }
+        }
+
+#ifdef OC_ENABLE_AVX2
+
+        const u64 blake2bIV[8] =
+        {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+            0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+            0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+
+        constexpr u8 blake2bSigma[12][16] =
+        {
+            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+            { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+            { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+            {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+            {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+            {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+            { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+            { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+            {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+            { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+            {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+            { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+        };
+
+#ifdef OC_ENABLE_AVX512
+        // 8 blake2b states, one per 64 bit lane.
+        struct Lanes8
+        {
+            using V = __m512i;
+            static const u64 size = 8;
+
+            static V add(V a, V b) { return _mm512_add_epi64(a, b); }
+            static V xor_(V a, V b) { return _mm512_xor_si512(a, b); }
+            static V set1(u64 x) { return _mm512_set1_epi64((long long)x); }
+            static V load(const u64* p) { return _mm512_load_si512((const void*)p); }
+            static void store(u64* p, V x) { _mm512_store_si512((void*)p, x); }
+
+            // maskz avoids a spurious uninitialized warning from gcc.
+            template<int r>
+            static V rotr(V x) { return _mm512_maskz_ror_epi64(0xFF, x, r); }
+        };
+#endif
+
+        // 4 blake2b states, one per 64 bit lane.
+        struct Lanes4
+        {
+            using V = __m256i;
+            static const u64 size = 4;
+
+            static V add(V a, V b) { return _mm256_add_epi64(a, b); }
+            static V xor_(V a, V b) { return _mm256_xor_si256(a, b); }
+            static V set1(u64 x) { return _mm256_set1_epi64x((long long)x); }
+            static V load(const u64* p) { return _mm256_load_si256((const __m256i*)p); }
+            static void store(u64* p, V x) { _mm256_store_si256((__m256i*)p, x); }
+
+            // the byte aligned rotations are shuffles and 63 is a left shift by one.
+            template<int r>
+            static V rotr(V x)
+            {
+                if (r == 32)
+                    return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+                if (r == 24)
+                    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+                        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+                if (r == 16)
+                    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+                        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+                return _mm256_xor_si256(_mm256_srli_epi64(x, r), _mm256_add_epi64(x, x));
+            }
+        };
+
+        // the lanes used when hashing many independent messages.
+#ifdef OC_ENABLE_AVX512
+        using BatchLanes = Lanes8;
+#else
+        using BatchLanes = Lanes4;
+#endif
+
+        template<typename L, typename V = typename L::V>
+        OC_FORCEINLINE void G(V& a, V& b, V& c, V& d, V x, V y)
+        {
+            a = L::add(L::add(a, b), x);
+            d = L::template rotr<32>(L::xor_(d, a));
+            c = L::add(c, d);
+            b = L::template rotr<24>(L::xor_(b, c));
+            a = L::add(L::add(a, b), y);
+            d = L::template rotr<16>(L::xor_(d, a));
+            c = L::add(c, d);
+            b = L::template rotr<63>(L::xor_(b, c));
+        }
+
+        // the message schedule is a template parameter so that the state and
+        // message words can stay in registers.
+        template<typename L, u64 r, typename V = typename L::V>
+        OC_FORCEINLINE void round(V* v, const V* m)
+        {
+            constexpr auto s = blake2bSigma[r];
+            G<L>(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+            G<L>(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+            G<L>(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+            G<L>(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+            G<L>(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+            G<L>(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+            G<L>(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+            G<L>(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+        }
+
+        // loads word j of lane k from src[k] + 8 * j into x[j], for j < n.
+        template<typename L, typename V = typename L::V>
+        OC_FORCEINLINE void transposeIn(V* x, const u8* const* src, u64 n)
+        {
+            alignas(64) u64 words[16][L::size];
+            for (u64 k = 0; k < L::size; ++k)
+                for (u64 j = 0; j < n; ++j)
+                    memcpy(&words[j][k], src[k] + 8 * j, 8);
+            for (u64 j = 0; j < n; ++j)
+                x[j] = L::load(words[j]);
+        }
+
+        // the inverse of transposeIn.
+        template<typename L, typename V = typename L::V>
+        OC_FORCEINLINE void transposeOut(u8* const* dst, const V* x, u64 n)
+        {
+            alignas(64) u64 words[16][L::size];
+            for (u64 j = 0; j < n; ++j)
+                L::store(words[j], x[j]);
+            for (u64 k = 0; k < L::size; ++k)
+                for (u64 j = 0; j < n; ++j)
+                    memcpy(dst[k] + 8 * j, &words[j][k], 8);
+        }
+
+        // the blake2b compression function of the 128 byte blocks[k] applied
+        // to each lane. t is the byte counter and last is set for the final
+        // block, which are the same in every lane. Messages are assumed to be
+        // shorter than 2^64 bytes.
+        template<typename L, typename V = typename L::V>
+        void compress(V* h, const u8* const* blocks, u64 t, bool last)
+        {
+            V m[16], v[16];
+            transposeIn<L>(m, blocks, 16);
+
+            for (u64 i = 0; i < 8; ++i)
+                v[i] = h[i];
+            for (u64 i = 0; i < 4; ++i)
+                v[8 + i] = L::set1(blake2bIV[i]);
+            v[12] = L::set1(blake2bIV[4] ^ t);
+            v[13] = L::set1(blake2bIV[5]);
+            v[14] = L::set1(blake2bIV[6] ^ (last ? ~0ull : 0));
+            v[15] = L::set1(blake2bIV[7]);
+
+            round<L, 0>(v, m);
+            round<L, 1>(v, m);
+            round<L, 2>(v, m);
+            round<L, 3>(v, m);
+            round<L, 4>(v, m);
+            round<L, 5>(v, m);
+            round<L, 6>(v, m);
+            round<L, 7>(v, m);
+            round<L, 8>(v, m);
+            round<L, 9>(v, m);
+            round<L, 10>(v, m);
+            round<L, 11>(v, m);
+
+            for (u64 i = 0; i < 8; ++i)
+                h[i] = L::xor_(h[i], L::xor_(v[i], v[i + 8]));
+        }
+
+        // for each lane k, hashes the inLength byte message msgs[k] starting
+        // from the initialized chaining value h0[k] and writes the 64 byte
+        // chaining value to out[k]. The digest is a prefix of it.
+        template<typename L>
+        void hashLanes(const u8* const* h0, const u8* const* msgs, u64 inLength, u8* const* out)
+        {
+            typename L::V h[8];
+            transposeIn<L>(h, h0, 8);
+
+            u8 last[L::size][BLAKE2B_BLOCKBYTES];
+            const u8* blocks[L::size];
+            u64 numBlocks = std::max<u64>(1, divCeil(inLength, BLAKE2B_BLOCKBYTES));
+            for (u64 b = 0; b < numBlocks; ++b)
+            {
+                auto offset = b * BLAKE2B_BLOCKBYTES;
+                auto size = std::min<u64>(BLAKE2B_BLOCKBYTES, inLength - offset);
+                for (u64 k = 0; k < L::size; ++k)
+                {
+                    if (size == BLAKE2B_BLOCKBYTES)
+                        blocks[k] = msgs[k] + offset;
+                    else
+                    {
+                        memcpy(last[k], msgs[k] + offset, size);
+                        memset(last[k] + size, 0, BLAKE2B_BLOCKBYTES - size);
+                        blocks[k] = last[k];
+                    }
+                }
+
+                compress<L>(h, blocks, offset + size, b == numBlocks - 1);
+            }
+
+            transposeOut<L>(out, h, 8);
+        }
+
+        // the same as blake2b_update(S[k], in + s * stride + k * 128, 128) for
+        // each stripe s < numStripes and lane k. The states must have hashed
+        // the same number of bytes, a multiple of 128 and less than 2^64.
+        template<typename L>
+        void updateLanes(blake2b_state* const* S, const u8* in, u64 stride, u64 numStripes)
+        {
+            if (numStripes == 0)
+                return;
+
+            // blake2b_update always keeps the last block buffered since it
+            // could be the final one.
+            u64 s = 0;
+            if (S[0]->buflen == 0)
+            {
+                for (u64 k = 0; k < L::size; ++k)
+                    memcpy(S[k]->buf, in + k * BLAKE2B_BLOCKBYTES, BLAKE2B_BLOCKBYTES);
+                s = 1;
+            }
+
+            if (s < numStripes)
+            {
+                const u8* ptrs[L::size];
+                for (u64 k = 0; k < L::size; ++k)
+                    ptrs[k] = (const u8*)S[k]->h;
+                typename L::V h[8];
+                transposeIn<L>(h, ptrs, 8);
+
+                auto t = S[0]->t[0];
+                for (u64 k = 0; k < L::size; ++k)
+                    ptrs[k] = S[k]->buf;
+                t += BLAKE2B_BLOCKBYTES;
+                compress<L>(h, ptrs, t, false);
+
+                for (; s + 1 < numStripes; ++s)
+                {
+                    for (u64 k = 0; k < L::size; ++k)
+                        ptrs[k] = in + s * stride + k * BLAKE2B_BLOCKBYTES;
+                    t += BLAKE2B_BLOCKBYTES;
+                    compress<L>(h, ptrs, t, false);
+                }
+
+                u8* dst[L::size];
+                for (u64 k = 0; k < L::size; ++k)
+                {
+                    memcpy(S[k]->buf, in + s * stride + k * BLAKE2B_BLOCKBYTES, BLAKE2B_BLOCKBYTES);
+                    S[k]->t[0] = t;
+                    dst[k] = (u8*)S[k]->h;
+                }
+                transposeOut<L>(dst, h, 8);
+            }
+
+            for (u64 k = 0; k < L::size; ++k)
+                S[k]->buflen = BLAKE2B_BLOCKBYTES;
+        }
+#endif
+    }
+
+    void Blake2::hashBatch(const u8* in, u64 inLength, u64 n, u8* out, u64 outLength)
+    {
+        if (outLength == 0 || outLength > MaxHashSize)
+            throw std::runtime_error(LOCATION);
+
+#ifdef OC_ENABLE_AVX2
+        using L = BatchLanes;
+        blake2b_state init;
+        blake2b_init(&init, outLength);
+
+        const u8* h0[L::size];
+        const u8* msgs[L::size];
+        u64 digests[L::size][8];
+        u8* dst[L::size];
+        for (u64 k = 0; k < L::size; ++k)
+        {
+            h0[k] = (const u8*)init.h;
+            dst[k] = (u8*)digests[k];
+        }
+
+        u64 i = 0;
+        for (; i + L::size / 2 <= n; i += L::size)
+        {
+            // the unused lanes of the last batch hash a copy of its first message.
+            auto numOut = std::min<u64>(L::size, n - i);
+            for (u64 k = 0; k < L::size; ++k)
+                msgs[k] = in + (i + (k < numOut ? k : 0)) * inLength;
+
+            hashLanes<L>(h0, msgs, inLength, dst);
+            for (u64 k = 0; k < numOut; ++k)
+                memcpy(out + (i + k) * outLength, digests[k], outLength);
+        }
+
+        // a few left over messages are faster one at a time.
+        if (i < n)
+            hashEach(in + i * inLength, inLength, n - i, out + i * outLength, outLength);
+#else
+        hashEach(in, inLength, n, out, outLength);
+#endif
+    }
+
+    void Blake2bp::update(const u8* in, u64 inLength)
+    {
+        const u64 degree = 4;
+        const u64 stripe = degree * BLAKE2B_BLOCKBYTES;
+        auto& S = mState;
+        u64 left = S.buflen;
+        u64 fill = sizeof(S.buf) - left;
+
+        if (left && inLength >= fill)
+        {
+            memcpy(S.buf + left, in, fill);
+            for (u64 i = 0; i < degree; ++i)
+                blake2b_update(S.S[i], S.buf + i * BLAKE2B_BLOCKBYTES, BLAKE2B_BLOCKBYTES);
+
+            in += fill;
+            inLength -= fill;
+            left = 0;
+        }
+
+        // the whole stripes of 4 blocks, where leaf i gets block i of each.
+        auto numStripes = inLength / stripe;
+        if (numStripes)
+        {
+            auto numThreads = mNumThreads ? mNumThreads : std::thread::hardware_concurrency();
+            if (numThreads > 1 && numStripes * stripe >= parallelThreshold)
+            {
+                parallelFor(degree, 1, std::min<u64>(numThreads, degree), [&](u64 begin, u64 end) {
+                    for (u64 i = begin; i < end; ++i)
+                        for (u64 s = 0; s < numStripes; ++s)
+                            blake2b_update(S.S[i], in + s * stripe + i * BLAKE2B_BLOCKBYTES, BLAKE2B_BLOCKBYTES);
+                    });
+            }
+            else
+            {
+#ifdef OC_ENABLE_AVX2
+                blake2b_state* leaves[degree] = { S.S[0], S.S[1], S.S[2], S.S[3] };
+                updateLanes<Lanes4>(leaves, in, stripe, numStripes);
+#else
+                for (u64 s = 0; s < numStripes; ++s)
+                    for (u64 i = 0; i < degree; ++i)
+                        blake2b_update(S.S[i], in + s * stripe + i * BLAKE2B_BLOCKBYTES, BLAKE2B_BLOCKBYTES);
+#endif
+            }
+
+            in += numStripes * stripe;
+            inLength -= numStripes * stripe;
+        }
+
+        memcpy(S.buf + left, in, inLength);
+        S.buflen = left + inLength;
+    }
+
+    void Blake2Xb::Final(u8* out)
+    {
+        u8 root[BLAKE2B_OUTBYTES];
+        blake2b_final(mState.S, root, BLAKE2B_OUTBYTES);
+
+        // output block i is the blake2b hash of the root with node_offset = i.
+        blake2b_param P = *mState.P;
+        P.key_length = 0;
+        P.fanout = 0;
+        P.depth = 0;
+        P.leaf_length = BLAKE2B_OUTBYTES;
+        P.inner_length = BLAKE2B_OUTBYTES;
+        P.node_depth = 0;
+
+        auto numBlocks = divCeil(mOutputLength, BLAKE2B_OUTBYTES);
+        auto blockSize = [&](u64 i) {
+            return std::min<u64>(BLAKE2B_OUTBYTES, mOutputLength - i * BLAKE2B_OUTBYTES);
+        };
+
+        blake2b_state C;
+        u64 i = 0;
+#ifdef OC_ENABLE_AVX2
+        using L = BatchLanes;
+        u64 h0[L::size][8];
+        const u8* h0Ptrs[L::size];
+        const u8* msgs[L::size];
+        u8* dst[L::size];
+        u64 last[8];
+        for (; i + L::size <= numBlocks; i += L::size)
+        {
+            for (u64 k = 0; k < L::size; ++k)
+            {
+                P.digest_length = (u8)blockSize(i + k);
+                P.node_offset = (u32)(i + k);
+                blake2b_init_param(&C, &P);
+                memcpy(h0[k], C.h, sizeof(C.h));
+
+                h0Ptrs[k] = (const u8*)h0[k];
+                msgs[k] = root;
+                dst[k] = out + (i + k) * BLAKE2B_OUTBYTES;
+            }
+
+            // only the last block of the output can be partial.
+            if (P.digest_length != BLAKE2B_OUTBYTES)
+                dst[L::size - 1] = (u8*)last;
+
+            hashLanes<L>(h0Ptrs, msgs, BLAKE2B_OUTBYTES, dst);
+
+            if (P.digest_length != BLAKE2B_OUTBYTES)
+                memcpy(out + (i + L::size - 1) * BLAKE2B_OUTBYTES, last, P.digest_length);
+        }
+#endif
+        for (; i < numBlocks; ++i)
+        {
+            auto size = blockSize(i);
+            P.digest_length = (u8)size;
+            P.node_offset = (u32)i;
+            blake2b_init_param(&C, &P);
+            blake2b_update(&C, root, BLAKE2B_OUTBYTES);
+            blake2b_final(&C, out + i * BLAKE2B_OUTBYTES, size);
+        }
+    }
 }
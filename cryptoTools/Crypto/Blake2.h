@@ -85,7 +85,206 @@ namespace osuCrypto {
 		{
 			return state.outlen;
 		}
+
+		// Hashes the n messages of inLength bytes at in + i * inLength and
+		// writes the outLength byte digests to out + i * outLength. The result
+		// is the same as hashing each message with its own Blake2(outLength),
+		// but 4 or 8 messages are hashed at a time in the lanes of AVX2 or
+		// AVX-512 registers when the library is compiled with them.
+		static void hashBatch(const u8* in, u64 inLength, u64 n, u8* out, u64 outLength);
+
+		// Hashes each element of in as its own message, i.e. out[i] is the
+		// sizeof(Out) byte digest of in[i].
+		template<typename In, typename Out>
+		static typename std::enable_if<
+			std::is_standard_layout<In>::value&&
+			std::is_trivial<In>::value&&
+			std::is_standard_layout<Out>::value&&
+			std::is_trivial<Out>::value &&
+			sizeof(Out) <= MaxHashSize
+		>::type
+			hashBatch(span<const In> in, span<Out> out)
+		{
+			if (in.size() != out.size())
+				throw std::runtime_error(LOCATION);
+			hashBatch((const u8*)in.data(), sizeof(In), in.size(), (u8*)out.data(), sizeof(Out));
+		}
 	private:
 		blake2b_state state;
 	};
+
+	// Blake2bp, the 4-way parallel tree mode of Blake 2. The input is split
+	// into 128 byte blocks that are dealt round robin to 4 Blake2b leaves whose
+	// digests are hashed by a root node. The leaves are updated together in
+	// the lanes of AVX2 registers when the library is compiled with them, and
+	// on up to 4 threads when numThreads > 1 and an Update is large. The digest
+	// differs from that of Blake2.
+	class Blake2bp
+	{
+	public:
+		// The default size of the digest output by Final(...);
+		static const u64 HashSize = Blake2::HashSize;
+
+		// The maximum size of the digest output by Final(...);
+		static const u64 MaxHashSize = BLAKE2B_OUTBYTES;
+
+		// The smallest Update, in bytes, that is split between threads.
+		static const u64 parallelThreshold = 1ull << 20;
+
+		// Initializes the internal state. numThreads = 0 uses up to
+		// std::thread::hardware_concurrency() threads.
+		Blake2bp(u64 outputLength = HashSize, u64 numThreads = 1)
+			: mNumThreads(numThreads)
+		{
+			Reset(outputLength);
+		}
+
+		// The maximum number of threads used by Update.
+		u64 mNumThreads;
+
+		// Resets the interal state.
+		void Reset()
+		{
+			Reset(outputLength());
+		}
+
+		// Resets the interal state.
+		void Reset(u64 outputLength)
+		{
+			if (blake2bp_init(&mState, outputLength))
+				throw std::runtime_error(LOCATION);
+		}
+
+		// Add length bytes pointed to by dataIn to the internal state.
+		template<typename T>
+		typename std::enable_if<
+			std::is_standard_layout<T>::value&&
+			std::is_trivial<T>::value
+		>::type Update(const T* dataIn, u64 length)
+		{
+			update((const u8*)dataIn, length * sizeof(T));
+		}
+
+		template<typename T>
+		typename std::enable_if<Hashable<T>::value>::type Update(const T& t)
+		{
+			Hashable<T>::hash(t, *this);
+		}
+
+		// Finalize the hash and output the result to DataOut.
+		// Required: DataOut must be at least outputLength() bytes long.
+		void Final(u8* DataOut)
+		{
+			blake2bp_final(&mState, DataOut, mState.outlen);
+		}
+
+		// Finalize the hash and output the result to out.
+		template<typename T>
+		typename std::enable_if<
+			std::is_standard_layout<T>::value&&
+			std::is_trivial<T>::value &&
+			sizeof(T) <= MaxHashSize &&
+			std::is_pointer<T>::value == false
+		>::type
+			Final(T& out)
+		{
+			if (sizeof(T) != outputLength())
+				throw std::runtime_error(LOCATION);
+			Final((u8*)&out);
+		}
+
+		// returns the number of bytes that will be written when Final(...) is called.
+		u64 outputLength() const
+		{
+			return mState.outlen;
+		}
+
+	private:
+		void update(const u8* data, u64 length);
+
+		blake2bp_state mState;
+	};
+
+	// Blake2Xb, the extendable output function of Blake 2. The input is
+	// hashed to a 64 byte root which is then expanded to outputLength()
+	// bytes by hashing it once per 64 bytes of output. The expansion is done
+	// 4 or 8 blocks at a time in the lanes of AVX2 or AVX-512 registers when
+	// the library is compiled with them.
+	class Blake2Xb
+	{
+	public:
+		// The maximum size of the output of Final(...).
+		static const u64 MaxOutputLength = 0xFFFFFFFE;
+
+		// Initializes the internal state to output outputLength bytes.
+		Blake2Xb(u64 outputLength) { Reset(outputLength); }
+
+		// Resets the interal state.
+		void Reset()
+		{
+			Reset(outputLength());
+		}
+
+		// Resets the interal state.
+		void Reset(u64 outputLength)
+		{
+			if (outputLength > MaxOutputLength ||
+				blake2xb_init(&mState, outputLength))
+				throw std::runtime_error(LOCATION);
+			mOutputLength = outputLength;
+		}
+
+		// Add length bytes pointed to by dataIn to the internal state.
+		template<typename T>
+		typename std::enable_if<
+			std::is_standard_layout<T>::value&&
+			std::is_trivial<T>::value
+		>::type Update(const T* dataIn, u64 length)
+		{
+			blake2xb_update(&mState, dataIn, length * sizeof(T));
+		}
+
+		template<typename T>
+		typename std::enable_if<Hashable<T>::value>::type Update(const T& t)
+		{
+			Hashable<T>::hash(t, *this);
+		}
+
+		// Finalize the hash and output the result to DataOut.
+		// Required: DataOut must be at least outputLength() bytes long.
+		void Final(u8* DataOut);
+
+		// Finalize the hash and output the result to out.
+		template<typename T>
+		typename std::enable_if<
+			std::is_standard_layout<T>::value&&
+			std::is_trivial<T>::value &&
+			std::is_pointer<T>::value == false
+		>::type
+			Final(T& out)
+		{
+			if (sizeof(T) != outputLength())
+				throw std::runtime_error(LOCATION);
+			Final((u8*)&out);
+		}
+
+		// Finalize the hash and output the result to out, where out.size()
+		// must be outputLength().
+		void Final(span<u8> out)
+		{
+			if (out.size() != outputLength())
+				throw std::runtime_error(LOCATION);
+			Final(out.data());
+		}
+
+		// returns the number of bytes that will be written when Final(...) is called.
+		u64 outputLength() const
+		{
+			return mOutputLength;
+		}
+
+	private:
+		blake2xb_state mState;
+		u64 mOutputLength;
+	};
 }
@@ -0,0 +1,163 @@
+#include "Commit.h"
+#include <algorithm>
+#include <cstring>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        // the number of messages that are laid out and hashed at a time.
+        const u64 chunkSize = 256;
+
+        const u8 leafTag = 0;
+        const u8 nodeTag = 1;
+
+        // comms[i] = H(prefix || value_i || rand[i]), where the prefix is
+        // the tag if hasTag is set and empty otherwise.
+        void hashValues(const u8* values, u64 valueSize, span<const block> rand,
+            Commit* comms, bool hasTag)
+        {
+            auto offset = hasTag ? 1 : 0;
+            auto msgSize = offset + valueSize + sizeof(block);
+            std::vector<u8> buff(std::min<u64>(chunkSize, rand.size()) * msgSize);
+            for (u64 i = 0; i < rand.size(); i += chunkSize)
+            {
+                auto n = std::min<u64>(chunkSize, rand.size() - i);
+                for (u64 j = 0; j < n; ++j)
+                {
+                    auto msg = buff.data() + j * msgSize;
+                    if (hasTag)
+                        msg[0] = leafTag;
+                    memcpy(msg + offset, values + (i + j) * valueSize, valueSize);
+                    memcpy(msg + offset + valueSize, &rand[i + j], sizeof(block));
+                }
+                Blake2::hashBatch(buff.data(), msgSize, n, comms[i].data(), Commit::size());
+            }
+        }
+
+        // the parents of level, where the last node is moved up if it has
+        // no sibling.
+        void hashLevel(span<const Commit> level, std::vector<Commit>& parents)
+        {
+            const u64 msgSize = 1 + 2 * sizeof(Commit);
+            parents.resize((level.size() + 1) / 2);
+            auto numPairs = level.size() / 2;
+
+            u8 buff[chunkSize * msgSize];
+            for (u64 i = 0; i < numPairs; i += chunkSize)
+            {
+                auto n = std::min<u64>(chunkSize, numPairs - i);
+                for (u64 j = 0; j < n; ++j)
+                {
+                    buff[j * msgSize] = nodeTag;
+                    memcpy(buff + j * msgSize + 1, &level[2 * (i + j)], 2 * sizeof(Commit));
+                }
+                Blake2::hashBatch(buff, msgSize, n, parents[i].data(), Commit::size());
+            }
+
+            if (level.size() & 1)
+                parents.back() = level.back();
+        }
+
+        Commit hashNode(const Commit& left, const Commit& right)
+        {
+            Commit c;
+            RandomOracle ro(Commit::size());
+            ro.Update(&nodeTag, 1);
+            ro.Update(left.data(), Commit::size());
+            ro.Update(right.data(), Commit::size());
+            ro.Final(c.data());
+            return c;
+        }
+    }
+
+    void CommitBatch::commit(const u8* values, u64 valueSize, span<const block> rand, span<Commit> comms)
+    {
+        if (rand.size() != comms.size())
+            throw RTE_LOC;
+        hashValues(values, valueSize, rand, comms.data(), false);
+    }
+
+    bool CommitBatch::verify(const u8* values, u64 valueSize, span<const block> rand, span<const Commit> comms)
+    {
+        if (rand.size() != comms.size())
+            throw RTE_LOC;
+
+        Commit exp[chunkSize];
+        for (u64 i = 0; i < rand.size(); i += chunkSize)
+        {
+            auto n = std::min<u64>(chunkSize, rand.size() - i);
+            hashValues(values + i * valueSize, valueSize, rand.subspan(i, n), exp, false);
+            if (memcmp(exp, &comms[i], n * sizeof(Commit)))
+                return false;
+        }
+        return true;
+    }
+
+    void MerkleCommit::commit(const u8* values, u64 valueSize, span<const block> rand)
+    {
+        if (rand.size() == 0)
+            throw RTE_LOC;
+
+        mLevels.resize(1);
+        mLevels[0].resize(rand.size());
+        hashValues(values, valueSize, rand, mLevels[0].data(), true);
+
+        while (mLevels.back().size() > 1)
+        {
+            std::vector<Commit> parents;
+            hashLevel(mLevels.back(), parents);
+            mLevels.push_back(std::move(parents));
+        }
+    }
+
+    std::vector<Commit> MerkleCommit::proof(u64 i) const
+    {
+        if (i >= size())
+            throw RTE_LOC;
+
+        std::vector<Commit> path;
+        for (u64 l = 0; l + 1 < mLevels.size(); ++l, i /= 2)
+        {
+            auto sibling = i ^ 1;
+            if (sibling < mLevels[l].size())
+                path.push_back(mLevels[l][sibling]);
+        }
+        return path;
+    }
+
+    bool MerkleCommit::verify(const u8* values, u64 valueSize, span<const block> rand, const Commit& root)
+    {
+        if (rand.size() == 0)
+            return false;
+
+        MerkleCommit tree;
+        tree.commit(values, valueSize, rand);
+        return tree.root() == root;
+    }
+
+    bool MerkleCommit::verifyProof(const u8* value, u64 valueSize, const block& rand,
+        u64 i, u64 n, span<const Commit> proof, const Commit& root)
+    {
+        if (i >= n)
+            return false;
+
+        Commit node;
+        hashValues(value, valueSize, span<const block>(&rand, 1), &node, true);
+
+        u64 p = 0;
+        for (u64 m = n; m > 1; m = (m + 1) / 2, i /= 2)
+        {
+            auto sibling = i ^ 1;
+            if (sibling >= m)
+                continue;
+            if (p == proof.size())
+                return false;
+
+            auto& s = proof[p++];
+            node = (i & 1) ? hashNode(s, node) : hashNode(node, s);
+        }
+
+        return p == proof.size() && node == root;
+    }
+}
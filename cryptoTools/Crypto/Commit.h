@@ -5,6 +5,7 @@
 #include <cryptoTools/Crypto/PRNG.h>
 #include <cryptoTools/Crypto/RandomOracle.h>
 #include <iostream>
+#include <vector>
 
 namespace osuCrypto {
 
@@ -126,6 +127,135 @@ class Commit
 
     static_assert(sizeof(Commit) == RandomOracle::HashSize, "needs to be Pod type");
 
+	// Randomized commitments to many values of the same size. The values are
+	// hashed several at a time with Blake2::hashBatch and comms[i] is the
+	// same as Commit(value_i, rand[i]) for values of one block.
+	class CommitBatch
+	{
+	public:
+		// Commits to the rand.size() values of valueSize bytes at
+		// values + i * valueSize with the randomness rand[i].
+		static void commit(const u8* values, u64 valueSize, span<const block> rand, span<Commit> comms);
+
+		// Same as above except that rand is first filled from prng.
+		static void commit(const u8* values, u64 valueSize, PRNG& prng, span<block> rand, span<Commit> comms)
+		{
+			prng.get(rand.data(), rand.size());
+			commit(values, valueSize, span<const block>(rand), comms);
+		}
+
+		// Returns true if every comms[i] opens to value_i and rand[i].
+		static bool verify(const u8* values, u64 valueSize, span<const block> rand, span<const Commit> comms);
+
+		// Commits to each element of values.
+		template<typename T>
+		static typename std::enable_if<std::is_trivially_copyable<T>::value>::type
+			commit(span<const T> values, PRNG& prng, span<block> rand, span<Commit> comms)
+		{
+			if (values.size() != rand.size())
+				throw std::runtime_error(LOCATION);
+			commit((const u8*)values.data(), sizeof(T), prng, rand, comms);
+		}
+
+		// Commits to each element of values.
+		template<typename T>
+		static typename std::enable_if<std::is_trivially_copyable<T>::value>::type
+			commit(span<const T> values, span<const block> rand, span<Commit> comms)
+		{
+			if (values.size() != rand.size())
+				throw std::runtime_error(LOCATION);
+			commit((const u8*)values.data(), sizeof(T), rand, comms);
+		}
+
+		// Returns true if every comms[i] opens to values[i] and rand[i].
+		template<typename T>
+		static typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type
+			verify(span<const T> values, span<const block> rand, span<const Commit> comms)
+		{
+			if (values.size() != rand.size())
+				throw std::runtime_error(LOCATION);
+			return verify((const u8*)values.data(), sizeof(T), rand, comms);
+		}
+	};
+
+	// A single commitment to many values of the same size, as the root of a
+	// Merkle tree. The leaves are H(0 || value_i || rand_i) and the parent of
+	// two nodes is H(1 || left || right), where H is the hash of Commit. A
+	// node without a sibling is moved up to the next level unchanged. The
+	// values can be opened all at once with verify(...) or one at a time
+	// with proof(i) and verifyProof(...).
+	class MerkleCommit
+	{
+	public:
+		// The levels of the tree from the leaves to the root.
+		std::vector<std::vector<Commit>> mLevels;
+
+		MerkleCommit() = default;
+
+		// Commits to the rand.size() values of valueSize bytes at
+		// values + i * valueSize with the randomness rand[i].
+		void commit(const u8* values, u64 valueSize, span<const block> rand);
+
+		// Same as above except that rand is first filled from prng.
+		void commit(const u8* values, u64 valueSize, PRNG& prng, span<block> rand)
+		{
+			prng.get(rand.data(), rand.size());
+			commit(values, valueSize, span<const block>(rand));
+		}
+
+		// The commitment to all of the values.
+		const Commit& root() const
+		{
+			if (mLevels.empty())
+				throw std::runtime_error(LOCATION);
+			return mLevels.back()[0];
+		}
+
+		// The number of values committed to.
+		u64 size() const { return mLevels.size() ? mLevels[0].size() : 0; }
+
+		// The siblings of the path from leaf i to the root, which together
+		// with value i and rand[i] open it.
+		std::vector<Commit> proof(u64 i) const;
+
+		// Returns true if the rand.size() values at values + i * valueSize
+		// and rand open root.
+		static bool verify(const u8* values, u64 valueSize, span<const block> rand, const Commit& root);
+
+		// Returns true if value i of the n committed values, its randomness
+		// and proof(i) open root.
+		static bool verifyProof(const u8* value, u64 valueSize, const block& rand,
+			u64 i, u64 n, span<const Commit> proof, const Commit& root);
+
+		// Commits to each element of values.
+		template<typename T>
+		typename std::enable_if<std::is_trivially_copyable<T>::value>::type
+			commit(span<const T> values, PRNG& prng, span<block> rand)
+		{
+			if (values.size() != rand.size())
+				throw std::runtime_error(LOCATION);
+			commit((const u8*)values.data(), sizeof(T), prng, rand);
+		}
+
+		// Returns true if values and rand open root.
+		template<typename T>
+		static typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type
+			verify(span<const T> values, span<const block> rand, const Commit& root)
+		{
+			if (values.size() != rand.size())
+				throw std::runtime_error(LOCATION);
+			return verify((const u8*)values.data(), sizeof(T), rand, root);
+		}
+
+		// Returns true if value is element i of the n values committed to by root.
+		template<typename T>
+		static typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type
+			verifyProof(const T& value, const block& rand, u64 i, u64 n, span<const Commit> proof, const Commit& root)
+		{
+			return verifyProof((const u8*)&value, sizeof(T), rand, i, n, proof, root);
+		}
+	};
+
 
 	//std::ostream& operator<<(std::ostream& out, const Commit& comm);
 }
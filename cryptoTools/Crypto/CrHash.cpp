@@ -0,0 +1,146 @@
+#include "CrHash.h"
+#include <algorithm>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        // the number of input blocks hashed at a time, chosen so that the
+        // expanded inputs fit in a small stack buffer.
+        const u64 chunkSize = 64;
+
+        const block defaultKey = toBlock(45345336, -103343430);
+
+        // the number of output blocks per input block.
+        u64 outputBlocks(u64 inSize, u64 outSize)
+        {
+            if (inSize == 0 && outSize == 0)
+                return 1;
+            if (inSize == 0 || outSize % inSize)
+                throw RTE_LOC;
+            auto k = outSize / inSize;
+            if (k == 0 || k > CrHash::MaxOutputBlocks)
+                throw RTE_LOC;
+            return k;
+        }
+
+        // the inputs are expanded to x[i] ^ c_j in a buffer and hashed with
+        // one call so that AES is pipelined across both i and j. k is a
+        // template parameter so that the expansion is unrolled.
+        template<u64 k>
+        void crHashK(const AES& aes, span<const block> x, span<block> y, bool circular)
+        {
+            block buff[chunkSize * k];
+            for (u64 i = 0; i < x.size(); i += chunkSize)
+            {
+                auto n = std::min<u64>(chunkSize, x.size() - i);
+                auto xi = x.data() + i;
+                for (u64 l = 0; l < n; ++l)
+                {
+                    auto z = circular ? CrHash::sigma(xi[l]) : xi[l];
+                    for (u64 j = 0; j < k; ++j)
+                        buff[l * k + j] = z ^ block(j, 0);
+                }
+                aes.hashBlocks(buff, n * k, y.data() + i * k);
+            }
+        }
+
+        // pix = AES(x), buff = AES(x) ^ tweaks and y = AES(buff) ^ AES(x).
+        template<u64 k, typename TweakFn>
+        void tccrHashK(const AES& aes, span<const block> x, span<block> y, TweakFn&& tweak)
+        {
+            block pix[chunkSize];
+            block buff[chunkSize * k];
+            for (u64 i = 0; i < x.size(); i += chunkSize)
+            {
+                auto n = std::min<u64>(chunkSize, x.size() - i);
+                aes.ecbEncBlocks(x.data() + i, n, pix);
+                for (u64 l = 0; l < n; ++l)
+                {
+                    auto t = tweak(i + l);
+                    for (u64 j = 0; j < k; ++j)
+                        buff[l * k + j] = pix[l] ^ block(j, t);
+                }
+
+                auto yi = y.data() + i * k;
+                aes.ecbEncBlocks(buff, n * k, yi);
+                for (u64 l = 0; l < n; ++l)
+                    for (u64 j = 0; j < k; ++j)
+                        yi[l * k + j] = yi[l * k + j] ^ pix[l];
+            }
+        }
+
+        template<typename TweakFn>
+        void tccrHash(const AES& aes, span<const block> x, span<block> y, TweakFn&& tweak)
+        {
+            switch (outputBlocks(x.size(), y.size()))
+            {
+            case 1: return tccrHashK<1>(aes, x, y, tweak);
+            case 2: return tccrHashK<2>(aes, x, y, tweak);
+            case 3: return tccrHashK<3>(aes, x, y, tweak);
+            default: return tccrHashK<4>(aes, x, y, tweak);
+            }
+        }
+    }
+
+    const u64 CrHash::MaxOutputBlocks;
+    const u64 TccrHash::MaxOutputBlocks;
+
+    CrHash::CrHash()
+        : CrHash(defaultKey)
+    {}
+
+    const CrHash& CrHash::fixedKey()
+    {
+        static const CrHash h;
+        return h;
+    }
+
+    void CrHash::crHash(span<const block> x, span<block> y) const
+    {
+        hash(x, y, false);
+    }
+
+    void CrHash::ccrHash(span<const block> x, span<block> y) const
+    {
+        hash(x, y, true);
+    }
+
+    void CrHash::hash(span<const block> x, span<block> y, bool circular) const
+    {
+        auto k = outputBlocks(x.size(), y.size());
+        if (k == 1 && !circular)
+            return mAes.hashBlocks(x, y);
+
+        switch (k)
+        {
+        case 1: return crHashK<1>(mAes, x, y, circular);
+        case 2: return crHashK<2>(mAes, x, y, circular);
+        case 3: return crHashK<3>(mAes, x, y, circular);
+        default: return crHashK<4>(mAes, x, y, circular);
+        }
+    }
+
+    TccrHash::TccrHash()
+        : TccrHash(defaultKey)
+    {}
+
+    const TccrHash& TccrHash::fixedKey()
+    {
+        static const TccrHash h;
+        return h;
+    }
+
+    void TccrHash::hash(span<const block> x, span<const u64> tweaks, span<block> y) const
+    {
+        if (tweaks.size() != x.size())
+            throw RTE_LOC;
+        auto t = tweaks.data();
+        tccrHash(mAes, x, y, [t](u64 i) { return t[i]; });
+    }
+
+    void TccrHash::hash(span<const block> x, u64 baseTweak, span<block> y) const
+    {
+        tccrHash(mAes, x, y, [baseTweak](u64 i) { return baseTweak + i; });
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include "cryptoTools/Crypto/AES.h"
+
+namespace osuCrypto
+{
+    // Hash functions of blocks built from fixed key AES, see
+    // https://eprint.iacr.org/2019/074. They only provide the correlation
+    // robustness properties stated below rather than a random oracle, but are
+    // an order of magnitude faster than RandomOracle since many blocks are
+    // pipelined through AES.
+    //
+    // The output of each input block is k = 1, ..., MaxOutputBlocks blocks,
+    // where k is output.size() / input.size(). Output block j of input i is
+    // at output[i * k + j] and is derived with the counter j.
+
+    // The correlation robust hash H(x) = AES(x) ^ x and the circular
+    // correlation robust hash H(sigma(x)), where sigma(a || b) = (a ^ b) || a
+    // for the high and low halves a, b of x. Output block j is H(x ^ c_j)
+    // for c_j = block(j, 0).
+    class CrHash
+    {
+    public:
+        AES mAes;
+
+        // The maximum number of output blocks per input block.
+        static const u64 MaxOutputBlocks = 4;
+
+        // Uses the key of mAesFixedKey.
+        CrHash();
+
+        CrHash(const block& key) { setKey(key); }
+
+        void setKey(const block& key) { mAes.setKey(key); }
+
+        // The instance with the default key. It is constructed on first use
+        // and can be shared by all threads.
+        static const CrHash& fixedKey();
+
+        // The correlation robust hash of each x[i]. For k = 1 this is the
+        // same as mAes.hashBlocks(x, y).
+        void crHash(span<const block> x, span<block> y) const;
+
+        // The circular correlation robust hash of each x[i].
+        void ccrHash(span<const block> x, span<block> y) const;
+
+        block crHash(const block& x) const { return mAes.hashBlock(x); }
+
+        block ccrHash(const block& x) const { return mAes.hashBlock(sigma(x)); }
+
+        // The linear orthomorphism sigma(a || b) = (a ^ b) || a.
+        static block sigma(const block& x)
+        {
+            auto w = x.get<u64>();
+            return block(w[1] ^ w[0], w[1]);
+        }
+
+    private:
+        void hash(span<const block> x, span<block> y, bool circular) const;
+    };
+
+    // The tweakable circular correlation robust hash
+    //
+    //   H(x, t) = AES(AES(x) ^ t) ^ AES(x),
+    //
+    // also known as TMMO. The tweak of output block j of x[i] is
+    // block(j, tweaks[i]), so distinct (i, j) get distinct tweaks as long as
+    // the tweak stream does not repeat. For k = 1 the result is the same as
+    // mAes.TmmoHashBlock(x[i], toBlock(tweaks[i])).
+    class TccrHash
+    {
+    public:
+        AES mAes;
+
+        // The maximum number of output blocks per input block.
+        static const u64 MaxOutputBlocks = CrHash::MaxOutputBlocks;
+
+        // Uses the key of mAesFixedKey.
+        TccrHash();
+
+        TccrHash(const block& key) { setKey(key); }
+
+        void setKey(const block& key) { mAes.setKey(key); }
+
+        // The instance with the default key. It is constructed on first use
+        // and can be shared by all threads.
+        static const TccrHash& fixedKey();
+
+        // Hashes x[i] with the tweak tweaks[i], where tweaks.size() must be
+        // x.size().
+        void hash(span<const block> x, span<const u64> tweaks, span<block> y) const;
+
+        // Hashes x[i] with the tweak baseTweak + i.
+        void hash(span<const block> x, u64 baseTweak, span<block> y) const;
+
+        block hash(const block& x, u64 tweak) const { return mAes.TmmoHashBlock(x, toBlock(tweak)); }
+    };
+}
@@ -0,0 +1,168 @@
+#include "GgmExpander.h"
+#include <algorithm>
+#include <vector>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        // The number of levels to expand per chunk such that a chunk of
+        // numTrees << levels blocks fits in GgmExpander::chunkSize. At least
+        // one level is expanded so that progress is made for any numTrees.
+        u64 chunkDepth(u64 numTrees, u64 depth)
+        {
+            u64 c = 1;
+            while (c < depth && (numTrees << (c + 1)) <= GgmExpander::chunkSize)
+                ++c;
+            return std::min(c, depth);
+        }
+    }
+
+    GgmExpander::GgmExpander()
+    {
+        setKeys(block(0x9e3779b97f4a7c15, 0x243f6a8885a308d3), block(0x13198a2e03707344, 0xa4093822299f31d0));
+    }
+
+    void GgmExpander::setKeys(const block& key0, const block& key1)
+    {
+        mAes[0].setKey(key0);
+        mAes[1].setKey(key1);
+    }
+
+    void GgmExpander::expandLevel(const block* parents, u64 numRows, u64 numTrees, block* children) const
+    {
+        // the children of row n are rows 2n and 2n + 1, so processing the
+        // parents from the last to the first never overwrites a parent that
+        // has not been read when expanding in place.
+        if (numTrees >= 8)
+        {
+            for (u64 n = numRows; n-- > 0;)
+            {
+                auto parent = parents + n * numTrees;
+                auto left = children + 2 * n * numTrees;
+                mAes[1].hashBlocks(parent, numTrees, left + numTrees);
+                mAes[0].hashBlocks(parent, numTrees, left);
+            }
+        }
+        else
+        {
+            // the rows are too short to keep the pipeline full, so hash sixteen
+            // parents at a time across rows. Node i = n * numTrees + t has its
+            // left child at i + n * numTrees, which is never before i.
+            constexpr u64 step = 16;
+            block h0[step], h1[step];
+            u64 i = numRows * numTrees;
+            while (i)
+            {
+                auto k = std::min(step, i);
+                i -= k;
+                if (k == step)
+                {
+                    mAes[0].hashBlocks<step>(parents + i, h0);
+                    mAes[1].hashBlocks<step>(parents + i, h1);
+                }
+                else
+                {
+                    mAes[0].hashBlocks(parents + i, k, h0);
+                    mAes[1].hashBlocks(parents + i, k, h1);
+                }
+
+                u64 n = i / numTrees, t = i % numTrees;
+                for (u64 j = 0; j < k; ++j)
+                {
+                    auto left = i + j + n * numTrees;
+                    children[left] = h0[j];
+                    children[left + numTrees] = h1[j];
+                    if (++t == numTrees)
+                    {
+                        t = 0;
+                        ++n;
+                    }
+                }
+            }
+        }
+    }
+
+    void GgmExpander::expandTree(span<const block> seeds, u64 depth, span<block> tree) const
+    {
+        auto numTrees = seeds.size();
+        if (depth >= 64 || tree.size() != ((2ull << depth) - 1) * numTrees)
+            throw RTE_LOC;
+
+        std::copy(seeds.begin(), seeds.end(), tree.begin());
+        for (u64 d = 0; d < depth; ++d)
+        {
+            auto level = tree.data() + ((1ull << d) - 1) * numTrees;
+            auto next = tree.data() + ((2ull << d) - 1) * numTrees;
+            expandLevel(level, 1ull << d, numTrees, next);
+        }
+    }
+
+    void GgmExpander::expandLeaves(span<const block> seeds, u64 depth, span<block> leaves) const
+    {
+        auto numTrees = seeds.size();
+        if (depth >= 64 || leaves.size() != (numTrees << depth))
+            throw RTE_LOC;
+
+        std::copy(seeds.begin(), seeds.end(), leaves.begin());
+        expandLeavesInPlace(leaves.data(), numTrees, depth);
+    }
+
+    // On entry the first row of leaves holds the roots. The top levels are
+    // expanded recursively, then each of their nodes is moved to the start of
+    // the rows its subtree occupies and the subtree is expanded in cache.
+    void GgmExpander::expandLeavesInPlace(block* leaves, u64 numTrees, u64 depth) const
+    {
+        if (depth == 0 || numTrees == 0)
+            return;
+
+        auto c = chunkDepth(numTrees, depth);
+        auto top = depth - c;
+        if (top)
+            expandLeavesInPlace(leaves, numTrees, top);
+
+        // row r moves to row r << c, which is past all the rows that have not
+        // been moved yet.
+        for (u64 r = 1ull << top; r-- > 0;)
+        {
+            auto sub = leaves + (r << c) * numTrees;
+            if (r)
+                std::copy(leaves + r * numTrees, leaves + (r + 1) * numTrees, sub);
+            for (u64 d = 0; d < c; ++d)
+                expandLevel(sub, 1ull << d, numTrees, sub);
+        }
+    }
+
+    void GgmExpander::expandStream(span<const block> seeds, u64 depth, const LeafCallback& callback) const
+    {
+        auto numTrees = seeds.size();
+        if (depth >= 64)
+            throw RTE_LOC;
+        if (numTrees == 0)
+            return;
+        if (depth == 0)
+            return callback(0, seeds);
+
+        // one chunk for each group of levels that is expanded at a time.
+        auto c = chunkDepth(numTrees, depth);
+        std::vector<block> buffer(divCeil(depth, c) * (numTrees << c));
+        expandStreamChunk(seeds.data(), numTrees, depth, 0, buffer.data(), callback);
+    }
+
+    void GgmExpander::expandStreamChunk(const block* roots, u64 numTrees, u64 depth, u64 leafIdx,
+        block* buffer, const LeafCallback& callback) const
+    {
+        auto c = chunkDepth(numTrees, depth);
+        std::copy(roots, roots + numTrees, buffer);
+        for (u64 d = 0; d < c; ++d)
+            expandLevel(buffer, 1ull << d, numTrees, buffer);
+
+        if (c == depth)
+            return callback(leafIdx, span<const block>(buffer, numTrees << c));
+
+        auto rest = depth - c;
+        auto next = buffer + (numTrees << c);
+        for (u64 r = 0; r < (1ull << c); ++r)
+            expandStreamChunk(buffer + r * numTrees, numTrees, rest, leafIdx + (r << rest), next, callback);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include "cryptoTools/Crypto/AES.h"
+#include <array>
+#include <functional>
+
+namespace osuCrypto
+{
+    // Expands seeds into GGM trees, e.g. for a puncturable PRF. The children
+    // of a node x are
+    //
+    //   left(x)  = AES_0.Enc(x) ^ x,
+    //   right(x) = AES_1.Enc(x) ^ x,
+    //
+    // for two fixed and public keys. Many trees are expanded together level
+    // by level so that the AES pipeline always has independent blocks.
+    //
+    // A level of numTrees trees is stored tree interleaved, i.e. node j of
+    // tree t is at index j * numTrees + t. The numTrees nodes with the same
+    // index j are called a row.
+    class GgmExpander
+    {
+    public:
+        std::array<AES, 2> mAes;
+
+        // The number of blocks that are expanded depth first at a time by
+        // expandLeaves and expandStream. 2^12 blocks is 64KiB, which fits in
+        // the L2 cache.
+        static const u64 chunkSize = 1ull << 12;
+
+        // Uses the default fixed keys.
+        GgmExpander();
+
+        GgmExpander(const block& key0, const block& key1) { setKeys(key0, key1); }
+
+        // Set the keys of the left and right child functions.
+        void setKeys(const block& key0, const block& key1);
+
+        // The callback type of expandStream.
+        using LeafCallback = std::function<void(u64 leafIdx, span<const block> leaves)>;
+
+        // Expands one level. parents holds numRows rows of numTrees nodes and
+        // children receives the 2 * numRows rows of their children. children
+        // may be equal to parents, in which case children must have room for
+        // both levels.
+        void expandLevel(const block* parents, u64 numRows, u64 numTrees, block* children) const;
+
+        // Expands the trees rooted at seeds to the given depth and writes the
+        // full trees to tree. Level d starts at index ((1 << d) - 1) * seeds.size()
+        // and tree.size() must be ((2 << depth) - 1) * seeds.size().
+        void expandTree(span<const block> seeds, u64 depth, span<block> tree) const;
+
+        // Expands the trees rooted at seeds to the given depth and writes only
+        // the leaves, where leaves.size() must be seeds.size() << depth. The
+        // internal nodes are overwritten in place and the expansion proceeds
+        // depth first in chunks so that it stays in cache.
+        void expandLeaves(span<const block> seeds, u64 depth, span<block> leaves) const;
+
+        // Expands the trees rooted at seeds to the given depth without storing
+        // them. callback(leafIdx, leaves) is called with consecutive chunks of
+        // rows, in order, where leaves[j * seeds.size() + t] is leaf leafIdx + j
+        // of tree t. The leaves are only valid during the call.
+        void expandStream(span<const block> seeds, u64 depth, const LeafCallback& callback) const;
+
+    private:
+
+        void expandLeavesInPlace(block* leaves, u64 numTrees, u64 depth) const;
+
+        void expandStreamChunk(const block* roots, u64 numTrees, u64 depth, u64 leafIdx,
+            block* buffer, const LeafCallback& callback) const;
+    };
+}
@@ -0,0 +1,211 @@
+#include "MultiKeyAES.h"
+
+#ifdef OC_ENABLE_AESNI
+#include <immintrin.h>
+#endif
+
+namespace osuCrypto
+{
+    namespace details
+    {
+        namespace
+        {
+            constexpr u64 rounds = oc::AES::rounds;
+
+#ifdef OC_ENABLE_AESNI
+            constexpr int rcon[rounds] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+            // Expands W key schedules at once. aeskeygenassist has a low throughput
+            // so SubWord(RotWord(w3)) ^ rcon is computed with aesenclast instead:
+            // with RotWord(w3) in every column ShiftRows is the identity.
+            template<u64 W>
+            OC_FORCEINLINE void expandKeysNI(const block* keys, oc::AES* aes)
+            {
+                const __m128i mask = _mm_set1_epi32(0x0c0f0e0d);
+                __m128i k[W], t[W];
+                for (u64 w = 0; w < W; ++w)
+                {
+                    k[w] = keys[w];
+                    aes[w].mRoundKey[0] = k[w];
+                }
+
+                for (u64 r = 1; r <= rounds; ++r)
+                {
+                    const __m128i rc = _mm_set1_epi32(rcon[r - 1]);
+                    for (u64 w = 0; w < W; ++w)
+                        t[w] = _mm_aesenclast_si128(_mm_shuffle_epi8(k[w], mask), rc);
+
+                    // k = {w0, w0^w1, w0^w1^w2, w0^w1^w2^w3} ^ t
+                    for (u64 w = 0; w < W; ++w)
+                    {
+                        __m128i s = _mm_slli_si128(k[w], 4);
+                        k[w] = _mm_xor_si128(k[w], s);
+                        s = _mm_slli_si128(s, 4);
+                        k[w] = _mm_xor_si128(k[w], s);
+                        s = _mm_slli_si128(s, 4);
+                        k[w] = _mm_xor_si128(_mm_xor_si128(k[w], s), t[w]);
+                        aes[w].mRoundKey[r] = k[w];
+                    }
+                }
+            }
+#endif
+
+#if defined(OC_ENABLE_VAES) && (defined(_MSC_VER) || defined(__AVX512BW__))
+#define OC_MULTI_KEY_AES_VAES
+            // expandKeysNI for 16 keys, four per zmm register.
+            void expandKeysVaes(const block* keys, oc::AES* aes)
+            {
+                constexpr u64 n512 = 4;
+                const __m512i mask = _mm512_set1_epi32(0x0c0f0e0d);
+                __m512i k[n512], t[n512];
+
+                // maskz avoids a spurious uninitialized warning from gcc.
+                auto store = [&](u64 r) {
+                    for (u64 w = 0; w < n512; ++w)
+                    {
+                        aes[4 * w + 0].mRoundKey[r] = _mm512_maskz_extracti32x4_epi32(0xF, k[w], 0);
+                        aes[4 * w + 1].mRoundKey[r] = _mm512_maskz_extracti32x4_epi32(0xF, k[w], 1);
+                        aes[4 * w + 2].mRoundKey[r] = _mm512_maskz_extracti32x4_epi32(0xF, k[w], 2);
+                        aes[4 * w + 3].mRoundKey[r] = _mm512_maskz_extracti32x4_epi32(0xF, k[w], 3);
+                    }
+                };
+
+                for (u64 w = 0; w < n512; ++w)
+                    k[w] = _mm512_loadu_si512(keys + 4 * w);
+                store(0);
+
+                for (u64 r = 1; r <= rounds; ++r)
+                {
+                    const __m512i rc = _mm512_set1_epi32(rcon[r - 1]);
+                    for (u64 w = 0; w < n512; ++w)
+                        t[w] = _mm512_aesenclast_epi128(_mm512_shuffle_epi8(k[w], mask), rc);
+
+                    for (u64 w = 0; w < n512; ++w)
+                    {
+                        __m512i s = _mm512_bslli_epi128(k[w], 4);
+                        k[w] = _mm512_xor_si512(k[w], s);
+                        s = _mm512_bslli_epi128(s, 4);
+                        k[w] = _mm512_xor_si512(k[w], s);
+                        s = _mm512_bslli_epi128(s, 4);
+                        k[w] = _mm512_xor_si512(_mm512_xor_si512(k[w], s), t[w]);
+                    }
+                    store(r);
+                }
+            }
+#endif
+
+            // Encrypts B blocks under each of K consecutive keys. The K * B
+            // blocks are independent and are processed round by round.
+            template<u64 K, u64 B, bool hash>
+            OC_FORCEINLINE void encKeys(const oc::AES* aes, const block* plaintext, block* ciphertext)
+            {
+                oc::AlignedArray<block, K * B> x;
+                for (u64 k = 0; k < K; ++k)
+                    for (u64 b = 0; b < B; ++b)
+                        x[k * B + b] = oc::AES::firstFn(plaintext[k * B + b], aes[k].mRoundKey[0]);
+
+                for (u64 r = 1; r < rounds - 1; ++r)
+                    for (u64 k = 0; k < K; ++k)
+                        for (u64 b = 0; b < B; ++b)
+                            x[k * B + b] = oc::AES::roundFn(x[k * B + b], aes[k].mRoundKey[r]);
+
+                for (u64 k = 0; k < K; ++k)
+                    for (u64 b = 0; b < B; ++b)
+                        x[k * B + b] = oc::AES::penultimateFn(x[k * B + b], aes[k].mRoundKey[rounds - 1]);
+
+                for (u64 k = 0; k < K; ++k)
+                    for (u64 b = 0; b < B; ++b)
+                        x[k * B + b] = oc::AES::finalFn(x[k * B + b], aes[k].mRoundKey[rounds]);
+
+                for (u64 i = 0; i < K * B; ++i)
+                    ciphertext[i] = hash ? x[i] ^ plaintext[i] : x[i];
+            }
+
+            template<u64 K, u64 B, bool hash>
+            void encKeyRange(span<const oc::AES> aes, u64& i, const block* plaintext, block* ciphertext)
+            {
+                for (; i + K <= aes.size(); i += K)
+                    encKeys<K, B, hash>(&aes[i], plaintext + i * B, ciphertext + i * B);
+            }
+
+            template<bool hash>
+            void encBlocks(span<const oc::AES> aes, const block* plaintext, u64 blocksPerKey, block* ciphertext)
+            {
+                // With few blocks per key, several keys are interleaved so that
+                // about 8 to 16 blocks are in flight. Otherwise each key on its
+                // own already fills the pipeline.
+                u64 i = 0;
+                switch (blocksPerKey)
+                {
+                case 0: return;
+                case 1: encKeyRange<8, 1, hash>(aes, i, plaintext, ciphertext); break;
+                case 2: encKeyRange<4, 2, hash>(aes, i, plaintext, ciphertext); break;
+                case 3: encKeyRange<4, 3, hash>(aes, i, plaintext, ciphertext); break;
+                case 4: encKeyRange<2, 4, hash>(aes, i, plaintext, ciphertext); break;
+                case 5: encKeyRange<2, 5, hash>(aes, i, plaintext, ciphertext); break;
+                case 6: encKeyRange<2, 6, hash>(aes, i, plaintext, ciphertext); break;
+                case 7: encKeyRange<2, 7, hash>(aes, i, plaintext, ciphertext); break;
+                default: break;
+                }
+
+                for (; i < aes.size(); ++i)
+                {
+                    auto offset = i * blocksPerKey;
+                    if (hash)
+                        aes[i].hashBlocks(plaintext + offset, blocksPerKey, ciphertext + offset);
+                    else
+                        aes[i].ecbEncBlocks(plaintext + offset, blocksPerKey, ciphertext + offset);
+                }
+            }
+        }
+
+        void aesExpandKeys(span<const block> keys, oc::AES* aes)
+        {
+            u64 i = 0;
+#ifdef OC_MULTI_KEY_AES_VAES
+            for (; i + 16 <= keys.size(); i += 16)
+                expandKeysVaes(keys.data() + i, aes + i);
+#endif
+#ifdef OC_ENABLE_AESNI
+            for (; i + 8 <= keys.size(); i += 8)
+                expandKeysNI<8>(keys.data() + i, aes + i);
+            for (; i + 4 <= keys.size(); i += 4)
+                expandKeysNI<4>(keys.data() + i, aes + i);
+#endif
+            for (; i < keys.size(); ++i)
+                aes[i].setKey(keys[i]);
+        }
+    }
+
+    void DynMultiKeyAES::setKeys(span<const block> keys)
+    {
+        mAESs.resize(keys.size());
+        details::aesExpandKeys(keys, mAESs.data());
+    }
+
+    void DynMultiKeyAES::ecbEncBlocks(const block* plaintext, u64 blocksPerKey, block* ciphertext) const
+    {
+        details::encBlocks<false>(mAESs, plaintext, blocksPerKey, ciphertext);
+    }
+
+    void DynMultiKeyAES::ecbEncBlocks(span<const block> plaintext, span<block> ciphertext) const
+    {
+        if (plaintext.size() != ciphertext.size() || (size() && plaintext.size() % size()))
+            throw RTE_LOC;
+        if (size())
+            ecbEncBlocks(plaintext.data(), plaintext.size() / size(), ciphertext.data());
+    }
+
+    void DynMultiKeyAES::hashBlocks(const block* plaintext, u64 blocksPerKey, block* ciphertext) const
+    {
+        details::encBlocks<true>(mAESs, plaintext, blocksPerKey, ciphertext);
+    }
+
+    void DynMultiKeyAES::hashBlocks(span<const block> plaintext, span<block> ciphertext) const
+    {
+        if (plaintext.size() != ciphertext.size() || (size() && plaintext.size() % size()))
+            throw RTE_LOC;
+        if (size())
+            hashBlocks(plaintext.data(), plaintext.size() / size(), ciphertext.data());
+    }
+}
@@ -1,9 +1,17 @@
 #pragma once
 #include "AES.h"
 #include <array>
+#include <vector>
 
 namespace osuCrypto
 {
+    namespace details
+    {
+        // Expands the key schedule of keys[i] into aes[i] for i = 0,...,keys.size()-1.
+        // With AES-NI the independent schedules are interleaved 8 at a time, or 16
+        // at a time with VAES, so that the key generation pipeline is kept full.
+        void aesExpandKeys(span<const block> keys, oc::AES* aes);
+    }
 
     // Specialization of the AES class to support encryption of N values under N different keys
     template<int N>
@@ -89,65 +97,9 @@ namespace osuCrypto
         // Set the N keys to be used for encryption.
         void setKeys(span<block> keys)
         {
-#ifdef OC_ENABLE_AESNI
-            constexpr u64 main = N / 8 * 8;
-
-            auto cp = [&](u8 i, AES* aes, std::array<block, 8>& buff)
-                {
-                    aes[0].mRoundKey[i] = buff[0];
-                    aes[1].mRoundKey[i] = buff[1];
-                    aes[2].mRoundKey[i] = buff[2];
-                    aes[3].mRoundKey[i] = buff[3];
-                    aes[4].mRoundKey[i] = buff[4];
-                    aes[5].mRoundKey[i] = buff[5];
-                    aes[6].mRoundKey[i] = buff[6];
-                    aes[7].mRoundKey[i] = buff[7];
-                };
-            std::array<block, 8> buff;
-
-            for (u64 i = 0; i < main; i += 8)
-            {
-                auto* aes = &mAESs[i];
-
-                buff[0] = keys[i + 0];
-                buff[1] = keys[i + 1];
-                buff[2] = keys[i + 2];
-                buff[3] = keys[i + 3];
-                buff[4] = keys[i + 4];
-                buff[5] = keys[i + 5];
-                buff[6] = keys[i + 6];
-                buff[7] = keys[i + 7];
-                cp(0, aes, buff);
-
-                keyGenHelper8<0x01>(buff);
-                cp(1, aes, buff);
-                keyGenHelper8<0x02>(buff);
-                cp(2, aes, buff);
-                keyGenHelper8<0x04>(buff);
-                cp(3, aes, buff);
-                keyGenHelper8<0x08>(buff);
-                cp(4, aes, buff);
-                keyGenHelper8<0x10>(buff);
-                cp(5, aes, buff);
-                keyGenHelper8<0x20>(buff);
-                cp(6, aes, buff);
-                keyGenHelper8<0x40>(buff);
-                cp(7, aes, buff);
-                keyGenHelper8<0x80>(buff);
-                cp(8, aes, buff);
-                keyGenHelper8<0x1B>(buff);
-                cp(9, aes, buff);
-                keyGenHelper8<0x36>(buff);
-                cp(10, aes, buff);
-            }
-#else
-            u64 main = 0;
-#endif
-
-            for (u64 i = main; i < N; ++i)
-            {
-                mAESs[i].setKey(keys[i]);
-            }
+            if (keys.size() < N)
+                throw RTE_LOC;
+            details::aesExpandKeys(keys.subspan(0, N), mAESs.data());
         }
 
         // Computes the encrpytion of N blocks pointed to by plaintext
@@ -200,4 +152,42 @@ namespace osuCrypto
         }
     };
 
-}
\ No newline at end of file
+
+    // Encryption under a number of keys that is only known at run time, e.g.
+    // re-keyed garbling or the levels of a GGM tree. The keys are scheduled in
+    // batches and the encryption interleaves several keys so that there are
+    // enough independent blocks in flight to keep the AES pipeline full.
+    class DynMultiKeyAES
+    {
+    public:
+        std::vector<AES> mAESs;
+
+        // Default constructor leave the class in an invalid state
+        // until setKeys(...) is called.
+        DynMultiKeyAES() = default;
+        DynMultiKeyAES(const DynMultiKeyAES&) = default;
+
+        // Constructor to initialize the class with the given keys.
+        DynMultiKeyAES(span<const block> keys) { setKeys(keys); }
+
+        // Set the keys to be used for encryption.
+        void setKeys(span<const block> keys);
+
+        // The number of keys.
+        u64 size() const { return mAESs.size(); }
+
+        // for i = 0,...,size()-1 and j = 0,...,blocksPerKey-1, set
+        // ciphertext[i * blocksPerKey + j] = AES_i.Enc(plaintext[i * blocksPerKey + j]).
+        void ecbEncBlocks(const block* plaintext, u64 blocksPerKey, block* ciphertext) const;
+
+        // Same as above with blocksPerKey = plaintext.size() / size().
+        void ecbEncBlocks(span<const block> plaintext, span<block> ciphertext) const;
+
+        // for i = 0,...,size()-1 and j = 0,...,blocksPerKey-1, set
+        // ciphertext[k] = AES_i.Enc(plaintext[k]) ^ plaintext[k] where k = i * blocksPerKey + j.
+        void hashBlocks(const block* plaintext, u64 blocksPerKey, block* ciphertext) const;
+
+        // Same as above with blocksPerKey = plaintext.size() / size().
+        void hashBlocks(span<const block> plaintext, span<block> ciphertext) const;
+    };
+}
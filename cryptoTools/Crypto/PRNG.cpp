@@ -1,4 +1,5 @@
 #include <cryptoTools/Crypto/PRNG.h>
+#include <cryptoTools/Common/BitVector.h>
 #include <cryptoTools/Common/Log.h>
 #include <algorithm>
 #include <cstring>
@@ -70,26 +71,203 @@ namespace osuCrypto {
 
             if (mBytesIdx == mBufferByteCapacity)
             {
-                while (lengthu8 >= 8 * sizeof(block))
-                {
-                    oc::AlignedArray<block, 8> b;
-                    mAes.ecbEncCounterMode(mBlockIdx, b.size(), b.data());
-                    memcpy(destu8, &b, sizeof(b));
-                    mBlockIdx += b.size();
-
-                    step = sizeof(b);
+                // the whole blocks skip the buffer, only the tail is copied out of it.
+                u64 numBlocks = lengthu8 / sizeof(block);
+                fillBlocks(mBlockIdx, numBlocks, destu8);
+                mBlockIdx += numBlocks;
 
-                    destu8 += step;
-                    lengthu8 -= step;
-                }
+                step = numBlocks * sizeof(block);
+                destu8 += step;
+                lengthu8 -= step;
 
                 refillBuffer();
             }
         }
     }
 
+    void PRNG::seek(u64 blockIdx)
+    {
+        mBlockIdx = blockIdx;
+        refillBuffer();
+    }
+
+    void PRNG::implGetAt(u64 offset, u8* destu8, u64 lengthu8) const
+    {
+        if (mBuffer.size() == 0)
+            throw std::runtime_error("PRNG has not been keyed " LOCATION);
+
+        u64 blockIdx = offset / sizeof(block);
+        u64 skip = offset % sizeof(block);
+        block b;
+
+        // the partial first block.
+        if (skip && lengthu8)
+        {
+            b = mAes.ecbEncBlock(toBlock(blockIdx++));
+            u64 step = std::min<u64>(sizeof(block) - skip, lengthu8);
+            memcpy(destu8, b.data() + skip, step);
+            destu8 += step;
+            lengthu8 -= step;
+        }
+
+        u64 numBlocks = lengthu8 / sizeof(block);
+        fillBlocks(blockIdx, numBlocks, destu8);
+        blockIdx += numBlocks;
+        destu8 += numBlocks * sizeof(block);
+        lengthu8 -= numBlocks * sizeof(block);
+
+        // the partial last block.
+        if (lengthu8)
+        {
+            b = mAes.ecbEncBlock(toBlock(blockIdx));
+            memcpy(destu8, b.data(), lengthu8);
+        }
+    }
+
+    void PRNG::fillBlocks(u64 blockIdx, u64 numBlocks, u8* destu8) const
+    {
+        if ((u64)destu8 % alignof(block) == 0)
+        {
+            mAes.ecbEncCounterMode(blockIdx, numBlocks, (block*)destu8);
+        }
+        else
+        {
+            // AES writes whole aligned blocks, so go through a small buffer.
+            oc::AlignedArray<block, 64> b;
+            while (numBlocks)
+            {
+                u64 n = std::min<u64>(b.size(), numBlocks);
+                mAes.ecbEncCounterMode(blockIdx, n, b.data());
+                memcpy(destu8, b.data(), n * sizeof(block));
+
+                blockIdx += n;
+                numBlocks -= n;
+                destu8 += n * sizeof(block);
+            }
+        }
+    }
+
+    void PRNG::implParallelGet(u8* destu8, u64 lengthu8, u64 numThreads)
+    {
+        if (mBuffer.size() == 0)
+            throw std::runtime_error("PRNG has not been keyed " LOCATION);
+
+        // the buffer holds the blocks just before mBlockIdx, so this is
+        // where get(...) would continue the stream.
+        u64 offset = (mBlockIdx - mBuffer.size()) * sizeof(block) + mBytesIdx;
+        u64 numBlocks = divCeil(lengthu8, sizeof(block));
+        parallelFor(numBlocks, AES::parallelChunkSize, numThreads, [&](u64 begin, u64 end) {
+            u64 b = begin * sizeof(block);
+            u64 e = std::min<u64>(end * sizeof(block), lengthu8);
+            implGetAt(offset + b, destu8 + b, e - b);
+            });
+
+        auto end = offset + lengthu8;
+        seek(end / sizeof(block));
+        mBytesIdx = end % sizeof(block);
+    }
+
     u8 PRNG::getBit() { return get<bool>(); }
 
+    void PRNG::getBounded(span<u32> dest, u32 bound)
+    {
+        if (bound == 0)
+            throw RTE_LOC;
+
+        get(dest);
+        u32 threshold = (0 - bound) % bound;
+
+        // rejections are rare, so first check a chunk for any with a loop
+        // that the compiler can vectorize and then reduce it in a second one.
+        constexpr u64 chunkSize = 256;
+        for (u64 i = 0; i < dest.size(); i += chunkSize)
+        {
+            auto d = dest.data() + i;
+            auto n = std::min<u64>(chunkSize, dest.size() - i);
+
+            bool reject = false;
+            for (u64 j = 0; j < n; ++j)
+                reject |= u32(u64(d[j]) * bound) < threshold;
+
+            if (reject == false)
+            {
+                for (u64 j = 0; j < n; ++j)
+                    d[j] = u32((u64(d[j]) * bound) >> 32);
+            }
+            else
+            {
+                for (u64 j = 0; j < n; ++j)
+                {
+                    u64 m = u64(d[j]) * bound;
+                    while (u32(m) < threshold)
+                        m = u64(get<u32>()) * bound;
+                    d[j] = u32(m >> 32);
+                }
+            }
+        }
+    }
+
+    void PRNG::getBounded(span<u64> dest, u64 bound)
+    {
+        if (bound == 0)
+            throw RTE_LOC;
+
+        get(dest);
+        for (auto& d : dest)
+            d = getBounded(d, bound);
+    }
+
+    void PRNG::getBits(BitVector& dest)
+    {
+        get(dest.data(), dest.sizeBytes());
+        if (dest.size() % 8)
+            dest.data()[dest.sizeBytes() - 1] &= u8((1 << (dest.size() % 8)) - 1);
+    }
+
+    void PRNG::getBernoulli(BitVector& dest, double p)
+    {
+        if (!(p >= 0 && p <= 1))
+            throw RTE_LOC;
+
+        // the binary digits of p = 0.d_1 d_2 ..., doubling is exact.
+        std::vector<u8> digits;
+        for (double q = p; q != 0 && p != 1;)
+        {
+            q *= 2;
+            digits.push_back(q >= 1);
+            if (q >= 1)
+                q -= 1;
+        }
+
+        // a uniform x = 0.r_1 r_2 ... is less than p if at the first digit
+        // where they differ r_k = 0 and d_k = 1. This is decided for 64
+        // bits at a time, each undecided bit needs one more random bit.
+        // If the digits of p run out first then x >= p.
+        auto words = divCeil(dest.size(), 64);
+        for (u64 w = 0; w < words; ++w)
+        {
+            u64 out = p == 1 ? ~0ull : 0;
+            u64 undecided = ~0ull;
+            for (u64 k = 0; undecided && k < digits.size(); ++k)
+            {
+                auto r = get<u64>();
+                if (digits[k])
+                {
+                    out |= undecided & ~r;
+                    undecided &= r;
+                }
+                else
+                    undecided &= ~r;
+            }
+
+            auto size = std::min<u64>(sizeof(u64), dest.sizeBytes() - w * sizeof(u64));
+            memcpy(dest.data() + w * sizeof(u64), &out, size);
+        }
+
+        if (dest.size() % 8)
+            dest.data()[dest.sizeBytes() - 1] &= u8((1 << (dest.size() % 8)) - 1);
+    }
+
     const block PRNG::getSeed() const
     {
         if(mBuffer.size())
@@ -2,12 +2,38 @@
 // This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
 #include <cryptoTools/Common/Defines.h>
 #include <cryptoTools/Crypto/AES.h>
+#include <algorithm>
 #include <vector>
 #include <cstring>
 #include <cryptoTools/Common/Aligned.h>
 
 namespace osuCrypto
 {
+    class BitVector;
+
+    namespace details
+    {
+        // returns the high 64 bits of a * b and sets lo to the low 64 bits.
+        inline u64 mul128(u64 a, u64 b, u64& lo)
+        {
+#ifdef __SIZEOF_INT128__
+            auto m = (__uint128_t)a * b;
+            lo = (u64)m;
+            return (u64)(m >> 64);
+#elif defined(_MSC_VER) && defined(_WIN64)
+            u64 hi;
+            lo = _umul128(a, b, &hi);
+            return hi;
+#else
+            u64 a0 = a & 0xffffffff, a1 = a >> 32;
+            u64 b0 = b & 0xffffffff, b1 = b >> 32;
+            u64 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+            u64 mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+            lo = (mid << 32) | (p00 & 0xffffffff);
+            return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+        }
+    }
 
     // A Peudorandom number generator implemented using AES-NI.
     class PRNG
@@ -124,6 +150,51 @@ namespace osuCrypto
 			get(dest.data(), dest.size());
 		}
 
+        ///////////////////////////////////////////////
+        // Random access
+        //
+        // The stream of a PRNG is AES_seed(0) || AES_seed(1) || ..., so any
+        // part of it can be computed without generating what comes before.
+
+        // Moves the stream such that the next byte returned is the first
+        // byte of AES_seed(blockIdx).
+        void seek(u64 blockIdx);
+
+        // Fills dest with the bytes of the stream starting at byte offset,
+        // i.e. the bytes that get(dest) would return after seek(0) and
+        // skipping offset bytes. The state of the PRNG is not changed.
+        // Required: T must be a POD type.
+        template<typename T>
+        typename std::enable_if<
+            std::is_standard_layout<T>::value&&
+            std::is_trivial<T>::value, void>::type
+            getAt(u64 offset, span<T> dest) const
+        {
+            implGetAt(offset, (u8*)dest.data(), dest.size() * sizeof(T));
+            if constexpr (std::is_same<T, bool>::value)
+                for (auto& d : dest) d = *(u8*)&d & 1;
+        }
+
+        void implGetAt(u64 offset, u8* datau8, u64 lengthu8) const;
+
+        // The same as get(dest) except that the stream is generated by
+        // numThreads threads, including the caller. The output and the
+        // state of the PRNG afterwards are identical to get(dest).
+        // numThreads = 0 uses all hardware threads.
+        // Required: T must be a POD type.
+        template<typename T>
+        typename std::enable_if<
+            std::is_standard_layout<T>::value&&
+            std::is_trivial<T>::value, void>::type
+            parallelGet(span<T> dest, u64 numThreads)
+        {
+            implParallelGet((u8*)dest.data(), dest.size() * sizeof(T), numThreads);
+            if constexpr (std::is_same<T, bool>::value)
+                for (auto& d : dest) d = *(u8*)&d & 1;
+        }
+
+        void implParallelGet(u8* datau8, u64 lengthu8, u64 numThreads);
+
         // returns the buffer of maximum maxSize bytes or however 
         // many the internal buffer has, which ever is smaller. The 
         // returned bytes are "consumed" and will not be used on 
@@ -153,11 +224,64 @@ namespace osuCrypto
             return get<result_type>();
         }
 
+        // Note, the result is slightly biased unless mod is a power of two.
+        // See getBounded(...) for an unbiased alternative.
         template<typename R>
         R operator()(R mod) {
             return get<typename std::make_unsigned<R>::type>() % mod;
         }
 
+        ///////////////////////////////////////////////
+        // Samplers
+
+        // Returns a uniformly random value in [0, bound) from the random x
+        // using Lemire's multiply-shift. In the rare case that x would
+        // introduce a bias it is rejected and a new x is taken from the stream.
+        u64 getBounded(u64 x, u64 bound)
+        {
+            u64 lo, hi = details::mul128(x, bound, lo);
+            if (lo < bound)
+            {
+                u64 threshold = (0 - bound) % bound;
+                while (lo < threshold)
+                    hi = details::mul128(get<u64>(), bound, lo);
+            }
+            return hi;
+        }
+
+        // Returns a uniformly random value in [0, bound). bound must be nonzero.
+        u64 getBounded(u64 bound) { return getBounded(get<u64>(), bound); }
+
+        // Sets each dest[i] to a uniformly random value in [0, bound). The
+        // randomness is generated in bulk and reduced with Lemire's
+        // multiply-shift and rejection, so the output is unbiased.
+        // bound must be nonzero.
+        void getBounded(span<u32> dest, u32 bound);
+        void getBounded(span<u64> dest, u64 bound);
+
+        // Sets the bits of dest uniformly at random, one bit of the stream
+        // per bit. The unused bits of the last byte are cleared.
+        void getBits(BitVector& dest);
+
+        // Sets each bit of dest to one with probability p independently.
+        // The bits are compared with the binary expansion of p 64 at a time,
+        // which is exact and takes about 7 bits of the stream per bit.
+        void getBernoulli(BitVector& dest, double p);
+
+        // Randomly permutes values with the Fisher-Yates shuffle.
+        template<typename T>
+        void shuffle(span<T> values)
+        {
+            u64 r[64];
+            for (u64 i = values.size(); i > 1;)
+            {
+                u64 n = std::min<u64>(64, i - 1);
+                get(r, n);
+                for (u64 k = 0; k < n; ++k, --i)
+                    std::swap(values[i - 1], values[getBounded(r[k], i)]);
+            }
+        }
+
         // internal buffer to store future random values.
         AlignedUnVector<block> mBuffer;
 
@@ -172,6 +296,10 @@ namespace osuCrypto
         // refills the internal buffer with fresh randomness
         void refillBuffer();
 
+        // writes AES_seed(blockIdx), ..., AES_seed(blockIdx + numBlocks - 1) to
+        // dest. Aligned destinations are written directly, without a copy.
+        void fillBlocks(u64 blockIdx, u64 numBlocks, u8* dest) const;
+
 
         PRNG fork()
         {
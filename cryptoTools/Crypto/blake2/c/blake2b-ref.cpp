@@ -22,6 +22,9 @@
 
 #include "blake2.h"
 #include "blake2-impl.h"
+#ifdef OC_ENABLE_CPU_DISPATCH
+#include "cryptoTools/Common/CpuDispatch.h"
+#endif
 
 namespace osuCrypto
 {
@@ -181,6 +184,10 @@ namespace osuCrypto
 
 	static void blake2b_compress(blake2b_state* S, const uint8_t block[BLAKE2B_BLOCKBYTES])
 	{
+#ifdef OC_ENABLE_CPU_DISPATCH
+		if (details::gCpuKernels.mBlake2b.mCompress)
+			return details::gCpuKernels.mBlake2b.mCompress(S->h, S->t, S->f, block);
+#endif
 		uint64_t m[16];
 		uint64_t v[16];
 		size_t i;
@@ -42,6 +42,9 @@
 #endif
 
 #include "blake2b-round.h"
+#ifdef OC_ENABLE_CPU_DISPATCH
+#include "cryptoTools/Common/CpuDispatch.h"
+#endif
 
 
 namespace osuCrypto
@@ -155,6 +158,10 @@ namespace osuCrypto
 
 	static void blake2b_compress(blake2b_state* S, const uint8_t block[BLAKE2B_BLOCKBYTES])
 	{
+#ifdef OC_ENABLE_CPU_DISPATCH
+		if (details::gCpuKernels.mBlake2b.mCompress)
+			return details::gCpuKernels.mBlake2b.mCompress(S->h, S->t, S->f, block);
+#endif
 		__m128i row1l, row1h;
 		__m128i row2l, row2h;
 		__m128i row3l, row3h;
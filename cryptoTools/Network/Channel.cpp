@@ -4,7 +4,8 @@
 
 #include <cryptoTools/Network/Channel.h>
 #include <cryptoTools/Network/Session.h>
-#include <cryptoTools/Network/SocketAdapter.h>
+#include <cryptoTools/Network/SocketAdapter.h>
+#include <cryptoTools/Network/ZeroCopySocket.h>
 #include <cryptoTools/Common/Log.h>
 #include <cryptoTools/Common/Timer.h>
 #include <cryptoTools/Network/IOService.h>
@@ -203,7 +204,7 @@ namespace osuCrypto {
         );
     }
 
-    void StartSocketOp::setSocket(std::unique_ptr<BoostSocketInterface> socket, const error_code& ec)
+    void StartSocketOp::setSocket(std::unique_ptr<StreamSocketInterface> socket, const error_code& ec)
     {
         IF_LOG(mChl->mLog.push("Recved socket="+std::to_string(socket != nullptr)
             +", starting up the queues..."));
@@ -227,12 +228,29 @@ namespace osuCrypto {
                 }
             }
 
+            auto& opt = mChl->mSession->mSocketOptions;
+
+            // the client sets the options before it connects.
+            if (s && !ec && mChl->mSession->mMode == SessionMode::Server)
+            {
+                error_code ec2;
+                applySocketOptions(s->mSock, opt, ec2);
+                if (ec2)
+                    mChl->mIos.printError("failed to set the socket options, " + ec2.message());
+            }
+
 #ifdef ENABLE_WOLFSSL
             if (mChl->mSession->mTLSContext && !ec)
             {
                 assert(s && "socket was null but no error code");
                 
-                mTLSSock.reset(new TLSSocket(mChl->mIos.mIoService, std::move(s->mSock), mChl->mSession->mTLSContext));
+                // TLS sessions are always TCP, see Session::start.
+                auto& sock = s->mSock;
+                auto protocol = sock.local_endpoint().protocol().family() == AF_INET6 ?
+                    boost::asio::ip::tcp::v6() : boost::asio::ip::tcp::v4();
+                boost::asio::ip::tcp::socket tcpSock(mChl->mIos.mIoService, protocol, sock.release());
+
+                mTLSSock.reset(new TLSSocket(mChl->mIos.mIoService, std::move(tcpSock), mChl->mSession->mTLSContext));
                 
                 IF_LOG(mTLSSock->setLog(mChl->mLog));
 
@@ -259,6 +277,14 @@ namespace osuCrypto {
                 //mChl->mSession->mTLSContext.
             }
             else
+#endif
+#ifdef __linux__
+            if (s && !ec && opt.mZeroCopy && mChl->mSession->mUnixPath.empty())
+            {
+                auto zc = new ZeroCopySocket(std::move(s->mSock), opt.mZeroCopyThreshold);
+                finalize(std::unique_ptr<SocketInterface>(zc), ec);
+            }
+            else
 #endif
             {
                 finalize(std::move(s), ec);
@@ -355,11 +381,19 @@ namespace osuCrypto {
         auto& address = mChl->mSession->mRemoteAddr;
 
         IF_LOG(mChl->mLog.push("start async connect to server at " +
-            address.address().to_string() + " : " + std::to_string(address.port())));
+            mChl->mSession->mIP + " : " + std::to_string(mChl->mSession->mPort)));
 
         //if(!mSock)
-        mSock.reset(new BoostSocketInterface(
-            boost::asio::ip::tcp::socket(mChl->getIOService().mIoService)));
+        mSock.reset(new StreamSocketInterface(mChl->getIOService().mIoService));
+
+        // the buffer sizes must be set before the connection is made for the
+        // window scale to reflect them.
+        error_code openEC;
+        mSock->mSock.open(address.protocol(), openEC);
+        if (!openEC)
+            applySocketOptions(mSock->mSock, mChl->mSession->mSocketOptions, openEC);
+        if (openEC)
+            mChl->mIos.printError("failed to set the socket options, " + openEC.message());
 
         auto count = static_cast<u64>(mBackoff) * 100;
         mBackoff = std::min(mBackoff * 1.2, 1000.0);
@@ -421,9 +455,10 @@ namespace osuCrypto {
             }
             else
             {
-                boost::asio::ip::tcp::no_delay option(true);
+                boost::asio::ip::tcp::no_delay option(mChl->mSession->mSocketOptions.mNoDelay);
                 error_code ec2;
-                sock.set_option(option, ec2);
+                if (mChl->mSession->mUnixPath.empty())
+                    sock.set_option(option, ec2);
 
                 if (ec2)
                 {
@@ -545,6 +580,7 @@ namespace osuCrypto {
                 {
                 case boost::system::errc::operation_canceled:
                 case boost::system::errc::connection_refused:
+                case boost::system::errc::no_such_file_or_directory:
                     break;
                 default:
                     mChl->mIos.printError("client socket connect error: " + ec.message());
@@ -690,6 +726,12 @@ namespace osuCrypto {
         else completionHandle();
     }
 
+    void Channel::asyncReleaseSocket(std::function<void(const error_code&, std::unique_ptr<SocketInterface>)> fn)
+    {
+        if (mBase) mBase->asyncReleaseSocket(std::move(fn));
+        else fn(boost::asio::error::bad_descriptor, nullptr);
+    }
+
     std::string osuCrypto::Channel::commonName()
     {
         if(mBase)
@@ -716,6 +758,8 @@ namespace osuCrypto {
 #else
         char str= 0;
 #endif
+        if (mTelemetry)
+            op->mQueued = ChannelTelemetry::Clock::now();
         mRecvQueue.push_back(std::forward<SBO_ptr<details::RecvOperation>>(op));
         auto lifetime = shared_from_this();
 
@@ -756,6 +800,8 @@ namespace osuCrypto {
 #else
         char str = 0;
 #endif
+        if (mTelemetry)
+            op->mQueued = ChannelTelemetry::Clock::now();
 
         mSendQueue.push_back(std::forward<SBO_ptr<details::SendOperation>>(op));
         auto lifetime = shared_from_this();
@@ -791,10 +837,15 @@ namespace osuCrypto {
 
         if (mRecvCancelNew == false)
         {
+            if (mTelemetry)
+                mRecvQueue.front()->mStarted = ChannelTelemetry::Clock::now();
+
             mRecvQueue.front()->asyncPerform(this, [this]
                 (error_code ec, u64 bytesTransferred) {
 
                 mTotalRecvData += bytesTransferred;
+                if (mTelemetry && !ec)
+                    mTelemetry->completed(false, bytesTransferred, mRecvQueue.front()->mQueued, mRecvQueue.front()->mStarted);
 
                 boost::asio::dispatch(mStrand, [this, ec]() {
                     if (!ec)
@@ -847,9 +898,21 @@ namespace osuCrypto {
 
         if (mSendCancelNew == false)
         {
+            auto count = gatherSendCount();
+            if (count > 1)
+            {
+                asyncPerformGatherSend(count);
+                return;
+            }
+
+            if (mTelemetry)
+                mSendQueue.front()->mStarted = ChannelTelemetry::Clock::now();
+
             mSendQueue.front()->asyncPerform(this, [this](error_code ec, u64 bytesTransferred) {
 
                 mTotalSentData += bytesTransferred;
+                if (mTelemetry && !ec)
+                    mTelemetry->completed(true, bytesTransferred, mSendQueue.front()->mQueued, mSendQueue.front()->mStarted);
 
                 boost::asio::dispatch(mStrand, [this, ec]() {
                     if (!ec)
@@ -885,6 +948,105 @@ namespace osuCrypto {
         }
     }
 
+    u64 ChannelBase::gatherSendCount()
+    {
+        auto maxCount = std::min<u64>(mSendQueue.size(), mSendGatherBuffers / 2);
+        u64 count = 0, bytes = 0;
+        while (count < maxCount)
+        {
+            auto size = mSendQueue[count]->gatherSize();
+            if (size == 0 || (count && bytes + size > mSendGatherBytes))
+                break;
+
+            bytes += size;
+            ++count;
+        }
+        return count;
+    }
+
+    void ChannelBase::asyncPerformGatherSend(u64 count)
+    {
+        LOG_MSG("send gather start: " + std::to_string(count) + " ops");
+        assert(mStrand.running_in_this_thread());
+
+        // each operation hands us its buffers and completion handle. The
+        // handles are then called together once the single write completes.
+        mGatherBuffers.clear();
+        mGatherHandles.clear();
+        mSendGathering = true;
+        for (u64 i = 0; i < count; ++i)
+        {
+#ifdef ENABLE_NET_LOG
+            mSendQueue[i]->mLog = &mLog;
+#endif
+            if (mTelemetry)
+                mSendQueue[i]->mStarted = ChannelTelemetry::Clock::now();
+            mSendQueue[i]->asyncPerform(this, [this](error_code, u64 bytesTransferred) {
+                mTotalSentData += bytesTransferred;
+            });
+        }
+        mSendGathering = false;
+        assert(mGatherHandles.size() == count);
+        ++mTotalGatherWrites;
+
+        mHandle->async_send(mGatherBuffers, [this, count](error_code ec, u64 bytesTransferred) {
+
+            for (u64 i = 0; i < count; ++i)
+            {
+                auto& h = mGatherHandles[i];
+                if (mTelemetry && !ec)
+                    mTelemetry->completed(true, h.second, mSendQueue[i]->mQueued, mSendQueue[i]->mStarted);
+                h.first(ec, ec ? 0 : h.second);
+            }
+
+            boost::asio::dispatch(mStrand, [this, ec, count]() {
+
+                for (u64 i = 0; i < count; ++i)
+                    mSendQueue.pop_front();
+
+                if (!ec)
+                {
+                    LOG_MSG("send gather completed: " + std::to_string(count) + " ops");
+
+                    if (!mSendQueue.isEmpty())
+                        asyncPerformSend();
+                    else
+                        mSendLoopLifetime = nullptr;
+                }
+                else
+                {
+                    if (mIos.mPrint)
+                    {
+                        auto reason = std::string("network send error: ") + ec.message() + "\n at  " + LOCATION;
+                        lout << reason << std::endl;
+                    }
+
+                    LOG_MSG("net send error: " + ec.message());
+                    cancelSendQueue(ec);
+                }
+            });
+        });
+    }
+
+    void ChannelBase::asyncRecvAhead(u64 minSize, io_completion_handle&& fn)
+    {
+        auto avail = mRecvAheadEnd - mRecvAheadBegin;
+        if (mRecvAheadBegin)
+        {
+            memmove(mRecvAhead.data(), mRecvAhead.data() + mRecvAheadBegin, avail);
+            mRecvAheadBegin = 0;
+            mRecvAheadEnd = avail;
+        }
+        assert(avail + minSize <= mRecvAhead.size());
+
+        ++mTotalRecvAheadReads;
+        mRecvBuffer = boost::asio::mutable_buffer(mRecvAhead.data() + mRecvAheadEnd, mRecvAhead.size() - mRecvAheadEnd);
+        mHandle->async_recv_some(mRecvBuffer, minSize, [this, fn = std::move(fn)](const error_code& ec, u64 bytesTransferred) {
+            mRecvAheadEnd += bytesTransferred;
+            fn(ec, bytesTransferred);
+        });
+    }
+
     void ChannelBase::printError(std::string s)
     {
         LOG_MSG(s);
@@ -1040,6 +1202,49 @@ namespace osuCrypto {
         }
     }
 
+    void ChannelBase::asyncReleaseSocket(std::function<void(const error_code&, std::unique_ptr<SocketInterface>)> fn)
+    {
+        if (stopped())
+        {
+            fn(boost::asio::error::bad_descriptor, nullptr);
+            return;
+        }
+
+        mStatus = Channel::Status::Closing;
+
+        // the callback operations run once the socket is connected, or
+        // are canceled if it fails to connect.
+        auto lifetime = shared_from_this();
+        auto count = std::make_shared<std::atomic<u32>>(2);
+        auto cb = [&, fn = std::move(fn), count, lifetime]() mutable {
+
+            if (--*count == 0)
+            {
+                mStatus = Channel::Status::Closed;
+
+                error_code ec;
+                if (mStartOp)
+                    ec = mStartOp->mEC;
+                auto sock = std::move(mHandle);
+                if (!ec && !sock)
+                    ec = boost::asio::error::operation_aborted;
+                if (ec && sock)
+                {
+                    sock->close();
+                    sock.reset();
+                }
+                mWork.reset();
+                LOG_MSG("Released");
+
+                auto f = std::move(fn);
+                f(ec, std::move(sock));
+            }
+        };
+
+        sendEnque(make_SBO_ptr<details::SendOperation, details::SendCallbackOp>(cb));
+        recvEnque(make_SBO_ptr<details::RecvOperation, details::RecvCallbackOp>(cb));
+    }
+
 
 
 
@@ -1121,6 +1326,121 @@ namespace osuCrypto {
     }
 
 
+    const u64 Channel::DefaultStreamChunkSize;
+
+    std::future<void> Channel::asyncSendStream(const u8* data, u64 size, u64 chunkSize)
+    {
+        if (chunkSize == 0)
+            throw std::runtime_error(LOCATION);
+
+        // the header tells the receiver how to split the stream.
+        std::array<u64, 2> header{ { size, chunkSize } };
+        asyncSendCopy(header);
+
+        if (size == 0)
+        {
+            std::promise<void> trivialPromise;
+            trivialPromise.set_value();
+            return trivialPromise.get_future();
+        }
+
+        // the operations complete in order so the last future covers all.
+        u64 i = 0;
+        for (; i + chunkSize < size; i += chunkSize)
+            asyncSend(data + i, chunkSize);
+        return asyncSendFuture(data + i, size - i);
+    }
+
+    namespace
+    {
+        std::array<u64, 2> recvStreamHeader(Channel& chl)
+        {
+            std::array<u64, 2> header;
+            chl.recv(header);
+            if (header[1] == 0)
+                throw std::runtime_error("bad stream header. " LOCATION);
+            return header;
+        }
+
+        void recvStreamChunks(Channel& chl, u8* dest, u64 size, u64 chunkSize,
+            const std::function<void(span<u8>)>& fn)
+        {
+            std::vector<std::future<void>> futures;
+            futures.reserve(divCeil(size, chunkSize));
+            for (u64 i = 0; i < size; i += chunkSize)
+                futures.push_back(chl.asyncRecv(dest + i, std::min(chunkSize, size - i)));
+
+            u64 k = 0;
+            try {
+                for (; k < futures.size(); ++k)
+                {
+                    futures[k].get();
+                    if (fn)
+                    {
+                        auto i = k * chunkSize;
+                        fn(span<u8>(dest + i, std::min(chunkSize, size - i)));
+                    }
+                }
+            }
+            catch (...)
+            {
+                // dest must not be written to after we return.
+                for (++k; k < futures.size(); ++k)
+                    futures[k].wait();
+                throw;
+            }
+        }
+    }
+
+    void Channel::recvStream(u8* dest, u64 size, std::function<void(span<u8>)> fn)
+    {
+        auto header = recvStreamHeader(*this);
+        if (header[0] != size)
+        {
+            std::stringstream ss;
+            ss << "Bad receive buffer size.\n"
+                << "  Size transmitted: " << header[0]
+                << " bytes\n  Size of buffer:   " << size << " bytes\n";
+            throw BadReceiveBufferSize(ss.str(), header[0]);
+        }
+
+        recvStreamChunks(*this, dest, size, header[1], fn);
+    }
+
+    void Channel::recvStream(std::vector<u8>& dest, std::function<void(span<u8>)> fn)
+    {
+        auto header = recvStreamHeader(*this);
+        dest.resize(header[0]);
+        recvStreamChunks(*this, dest.data(), dest.size(), header[1], fn);
+    }
+
+    void Channel::setSendCoalescing(u64 maxBytes, u64 maxBuffers)
+    {
+        mBase->mSendGatherBytes = maxBytes;
+        mBase->mSendGatherBuffers = maxBuffers;
+    }
+
+    void Channel::setRecvReadAhead(u64 size)
+    {
+        if (mBase->mRecvAheadBegin != mBase->mRecvAheadEnd)
+            throw std::runtime_error("the read-ahead buffer holds unconsumed data. " LOCATION);
+        if (size && size < 4 * sizeof(details::size_header_type))
+            throw std::runtime_error("the read-ahead buffer is too small. " LOCATION);
+
+        mBase->mRecvAhead.resize(size);
+        mBase->mRecvAheadBegin = mBase->mRecvAheadEnd = 0;
+    }
+
+    void Channel::enableTelemetry(ChannelTelemetryOptions opt)
+    {
+        mBase->mTelemetry = std::make_shared<ChannelTelemetry>(opt);
+    }
+
+    std::shared_ptr<ChannelTelemetry> Channel::getTelemetry() const
+    {
+        return mBase->mTelemetry;
+    }
+
     void Channel::resetStats()
     {
         mBase->mTotalSentData = 0;
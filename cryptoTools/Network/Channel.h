@@ -4,6 +4,7 @@
 #ifdef ENABLE_BOOST
 
 #include <cryptoTools/Common/Defines.h>
+#include <cryptoTools/Network/ChannelTelemetry.h>
 #include <cryptoTools/Network/IoBuffer.h>
 #include <cryptoTools/Network/SocketAdapter.h>
 #include <cryptoTools/Network/util.h>
@@ -272,6 +273,35 @@ namespace osuCrypto {
             asyncRecv(Container & c, std::function<void(const error_code&)> fn);
 
 
+        //////////////////////////////////////////////////////////////////////////////
+        //						   Streaming interface								//
+        //////////////////////////////////////////////////////////////////////////////
+
+        // The default number of bytes per message of a stream.
+        static const u64 DefaultStreamChunkSize = 1 << 24;
+
+        // Sends size bytes as a stream of messages with at most chunkSize bytes,
+        // which is received with recvStream. Returns before the data has been
+        // sent and the data must stay valid until the future is ready.
+        std::future<void> asyncSendStream(const u8* data, u64 size, u64 chunkSize = DefaultStreamChunkSize);
+
+        // Sends size bytes as a stream, see asyncSendStream. Returns once all
+        // the data has been sent.
+        void sendStream(const u8* data, u64 size, u64 chunkSize = DefaultStreamChunkSize)
+        {
+            asyncSendStream(data, size, chunkSize).get();
+        }
+
+        // Receives a stream into dest, which must have size bytes. All of the
+        // chunks are queued up front and fn is called in order with each chunk
+        // as soon as it has arrived, while the following chunks are still being
+        // received. Returns once all the data has been received.
+        void recvStream(u8* dest, u64 size, std::function<void(span<u8>)> fn = {});
+
+        // Receives a stream into dest, which is resized to fit the data.
+        void recvStream(std::vector<u8>& dest, std::function<void(span<u8>)> fn = {});
+
+
         //////////////////////////////////////////////////////////////////////////////
         //						   Utility functions								//
         //////////////////////////////////////////////////////////////////////////////
@@ -297,6 +327,32 @@ namespace osuCrypto {
         // Returns the amount of data that this channel has sent since it was created or when resetStats() was last called.
         u64 getTotalDataRecv() const;
 
+        // Queued send operations are written to the socket with a single
+        // gathered write of at most maxBytes bytes spread over at most
+        // maxBuffers buffers, where a message uses two buffers (header and
+        // body). A message larger than maxBytes is written on its own and
+        // maxBuffers < 4 disables gathering. Should be called before any
+        // data is sent.
+        void setSendCoalescing(u64 maxBytes, u64 maxBuffers);
+
+        // Received data is read from the socket into a buffer of the given
+        // size, as much as is available, and the queued receives are served
+        // from it. This takes one socket read for many small messages. The
+        // part of a message that is at least half the buffer size is read
+        // directly into the destination. Zero disables the buffer, otherwise
+        // size must be at least 16. Should be called before any data is
+        // received.
+        void setRecvReadAhead(u64 size);
+
+        // Records the size and timing of each message that is sent or
+        // received from now on, see ChannelTelemetry. Without it the
+        // channel only checks a pointer per message. Should be called
+        // before any data is sent or received.
+        void enableTelemetry(ChannelTelemetryOptions opt = {});
+
+        // Returns the telemetry of this channel or null if it is not enabled.
+        std::shared_ptr<ChannelTelemetry> getTelemetry() const;
+
         // Returns the maximum amount of data that this channel has queued up to send since it was created or when resetStats() was last called.
         //u64 getMaxOutstandingSendData() const;
 
@@ -324,6 +380,13 @@ namespace osuCrypto {
 
         void asyncCancel(std::function<void()> completionHandle, bool close = true);
 
+        // Closes the channel like asyncClose but without closing its socket,
+        // which is passed to fn once the operations that were queued before
+        // this call have completed, e.g. to carry a StripedSocket. If the
+        // channel could not connect or was already closed, fn receives the
+        // error and no socket.
+        void asyncReleaseSocket(std::function<void(const error_code&, std::unique_ptr<SocketInterface>)> fn);
+
 
         enum class Status { Normal, Closing, Closed, Canceling};
 
@@ -396,7 +459,7 @@ namespace osuCrypto {
         void retryConnect(const error_code& ec);
 
         char mRecvChar;
-        void setSocket(std::unique_ptr<BoostSocketInterface> socket, const error_code& ec);
+        void setSocket(std::unique_ptr<StreamSocketInterface> socket, const error_code& ec);
 
         void finalize(std::unique_ptr<SocketInterface> sock, error_code ec);
 
@@ -422,7 +485,7 @@ namespace osuCrypto {
 
         AsioStrand& mStrand;
         std::vector<u8> mSendBuffer;
-        std::unique_ptr<BoostSocketInterface> mSock;
+        std::unique_ptr<StreamSocketInterface> mSock;
 
 #ifdef ENABLE_WOLFSSL
         void validateTLS(const error_code& ec);
@@ -538,6 +601,7 @@ namespace osuCrypto {
         void cancel(bool close);
         void asyncClose(std::function<void()> completionHandle);
         void asyncCancel(std::function<void()> completionHandle, bool close);
+        void asyncReleaseSocket(std::function<void(const error_code&, std::unique_ptr<SocketInterface>)> fn);
 
         IOService& getIOService() { return mIos; }
 
@@ -556,12 +620,45 @@ namespace osuCrypto {
         void asyncPerformRecv();
         void asyncPerformSend();
 
+        // the number of send operations at the front of the queue that
+        // fit in the gather budget.
+        u64 gatherSendCount();
+        void asyncPerformGatherSend(u64 count);
+
         std::string commonName();
 
 
         std::array<boost::asio::mutable_buffer, 2> mSendBuffers;
         boost::asio::mutable_buffer mRecvBuffer;
 
+        // the budget of a gathered write, see Channel::setSendCoalescing.
+        u64 mSendGatherBytes = 1 << 16;
+        u64 mSendGatherBuffers = 64;
+
+        // while set, send operations append their buffers and completion
+        // handles (with their size) to the lists below instead of writing.
+        bool mSendGathering = false;
+        std::vector<boost::asio::mutable_buffer> mGatherBuffers;
+        std::vector<std::pair<io_completion_handle, u64>> mGatherHandles;
+        u64 mTotalGatherWrites = 0;
+
+        // the optional receive read-ahead buffer, see Channel::setRecvReadAhead.
+        // The bytes in [mRecvAheadBegin, mRecvAheadEnd) have been read from
+        // the socket but not yet consumed by a receive operation.
+        std::vector<u8> mRecvAhead;
+        u64 mRecvAheadBegin = 0, mRecvAheadEnd = 0;
+        u64 mTotalRecvAheadReads = 0;
+
+        // the number of nested receives completed from the buffer.
+        u64 mRecvAheadDepth = 0;
+
+        // see Channel::enableTelemetry.
+        std::shared_ptr<ChannelTelemetry> mTelemetry;
+
+        // reads at least minSize bytes into the read-ahead buffer, moving
+        // the unconsumed bytes to the front first.
+        void asyncRecvAhead(u64 minSize, io_completion_handle&& fn);
+
         void printError(std::string s);
 
 #ifdef ENABLE_NET_LOG
@@ -576,9 +673,6 @@ namespace osuCrypto {
     template<class Container>
     typename std::enable_if<is_container<Container>::value, void>::type Channel::asyncSend(std::unique_ptr<Container> c)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(*c) < u32(-1));
-
         if (channelBuffSize(*c) == 0) return;
 
         auto op = make_SBO_ptr<
@@ -593,9 +687,6 @@ namespace osuCrypto {
     template<class Container>
     typename std::enable_if<is_container<Container>::value, void>::type Channel::asyncSend(std::shared_ptr<Container> c)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(*c) < u32(-1));
-
         if (channelBuffSize(*c) == 0) return;
 
 
@@ -612,9 +703,6 @@ namespace osuCrypto {
     template<class Container>
     typename std::enable_if<is_container<Container>::value, void>::type Channel::asyncSend(const Container& c)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(c) < u32(-1));
-
         if (channelBuffSize(c) == 0) return;
 
         auto* buff = (u8*)c.data();
@@ -630,9 +718,6 @@ namespace osuCrypto {
     template<class Container>
     typename std::enable_if<is_container<Container>::value, void>::type Channel::asyncSend(Container&& c)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(c) < u32(-1));
-
         if (channelBuffSize(c) == 0) return;
 
         auto op = make_SBO_ptr<
@@ -649,9 +734,6 @@ namespace osuCrypto {
         !has_resize<Container, void(typename Container::size_type)>::value, std::future<void>>::type
         Channel::asyncRecv(Container & c)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(c) < u32(-1));
-
         if (channelBuffSize(c) == 0)
         {
             std::promise<void> trivialPromise;
@@ -773,9 +855,6 @@ namespace osuCrypto {
         u8* buff = (u8*)buffT;
         auto size = sizeT * sizeof(T);
 
-        // less that 32 bit max
-        assert(size < u32(-1));
-
         if (size == 0)
         {
             std::promise<void> trivialPromise;
@@ -809,9 +888,6 @@ namespace osuCrypto {
         u8* buff = (u8*)buffT;
         auto size = sizeT * sizeof(T);
 
-        // less that 32 bit max
-        assert(size < u32(-1));
-
         if (size == 0)
         {
             std::promise<void> trivialPromise;
@@ -836,9 +912,6 @@ namespace osuCrypto {
         u8* buff = (u8*)buffT;
         auto size = sizeT * sizeof(T);
 
-        // less that 32 bit max
-        assert(size < u32(-1));
-
         if (size == 0)
         {
             std::promise<void> trivialPromise;
@@ -864,9 +937,6 @@ namespace osuCrypto {
         u8* buff = (u8*)buffT;
         auto size = sizeT * sizeof(T);
 
-        // less that 32 bit max
-        assert(size < u32(-1));
-
         if (size == 0) return;
 
         auto op = make_SBO_ptr<
@@ -892,9 +962,6 @@ namespace osuCrypto {
     typename std::enable_if<is_container<Container>::value, void>::type
         Channel::asyncSend(Container&& c, std::function<void()> callback)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(c) < u32(-1));
-
         if (channelBuffSize(c) == 0)
         {
             callback();
@@ -916,9 +983,6 @@ namespace osuCrypto {
     typename std::enable_if<is_container<Container>::value, void>::type
         Channel::asyncSend(Container&& c, std::function<void(const error_code&)> callback)
     {
-        // less that 32 bit max
-        assert(channelBuffSize(c) < u32(-1));
-
         if (channelBuffSize(c) == 0)
         {
             callback(boost::system::errc::make_error_code(boost::system::errc::success));
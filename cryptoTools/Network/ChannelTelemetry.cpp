@@ -0,0 +1,208 @@
+#include "ChannelTelemetry.h"
+#ifdef ENABLE_BOOST
+
+#include <sstream>
+
+namespace osuCrypto
+{
+
+    namespace
+    {
+        u64 ns(std::chrono::steady_clock::duration d)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        }
+
+        // the bucket of the log2 histogram.
+        u64 log2Bucket(u64 v)
+        {
+            u64 i = 0;
+            while (v && i < 63)
+            {
+                v >>= 1;
+                ++i;
+            }
+            return i;
+        }
+
+        template<typename T>
+        void writeArray(std::ostream& out, const T& values)
+        {
+            out << '[';
+            for (u64 i = 0; i < values.size(); ++i)
+                out << (i ? "," : "") << values[i];
+            out << ']';
+        }
+
+        // writes s as a JSON string.
+        void writeString(std::ostream& out, const std::string& s)
+        {
+            const char* hex = "0123456789abcdef";
+            out << '"';
+            for (unsigned char ch : s)
+            {
+                if (ch == '"' || ch == '\\')
+                    out << '\\' << ch;
+                else if (ch < 0x20)
+                    out << "\\u00" << hex[ch >> 4] << hex[ch & 15];
+                else
+                    out << ch;
+            }
+            out << '"';
+        }
+
+        // halves the number of buckets by adding adjacent pairs.
+        void mergeBuckets(std::vector<u64>& timeline)
+        {
+            for (u64 i = 0; i < timeline.size(); i += 2)
+                timeline[i / 2] = timeline[i] + (i + 1 < timeline.size() ? timeline[i + 1] : 0);
+            timeline.resize((timeline.size() + 1) / 2);
+        }
+    }
+
+    ChannelTelemetry::ChannelTelemetry(Options opt)
+        : mOpt(opt)
+        , mBegin(Clock::now())
+        , mBucketNs(ns(opt.mBucket))
+    {
+        if (mOpt.mBucket.count() <= 0)
+            throw std::runtime_error("ChannelTelemetryOptions::mBucket must be positive. " LOCATION);
+        if (mOpt.mMaxBuckets == 0)
+            throw std::runtime_error("ChannelTelemetryOptions::mMaxBuckets must be positive. " LOCATION);
+    }
+
+    void ChannelTelemetry::completed(bool send, u64 size, Clock::time_point queued, Clock::time_point started)
+    {
+        // the close and callback operations do not move any data.
+        if (size == 0 || queued < mBegin)
+            return;
+
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mMtx);
+        if (mLast != int(send))
+        {
+            ++mRounds;
+            mLast = send;
+        }
+
+        auto& d = mDirections[send];
+        ++d.mMessages;
+        d.mBytes += size;
+        ++d.mQueueWait[log2Bucket(ns(started - queued))];
+        ++d.mWire[log2Bucket(ns(now - started))];
+
+        // both directions share the width so that they stay aligned.
+        auto bucket = ns(now - mBegin) / mBucketNs;
+        while (bucket >= mOpt.mMaxBuckets)
+        {
+            for (auto& dd : mDirections)
+                mergeBuckets(dd.mTimeline);
+            mBucketNs *= 2;
+            bucket = ns(now - mBegin) / mBucketNs;
+        }
+        if (d.mTimeline.size() <= bucket)
+            d.mTimeline.resize(bucket + 1);
+        d.mTimeline[bucket] += size;
+
+        if (mMessages.size() < mOpt.mMaxMessages)
+            mMessages.push_back({ send, size, ns(queued - mBegin), ns(started - mBegin), ns(now - mBegin) });
+    }
+
+    u64 ChannelTelemetry::rounds() const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        return mRounds;
+    }
+
+    std::chrono::nanoseconds ChannelTelemetry::bucketWidth() const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        return std::chrono::nanoseconds(mBucketNs);
+    }
+
+    ChannelTelemetry::Direction ChannelTelemetry::direction(bool send) const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        return mDirections[send];
+    }
+
+    std::vector<ChannelTelemetry::Message> ChannelTelemetry::messages() const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        return mMessages;
+    }
+
+    void ChannelTelemetry::writeJson(std::ostream& out) const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        out << "{\"rounds\":" << mRounds
+            << ",\"bucketUs\":" << mBucketNs / 1000.0;
+        for (bool send : { true, false })
+        {
+            auto& d = mDirections[send];
+            out << ",\"" << (send ? "send" : "recv") << "\":{"
+                << "\"messages\":" << d.mMessages
+                << ",\"bytes\":" << d.mBytes
+                << ",\"queueWaitLog2Ns\":";
+            writeArray(out, d.mQueueWait);
+            out << ",\"wireLog2Ns\":";
+            writeArray(out, d.mWire);
+            out << ",\"timeline\":";
+            writeArray(out, d.mTimeline);
+            out << '}';
+        }
+
+        // [send, size, queued, started, completed]
+        out << ",\"messages\":[";
+        for (u64 i = 0; i < mMessages.size(); ++i)
+        {
+            auto& m = mMessages[i];
+            out << (i ? "," : "") << '[' << int(m.mSend) << ',' << m.mSize << ','
+                << m.mQueued << ',' << m.mStarted << ',' << m.mCompleted << ']';
+        }
+        out << "]}";
+    }
+
+    std::string ChannelTelemetry::toJson() const
+    {
+        std::stringstream ss;
+        writeJson(ss);
+        return ss.str();
+    }
+
+    void ChannelTelemetry::writeChromeTrace(std::ostream& out, const std::string& name) const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+
+        // the trace event format has the times in microseconds.
+        auto us = [](u64 t) { return t / 1000.0; };
+        out << "{\"traceEvents\":[";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":";
+        writeString(out, name);
+        out << "}}";
+        out << ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"send\"}}";
+        out << ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"recv\"}}";
+        for (auto& m : mMessages)
+        {
+            auto tid = m.mSend ? 1 : 2;
+            if (m.mStarted > m.mQueued)
+                out << ",{\"name\":\"queued\",\"cat\":\"queue\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                    << ",\"ts\":" << us(m.mQueued) << ",\"dur\":" << us(m.mStarted - m.mQueued) << '}';
+
+            out << ",{\"name\":\"" << (m.mSend ? "send " : "recv ") << m.mSize
+                << "\",\"cat\":\"wire\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << us(m.mStarted) << ",\"dur\":" << us(m.mCompleted - m.mStarted)
+                << ",\"args\":{\"bytes\":" << m.mSize << "}}";
+        }
+        out << "],\"displayTimeUnit\":\"ns\"}";
+    }
+
+    std::string ChannelTelemetry::toChromeTrace(const std::string& name) const
+    {
+        std::stringstream ss;
+        writeChromeTrace(ss, name);
+        return ss.str();
+    }
+
+}
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Common/Defines.h"
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace osuCrypto
+{
+
+    // The options of a ChannelTelemetry.
+    struct ChannelTelemetryOptions
+    {
+        // the number of messages that are recorded individually. The
+        // totals, histograms and timeline include all of them.
+        u64 mMaxMessages = 1 << 16;
+
+        // the width of a bucket of the throughput timeline.
+        std::chrono::microseconds mBucket{ 1000 };
+
+        // the maximum number of buckets of the timeline. Once a channel
+        // outlives them, adjacent buckets are merged and the width is
+        // doubled, so a timeline takes at most this many u64 per direction
+        // and covers the whole lifetime of the channel.
+        u64 mMaxBuckets = 1 << 12;
+    };
+
+    // Records the messages of a Channel, see Channel::enableTelemetry. For
+    // each message it records
+    //
+    //  - the queue wait, from when it was queued until the channel started
+    //    to send or receive it, e.g. behind the messages before it.
+    //  - the time on the wire, from then until the socket completed it. For
+    //    a receive this includes waiting for the peer to send it.
+    //
+    // It also counts the rounds, i.e. the number of times that the channel
+    // switched between sending and receiving, and the bytes in each bucket
+    // of time. A slow protocol with a large queue wait is limited by the
+    // network bandwidth while a large receive wire time over many rounds
+    // means it waits for the peer, i.e. its compute or the latency.
+    //
+    // The times are in nanoseconds since the telemetry was enabled.
+    class ChannelTelemetry
+    {
+    public:
+        using Options = ChannelTelemetryOptions;
+        using Clock = std::chrono::steady_clock;
+
+        // element i counts the durations of [2^(i-1), 2^i) ns, and element
+        // zero those of zero.
+        using Histogram = std::array<u64, 64>;
+
+        struct Message
+        {
+            bool mSend;
+            u64 mSize;
+            u64 mQueued, mStarted, mCompleted;
+        };
+
+        // the totals of a direction.
+        struct Direction
+        {
+            u64 mMessages = 0, mBytes = 0;
+            Histogram mQueueWait{}, mWire{};
+
+            // the bytes completed in each bucket of the timeline, see
+            // ChannelTelemetry::bucketWidth.
+            std::vector<u64> mTimeline;
+        };
+
+        ChannelTelemetry(Options opt = {});
+
+        // called by the channel once an operation that was queued and
+        // started at the given times has completed. Operations that were
+        // queued before the telemetry was enabled are skipped.
+        void completed(bool send, u64 size, Clock::time_point queued, Clock::time_point started);
+
+        u64 rounds() const;
+
+        // the current width of a bucket of the timeline. It starts at
+        // mBucket and is doubled each time the buckets are merged.
+        std::chrono::nanoseconds bucketWidth() const;
+
+        Direction direction(bool send) const;
+        std::vector<Message> messages() const;
+
+        // the totals, histograms, timeline and messages as a JSON object.
+        void writeJson(std::ostream& out) const;
+        std::string toJson() const;
+
+        // the messages as a trace for chrome://tracing or ui.perfetto.dev,
+        // with a thread for the sends and one for the receives of the
+        // process named name, which is escaped.
+        void writeChromeTrace(std::ostream& out, const std::string& name = "channel") const;
+        std::string toChromeTrace(const std::string& name = "channel") const;
+
+    private:
+        Options mOpt;
+        Clock::time_point mBegin;
+
+        mutable std::mutex mMtx;
+        std::array<Direction, 2> mDirections;
+        std::vector<Message> mMessages;
+        u64 mRounds = 0;
+        u64 mBucketNs;
+        int mLast = -1;
+    };
+
+}
+#endif
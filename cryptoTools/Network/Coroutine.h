@@ -0,0 +1,386 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#if defined(ENABLE_BOOST) && defined(__cpp_impl_coroutine)
+
+#include <cryptoTools/Network/Channel.h>
+#include <cryptoTools/Network/IOService.h>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// Coroutines on top of the channel queues. A protocol is written as a Task
+// that awaits the sends and receives of its channels, e.g.
+//
+//   Task<u64> pingPong(Channel& chl)
+//   {
+//       u64 v = 0;
+//       co_await coSend(chl, v);
+//       co_await coRecv(chl, v);
+//       co_return v;
+//   }
+//
+//   auto fu = spawn(ios, pingPong(chl));
+//   auto v = fu.get();
+//
+// A suspended task does not hold a thread, so thousands of them can run on
+// the few threads of the IOService. Each operation is queued on the channel
+// like asyncSend and asyncRecv and once it completes the task is resumed on
+// one of the threads of the IOService.
+
+namespace osuCrypto
+{
+    template<typename T = void>
+    class Task;
+
+    namespace details
+    {
+        struct TaskPromiseBase
+        {
+            // the coroutine that awaits this task, if any.
+            std::coroutine_handle<> mContinuation;
+            std::exception_ptr mException;
+
+            // the task is started once it is awaited.
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept { return false; }
+
+                template<typename P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+                {
+                    auto c = h.promise().mContinuation;
+                    return c ? c : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            // resume the awaiting coroutine without growing the stack.
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() { mException = std::current_exception(); }
+        };
+
+        template<typename T>
+        struct TaskPromise : TaskPromiseBase
+        {
+            std::optional<T> mValue;
+
+            Task<T> get_return_object();
+
+            void return_value(T v) { mValue.emplace(std::move(v)); }
+
+            T result()
+            {
+                if (mException)
+                    std::rethrow_exception(mException);
+                return std::move(*mValue);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase
+        {
+            Task<void> get_return_object();
+
+            void return_void() {}
+
+            void result()
+            {
+                if (mException)
+                    std::rethrow_exception(mException);
+            }
+        };
+    }
+
+    // A lazily started coroutine that returns a T. It runs once it is
+    // awaited and then resumes the coroutine that awaited it. Use spawn to
+    // run it on an IOService.
+    template<typename T>
+    class Task
+    {
+    public:
+        using promise_type = details::TaskPromise<T>;
+        using handle = std::coroutine_handle<promise_type>;
+
+        Task() = default;
+        explicit Task(handle h) : mHandle(h) {}
+        Task(const Task&) = delete;
+        Task(Task&& o) noexcept : mHandle(std::exchange(o.mHandle, {})) {}
+
+        Task& operator=(Task&& o) noexcept
+        {
+            if (this != &o)
+            {
+                if (mHandle)
+                    mHandle.destroy();
+                mHandle = std::exchange(o.mHandle, {});
+            }
+            return *this;
+        }
+
+        ~Task()
+        {
+            if (mHandle)
+                mHandle.destroy();
+        }
+
+        struct Awaiter
+        {
+            handle mHandle;
+
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept
+            {
+                mHandle.promise().mContinuation = c;
+                return mHandle;
+            }
+
+            T await_resume() { return mHandle.promise().result(); }
+        };
+
+        // a task can only be awaited once.
+        Awaiter operator co_await() noexcept { return { mHandle }; }
+
+        handle mHandle;
+    };
+
+    namespace details
+    {
+        template<typename T>
+        Task<T> TaskPromise<T>::get_return_object()
+        {
+            return Task<T>(Task<T>::handle::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object()
+        {
+            return Task<void>(Task<void>::handle::from_promise(*this));
+        }
+
+        // A coroutine that destroys itself once it completes.
+        struct Detached
+        {
+            struct promise_type
+            {
+                Detached get_return_object() { return { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+
+            std::coroutine_handle<promise_type> mHandle;
+        };
+
+        template<typename T>
+        Detached spawnTask(Task<T> task, std::promise<T> prom)
+        {
+            try
+            {
+                if constexpr (std::is_void<T>::value)
+                {
+                    co_await task;
+                    prom.set_value();
+                }
+                else
+                    prom.set_value(co_await task);
+            }
+            catch (...)
+            {
+                prom.set_exception(std::current_exception());
+            }
+        }
+
+        inline void postResume(boost::asio::io_context& ios, std::coroutine_handle<> h)
+        {
+            boost::asio::post(ios.get_executor(), [h]() { h.resume(); });
+        }
+
+        // An operation that resumes the coroutine h on the IOService once it
+        // completes. The result is taken from the future of T.
+        template<typename T>
+        class WithResume : public T
+        {
+        public:
+
+            template<typename... Args>
+            WithResume(std::coroutine_handle<> h, Args&& ... args)
+                : T(std::forward<Args>(args)...)
+                , mHandle(h)
+            {}
+
+            WithResume(WithResume<T>&& v)
+                : T(std::move(v))
+                , mHandle(v.mHandle)
+            {}
+
+            std::coroutine_handle<> mHandle;
+            io_completion_handle mWithResumeCompletionHandle;
+
+            void asyncPerform(ChannelBase* base, io_completion_handle&& completionHandle) override
+            {
+                mWithResumeCompletionHandle = std::move(completionHandle);
+
+                T::asyncPerform(base, [this, base](const error_code& ec, u64 bytes) mutable
+                    {
+                        // the completion handle can free this operation.
+                        auto h = mHandle;
+                        auto& ios = getIOService(base);
+                        auto fn = std::move(mWithResumeCompletionHandle);
+                        fn(ec, bytes);
+                        postResume(ios, h);
+                    });
+            }
+
+            void asyncCancel(ChannelBase* base, const error_code& ec, io_completion_handle&& completionHandle) override
+            {
+                auto h = mHandle;
+                auto& ios = getIOService(base);
+                T::asyncCancel(base, ec, std::forward<io_completion_handle>(completionHandle));
+                postResume(ios, h);
+            }
+        };
+
+        // The awaitable of coSend and coRecv. Once the coroutine is suspended
+        // the operation is queued by mEnque, which sets mFuture.
+        template<typename F>
+        class ChannelAwaitable
+        {
+        public:
+            ChannelAwaitable(F&& enque, bool ready)
+                : mEnque(std::move(enque))
+                , mReady(ready)
+            {}
+
+            F mEnque;
+            bool mReady;
+            std::future<void> mFuture;
+
+            bool await_ready() const noexcept { return mReady; }
+
+            // the coroutine can be resumed on another thread before this
+            // returns, so nothing is accessed after the operation is queued.
+            void await_suspend(std::coroutine_handle<> h) { mEnque(h, mFuture); }
+
+            // throws the error of the operation, as send and recv do.
+            void await_resume()
+            {
+                if (mFuture.valid())
+                    mFuture.get();
+            }
+        };
+
+        template<typename F>
+        ChannelAwaitable<F> makeChannelAwaitable(F&& enque, bool ready)
+        {
+            return ChannelAwaitable<F>(std::forward<F>(enque), ready);
+        }
+    }
+
+    // Runs the task on the IOService. The future is set to its result or
+    // exception once it completes.
+    template<typename T>
+    std::future<T> spawn(IOService& ios, Task<T> task)
+    {
+        std::promise<T> prom;
+        auto fu = prom.get_future();
+        auto d = details::spawnTask(std::move(task), std::move(prom));
+        details::postResume(ios.mIoService, d.mHandle);
+        return fu;
+    }
+
+    // Suspends the coroutine and resumes it on one of the threads of the
+    // IOService, e.g. to yield to the other tasks or to move the caller of
+    // a task onto the IOService.
+    inline auto schedule(IOService& ios)
+    {
+        struct Awaiter
+        {
+            IOService& mIos;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { details::postResume(mIos.mIoService, h); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{ ios };
+    }
+
+    // Sends length elements of data, like Channel::send. The data must not
+    // be modified until the awaitable completes.
+    template<typename T, typename std::enable_if<std::is_trivial<T>::value, int>::type = 0>
+    auto coSend(Channel& chl, const T* data, u64 length)
+    {
+        auto buff = (u8*)data;
+        auto size = length * sizeof(T);
+        return details::makeChannelAwaitable(
+            [&chl, buff, size](std::coroutine_handle<> h, std::future<void>& fu) {
+                auto op = make_SBO_ptr<
+                    details::SendOperation,
+                    details::WithResume<details::WithPromise<details::FixedSendBuff>>>
+                    (h, fu, buff, size);
+                chl.mBase->sendEnque(std::move(op));
+            }, size == 0);
+    }
+
+    template<typename T, typename std::enable_if<std::is_trivial<T>::value, int>::type = 0>
+    auto coSend(Channel& chl, const T& data)
+    {
+        return coSend(chl, &data, 1);
+    }
+
+    template<typename Container, typename std::enable_if<is_container<Container>::value, int>::type = 0>
+    auto coSend(Channel& chl, const Container& c)
+    {
+        return coSend(chl, (const u8*)channelBuffData(c), channelBuffSize(c));
+    }
+
+    // Receives length elements into dest, like Channel::recv.
+    template<typename T, typename std::enable_if<std::is_trivial<T>::value, int>::type = 0>
+    auto coRecv(Channel& chl, T* dest, u64 length)
+    {
+        auto buff = (u8*)dest;
+        auto size = length * sizeof(T);
+        return details::makeChannelAwaitable(
+            [&chl, buff, size](std::coroutine_handle<> h, std::future<void>& fu) {
+                auto op = make_SBO_ptr<
+                    details::RecvOperation,
+                    details::WithResume<details::FixedRecvBuff>>
+                    (h, buff, size, fu);
+                chl.mBase->recvEnque(std::move(op));
+            }, size == 0);
+    }
+
+    template<typename T, typename std::enable_if<std::is_trivial<T>::value, int>::type = 0>
+    auto coRecv(Channel& chl, T& dest)
+    {
+        return coRecv(chl, &dest, 1);
+    }
+
+    // Receives into c, which is resized to fit the data if it can be and
+    // must otherwise have the correct size.
+    template<typename Container, typename std::enable_if<is_container<Container>::value, int>::type = 0>
+    auto coRecv(Channel& chl, Container& c)
+    {
+        constexpr bool resize = has_resize<Container, void(typename Container::size_type)>::value;
+        using Op = typename std::conditional<resize,
+            details::ResizableRefRecvBuff<Container>,
+            details::RefRecvBuff<Container>>::type;
+
+        return details::makeChannelAwaitable(
+            [&chl, &c](std::coroutine_handle<> h, std::future<void>& fu) {
+                auto op = make_SBO_ptr<
+                    details::RecvOperation,
+                    details::WithResume<Op>>
+                    (h, c, fu);
+                chl.mBase->recvEnque(std::move(op));
+            }, !resize && channelBuffSize(c) == 0);
+    }
+}
+#endif
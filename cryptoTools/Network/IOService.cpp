@@ -14,6 +14,9 @@
 #include <cryptoTools/Crypto/AES.h>
 
 #include <stdio.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 #include <algorithm>
 #include <sstream>
 #include "util.h"
@@ -97,10 +100,14 @@ namespace osuCrypto
             return;
         }
 
-        mAddress = *results.begin();
+        boost::asio::ip::tcp::endpoint address = *results.begin();
+        mAddress = address;
 
         mHandle.open(mAddress.protocol());
         mHandle.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        applyListenBufferSizes(ec);
+        if (ec)
+            return;
 
         //#ifdef _MSC_VER
         //        typedef boost::asio::detail::socket_option::boolean<BOOST_ASIO_OS_DEF(SOL_SOCKET), SO_EXCLUSIVEADDRUSE> excluse_address; 
@@ -110,7 +117,7 @@ namespace osuCrypto
 
         mHandle.bind(mAddress, ec);
 
-        if (mAddress.port() != port)
+        if (address.port() != port)
             throw std::runtime_error("rt error at " LOCATION);
 
         if (ec)
@@ -124,7 +131,128 @@ namespace osuCrypto
 
         //std::promise<void> mStoppedListeningPromise, mSocketChannelPairsRemovedProm;
         //std::future<void> mStoppedListeningFuture, mSocketChannelPairsRemovedFuture;
-        mHandle.listen(boost::asio::socket_base::max_listen_connections);
+        mHandle.listen(boost::asio::socket_base::max_listen_connections);
+    }
+
+    void Acceptor::bindUnix(std::string path, boost::system::error_code& ec)
+    {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        mUnixPath = std::move(path);
+        mAddress = boost::asio::local::stream_protocol::endpoint(mUnixPath);
+
+#ifndef _WIN32
+        // a previous server may have left its socket behind. It is only
+        // replaced if no one is listening on it, which a connect probes.
+        // Any other kind of file is not replaced.
+        struct stat st;
+        if (::lstat(mUnixPath.c_str(), &st) == 0)
+        {
+            if (S_ISSOCK(st.st_mode) == false)
+            {
+                ec = boost::system::errc::make_error_code(boost::system::errc::file_exists);
+                return;
+            }
+
+            boost::asio::local::stream_protocol::socket probe(mIOService.mIoService);
+            boost::system::error_code probeEc;
+            probe.open(boost::asio::local::stream_protocol(), probeEc);
+            if (!probeEc)
+                probe.non_blocking(true, probeEc);
+            if (!probeEc)
+                probe.connect(boost::asio::local::stream_protocol::endpoint(mUnixPath), probeEc);
+            probe.close();
+
+            if (probeEc != boost::system::errc::connection_refused &&
+                probeEc != boost::system::errc::no_such_file_or_directory)
+            {
+                ec = boost::system::errc::make_error_code(boost::system::errc::address_in_use);
+                return;
+            }
+            ::unlink(mUnixPath.c_str());
+        }
+#endif
+
+        mHandle.open(mAddress.protocol(), ec);
+        if (ec)
+            return;
+
+        applyListenBufferSizes(ec);
+        if (ec)
+            return;
+
+        mHandle.bind(mAddress, ec);
+        if (ec)
+            return;
+
+#ifndef _WIN32
+        // remember the file that bind created so that only it is removed.
+        if (::lstat(mUnixPath.c_str(), &st) == 0)
+        {
+            mUnixDev = st.st_dev;
+            mUnixIno = st.st_ino;
+            mUnixCreated = true;
+        }
+#endif
+
+        mHandle.listen(boost::asio::socket_base::max_listen_connections, ec);
+#else
+        std::ignore = path;
+        ec = boost::asio::error::operation_not_supported;
+#endif
+    }
+
+    void Acceptor::closeHandle()
+    {
+#ifndef _WIN32
+        struct stat st;
+        if (mUnixCreated &&
+            ::lstat(mUnixPath.c_str(), &st) == 0 &&
+            S_ISSOCK(st.st_mode) &&
+            u64(st.st_dev) == mUnixDev &&
+            u64(st.st_ino) == mUnixIno)
+            ::unlink(mUnixPath.c_str());
+        mUnixCreated = false;
+#endif
+
+        boost::system::error_code ec;
+        mHandle.close(ec);
+    }
+
+    void Acceptor::setListenBufferSizes(const SocketOptions& opt)
+    {
+        std::promise<void> prom;
+        boost::asio::dispatch(mStrand, [&]() {
+            mListenSendBufferSize = std::max<u64>(mListenSendBufferSize, opt.mSendBufferSize);
+            mListenRecvBufferSize = std::max<u64>(mListenRecvBufferSize, opt.mRecvBufferSize);
+
+            boost::system::error_code ec;
+            if (mHandle.is_open())
+                applyListenBufferSizes(ec);
+            if (ec)
+                mIOService.printError("failed to set the buffer sizes of the listening socket, " + ec.message());
+            prom.set_value();
+        });
+
+        auto f = prom.get_future();
+        mIOService.workUntil(f);
+        f.get();
+    }
+
+    void Acceptor::applyListenBufferSizes(boost::system::error_code& ec)
+    {
+        if (mListenSendBufferSize && !ec)
+            mHandle.set_option(boost::asio::socket_base::send_buffer_size(
+                static_cast<int>(mListenSendBufferSize)), ec);
+        if (mListenRecvBufferSize && !ec)
+            mHandle.set_option(boost::asio::socket_base::receive_buffer_size(
+                static_cast<int>(mListenRecvBufferSize)), ec);
+    }
+
+    std::string Acceptor::address() const
+    {
+        if (mUnixPath.size())
+            return "unix:" + mUnixPath;
+        return "port " + std::to_string(mPort);
     }
 
     void Acceptor::start()
@@ -139,7 +267,7 @@ namespace osuCrypto
                 sockIter->mIdx = mPendingSocketIdx++;
                 //#endif
                 LOG_MSG("listening with socket#" + std::to_string(sockIter->mIdx) +
-                    " at " + mAddress.address().to_string() + " : " + std::to_string(mAddress.port()));
+                    " at " + address());
                 
                 //BoostSocketInterface* newSocket = new BoostSocketInterface(mIOService.mIoService);
                 mHandle.async_accept(sockIter->mSock, [sockIter, this](const boost::system::error_code& ec)
@@ -153,7 +281,8 @@ namespace osuCrypto
 
                             boost::asio::ip::tcp::no_delay option(true);
                             boost::system::error_code ec2;
-                            sockIter->mSock.set_option(option, ec2);
+                            if (mUnixPath.empty())
+                                sockIter->mSock.set_option(option, ec2);
                             if (ec2)
                                 erasePendingSocket(sockIter);
                             else
@@ -173,7 +302,7 @@ namespace osuCrypto
                             
                             // if the error code is not for operation canceled, print it to the terminal.
                             if (ec.value() != boost::asio::error::operation_aborted && mIOService.mPrint)
-                                std::cout << "Acceptor.listen failed for socket#" << std::to_string(sockIter->mIdx) << " at port "<< mPort 
+                                std::cout << "Acceptor.listen failed for socket#" << std::to_string(sockIter->mIdx) << " at "<< address() 
                                     << " ~~ " << ec.message() << " " << ec.value() << std::endl;
 
                             erasePendingSocket(sockIter);
@@ -249,8 +378,8 @@ namespace osuCrypto
 
                                 asyncSetSocket(
                                     std::move(sockIter->mBuff),
-                                    std::unique_ptr<BoostSocketInterface>(
-                                        new BoostSocketInterface(std::move(sockIter->mSock))));
+                                    std::unique_ptr<StreamSocketInterface>(
+                                        new StreamSocketInterface(std::move(sockIter->mSock))));
                             }
                             else
                             {
@@ -302,7 +431,7 @@ namespace osuCrypto
 
                     //std::cout << IoStream::lock << " accepter stop() " << mPort << std::endl << IoStream::unlock;
 
-                    mHandle.close();
+                    closeHandle();
 
                     // cancel any sockets which have not completed the handshake.
                     for (auto& pendingSocket : mPendingSockets)
@@ -363,7 +492,7 @@ namespace osuCrypto
                 mListening = false;
 
                 //std::cout << IoStream::lock << "stop listening " << std::endl << IoStream::unlock;
-                mHandle.close();
+                closeHandle();
 
                 if (stopped())
                 {
@@ -469,7 +598,10 @@ namespace osuCrypto
                 {
                     mListening = true;
                     boost::system::error_code ec;
-                    bind(session->mPort, session->mIP, ec);
+                    if (session->mUnixPath.size())
+                        bindUnix(session->mUnixPath, ec);
+                    else
+                        bind(session->mPort, session->mIP, ec);
 
                     if (ec) {
                         ch(ec);
@@ -688,11 +820,11 @@ namespace osuCrypto
 
     void Acceptor::asyncSetSocket(
         std::string name,
-        std::unique_ptr<BoostSocketInterface> s)
+        std::unique_ptr<StreamSocketInterface> s)
     {
         auto ss = s.release();
         boost::asio::dispatch(mStrand, [this, name, ss]() {
-            std::unique_ptr<BoostSocketInterface> sock(ss);
+            std::unique_ptr<StreamSocketInterface> sock(ss);
 
             auto names = split(name, '`');
 
@@ -969,7 +1101,8 @@ namespace osuCrypto
                     mAcceptors.begin(),
                     mAcceptors.end(), [&](const Acceptor& acptr)
                     {
-                        return acptr.mPort == session->mPort;
+                        return acptr.mPort == session->mPort &&
+                            acptr.mUnixPath == session->mUnixPath;
                     });
 
                 if (acceptorIter == mAcceptors.end())
@@ -978,6 +1111,7 @@ namespace osuCrypto
                     mAcceptors.emplace_back(*this);
                     acceptorIter = mAcceptors.end(); --acceptorIter;
                     acceptorIter->mPort = session->mPort;
+                    acceptorIter->mUnixPath = session->mUnixPath;
                 }
 
                 acceptorIter->asyncSubscribe(session, [&](const error_code& ec) {
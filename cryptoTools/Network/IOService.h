@@ -106,7 +106,7 @@ namespace osuCrypto
         // be converted to a NamedSocket and matched with a Channel.
         struct PendingSocket {
             PendingSocket(AsioContext& ios) : mSock(ios) {}
-            boost::asio::ip::tcp::socket mSock;
+            boost::asio::generic::stream_protocol::socket mSock;
             std::string mBuff;
 //#ifdef ENABLE_NET_LOG
             u64 mIdx = 0;
@@ -120,7 +120,7 @@ namespace osuCrypto
 			NamedSocket(NamedSocket&&) = default;
 
 			std::string mLocalName, mRemoteName;
-			std::unique_ptr<BoostSocketInterface> mSocket;
+			std::unique_ptr<StreamSocketInterface> mSocket;
 		};
 
         // A group of sockets from a single remote session which 
@@ -219,7 +219,7 @@ namespace osuCrypto
 		IOService& mIOService;
 
 		AsioStrand mStrand;
-		boost::asio::ip::tcp::acceptor mHandle;
+		boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> mHandle;
 
 		std::atomic<bool> mStopped;
 
@@ -264,7 +264,7 @@ namespace osuCrypto
         // and matches the name with a compatable ChannelBase. SessionName is not unique,
         // the remote and local name of the channel itself will be used. Note SessionID
         // will always be unique.
-		void asyncSetSocket(std::string name,std::unique_ptr<BoostSocketInterface> handel);
+		void asyncSetSocket(std::string name,std::unique_ptr<StreamSocketInterface> handel);
 
         // Let the acceptor know that this channel is looking for a socket
         // with a matching name.
@@ -294,9 +294,43 @@ namespace osuCrypto
 
 		void stopListening();
 		u64 mPort;
-		boost::asio::ip::tcp::endpoint mAddress;
+
+		// The path of the unix domain socket that this acceptor listens
+		// on. Empty if it listens on mPort.
+		std::string mUnixPath;
+		boost::asio::generic::stream_protocol::endpoint mAddress;
+
+		// the device and inode of the socket file that bindUnix created.
+		bool mUnixCreated = false;
+		u64 mUnixDev = 0, mUnixIno = 0;
 
 		void bind(u32 port, std::string ip, boost::system::error_code& ec);
+
+		// listen on the unix domain socket at path. A socket that was left
+		// at path is replaced if no one listens on it, and otherwise this
+		// fails with address_in_use. Any other file fails with file_exists.
+		// The socket is removed once we stop listening.
+		void bindUnix(std::string path, boost::system::error_code& ec);
+
+		// the largest buffer sizes that the sessions of this acceptor have
+		// set, see setListenBufferSizes.
+		u64 mListenSendBufferSize = 0, mListenRecvBufferSize = 0;
+
+		// raises the buffer sizes of the listening socket to those of opt.
+		// The accepted sockets inherit them, which for the receive buffer
+		// must happen before the connection is made for the window scale
+		// to reflect it. Returns once they are set.
+		void setListenBufferSizes(const SocketOptions& opt);
+
+		// sets mListenSendBufferSize and mListenRecvBufferSize on mHandle.
+		void applyListenBufferSizes(boost::system::error_code& ec);
+
+		// closes mHandle and removes the socket file that bindUnix created,
+		// if it is still there.
+		void closeHandle();
+
+		// a printable form of the address that we listen on.
+		std::string address() const;
 		void start();
 		void stop();
 		bool stopped() const;
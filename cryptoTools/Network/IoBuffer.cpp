@@ -6,6 +6,7 @@
 #include "IOService.h"
 #include <sstream>
 #include <exception>
+#include <cstring>
 
 namespace osuCrypto
 {
@@ -22,6 +23,16 @@ namespace osuCrypto
             //    lout << base->mLog << std::endl;
             //}
 
+            if (base->mSendGathering)
+            {
+                // the send loop will write our buffers along with those of
+                // the following operations and then call the handle.
+                auto buffers = getSendBuffer();
+                base->mGatherBuffers.insert(base->mGatherBuffers.end(), buffers.begin(), buffers.end());
+                base->mGatherHandles.emplace_back(std::move(completionHandle), gatherSize());
+                return;
+            }
+
             base->mSendBuffers = getSendBuffer();
             base->mHandle->async_send(base->mSendBuffers, 
                 std::forward<io_completion_handle>(completionHandle));
@@ -36,74 +47,177 @@ namespace osuCrypto
             if (!mComHandle)
                 throw NetworkException(LOCATION);
 
+            if (base->mRecvAhead.size())
+            {
+                asyncRecvAheadHeader();
+                return;
+            }
+
             // first we have to receive the header which tells us how much.
             base->mRecvBuffer = getRecvHeaderBuffer();
             base->mHandle->async_recv({&base->mRecvBuffer, 1}, [this](const error_code& ec, u64 bt1) {
                 
-                if (!ec)
+                if (ec)
+                    complete(ec, bt1);
+                else if (isExtendedHeader())
                 {
-                    // check that the buffer has enough space. Resize if not.
-                    if (getHeaderSize() != getBufferSize())
-                    {
-                        resizeBuffer(getHeaderSize());
-
-                        // check that the resize was successful.
-                        if (getHeaderSize() != getBufferSize())
-                        {
-                            std::stringstream ss;
-                            ss << "Bad receive buffer size.\n"
-                                <<         "  Size transmitted: " << getHeaderSize()
-                                << " bytes\n  Size of buffer:   " << getBufferSize() << " bytes\n";
-
-                            // make the channel to know that a receive has a partial failure.
-                            // The partial error can be cleared if the following lambda is 
-                            // called by the user. This will complete the receive operation.
-                            //mBase->setBadRecvErrorState(ss.str());
-
-                            // give the user a chance to give us another location 
-                            // by passing out an exception which they can call.
-                            mPromise.set_exception(std::make_exception_ptr(
-                                BadReceiveBufferSize(ss.str(), getHeaderSize())));
-
-                            auto ec = boost::system::errc::make_error_code(boost::system::errc::no_buffer_space);
-                            mComHandle(ec, sizeof(u32));
-                            return;
-                        }
-                    }
-
-                    // the normal case that the buffer is the right size or was correctly resized.
-                    mBase->mRecvBuffer = getRecvBuffer();
-                    mBase->mHandle->async_recv({ &mBase->mRecvBuffer , 1 }, [this, bt1](const error_code& ec, u64 bt2)
-                    {
-
-                        if (!ec) 
-                            mPromise.set_value();
-                        else 
-                            mPromise.set_exception(std::make_exception_ptr(NetworkException(ec.message())));
-                        
-                        if (!mComHandle)
-                            throw NetworkException(LOCATION);
-
-#ifdef ENABLE_NET_LOG
-                        if(ec)
-                            log("FixedRecvBuff error " + std::to_string(mIdx) + "   " +  LOCATION);
+                    // a message of 4 GiB or more, its size follows.
+                    mBase->mRecvBuffer = getRecvExtendedHeaderBuffer();
+                    mBase->mHandle->async_recv({ &mBase->mRecvBuffer, 1 }, [this, bt1](const error_code& ec, u64 bt2) {
+                        if (ec)
+                            complete(ec, bt1 + bt2);
                         else
-                            log("FixedRecvBuff success " + std::to_string(mIdx) + "   " + LOCATION);
-
-#endif
-                        mComHandle(ec, bt1 + bt2);
+                            asyncRecvBody(bt1 + bt2);
                     });
                 }
                 else
+                    asyncRecvBody(bt1);
+            });
+
+        }
+
+        void FixedRecvBuff::asyncRecvBody(u64 headerBytes)
+        {
+            if (resizeToHeader() == false)
+                return;
+
+            // the normal case that the buffer is the right size or was correctly resized.
+            mBase->mRecvBuffer = getRecvBuffer();
+            mBase->mHandle->async_recv({ &mBase->mRecvBuffer , 1 }, [this, headerBytes](const error_code& ec, u64 bt2)
+            {
+                complete(ec, headerBytes + bt2);
+            });
+        }
+
+        bool FixedRecvBuff::resizeToHeader()
+        {
+            // check that the buffer has enough space. Resize if not.
+            if (getHeaderSize() != getBufferSize())
+            {
+                resizeBuffer(getHeaderSize());
+
+                // check that the resize was successful.
+                if (getHeaderSize() != getBufferSize())
                 {
+                    std::stringstream ss;
+                    ss << "Bad receive buffer size.\n"
+                        <<         "  Size transmitted: " << getHeaderSize()
+                        << " bytes\n  Size of buffer:   " << getBufferSize() << " bytes\n";
+
+                    // make the channel to know that a receive has a partial failure.
+                    // The partial error can be cleared if the following lambda is 
+                    // called by the user. This will complete the receive operation.
+                    //mBase->setBadRecvErrorState(ss.str());
+
+                    // give the user a chance to give us another location 
+                    // by passing out an exception which they can call.
+                    mPromise.set_exception(std::make_exception_ptr(
+                        BadReceiveBufferSize(ss.str(), getHeaderSize())));
+
+                    auto ec = boost::system::errc::make_error_code(boost::system::errc::no_buffer_space);
+                    mComHandle(ec, getRecvHeaderLength());
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void FixedRecvBuff::complete(const error_code& ec, u64 bytesTransferred)
+        {
+            if (!ec) 
+                mPromise.set_value();
+            else 
+                mPromise.set_exception(std::make_exception_ptr(NetworkException(ec.message())));
+            
+            if (!mComHandle)
+                throw NetworkException(LOCATION);
+
 #ifdef ENABLE_NET_LOG
-                    log("FixedRecvBuff error " + std::to_string(mIdx) + " " + ec.message() +"  " + LOCATION);
+            if(ec)
+                log("FixedRecvBuff error " + std::to_string(mIdx) + " " + ec.message() + "  " + LOCATION);
+            else
+                log("FixedRecvBuff success " + std::to_string(mIdx) + "   " + LOCATION);
+
 #endif
-                    mPromise.set_exception(std::make_exception_ptr(NetworkException(ec.message())));
-                    mComHandle(ec, bt1);
-                }
-            });
+            mComHandle(ec, bytesTransferred);
+        }
+
+        void FixedRecvBuff::asyncRecvAheadHeader()
+        {
+            // the header is 4 bytes or, if extended, 12 bytes.
+            auto avail = mBase->mRecvAheadEnd - mBase->mRecvAheadBegin;
+            auto length = sizeof(size_header_type);
+            if (avail >= length)
+            {
+                memcpy(mHeader, mBase->mRecvAhead.data() + mBase->mRecvAheadBegin, length);
+                if (isExtendedHeader())
+                    length += sizeof(u64);
+            }
 
+            if (avail < length)
+            {
+                mBase->asyncRecvAhead(length - avail, [this](const error_code& ec, u64) {
+                    if (ec)
+                        complete(ec, 0);
+                    else
+                        asyncRecvAheadHeader();
+                });
+                return;
+            }
+
+            memcpy(mHeader, mBase->mRecvAhead.data() + mBase->mRecvAheadBegin, length);
+            mBase->mRecvAheadBegin += length;
+
+            if (resizeToHeader())
+                asyncRecvAheadBody(0);
+        }
+
+        void FixedRecvBuff::asyncRecvAheadBody(u64 pos)
+        {
+            auto avail = mBase->mRecvAheadEnd - mBase->mRecvAheadBegin;
+            auto n = std::min<u64>(avail, getBufferSize() - pos);
+            memcpy(getBufferData() + pos, mBase->mRecvAhead.data() + mBase->mRecvAheadBegin, n);
+            mBase->mRecvAheadBegin += n;
+            pos += n;
+
+            auto remaining = getBufferSize() - pos;
+            auto bytes = getRecvHeaderLength() + getBufferSize();
+            if (remaining == 0)
+            {
+                // completing inline starts the next receive from within this
+                // call. Every so often we complete from the io service instead
+                // so that a long run of buffered messages does not overflow
+                // the stack.
+                if (mBase->mRecvAheadDepth < 16)
+                {
+                    auto base = mBase;
+                    ++base->mRecvAheadDepth;
+                    complete(make_error_code(Errc::success), bytes);
+                    --base->mRecvAheadDepth;
+                }
+                else
+                    boost::asio::post(getIOService(mBase).get_executor(), [this, bytes]() {
+                        complete(make_error_code(Errc::success), bytes);
+                    });
+            }
+            else if (remaining >= mBase->mRecvAhead.size() / 2)
+            {
+                // the read-ahead buffer is now empty and the rest is large,
+                // read it directly into the user's memory.
+                mBase->mRecvBuffer = boost::asio::mutable_buffer(getBufferData() + pos, remaining);
+                mBase->mHandle->async_recv({ &mBase->mRecvBuffer, 1 }, [this, bytes](const error_code& ec, u64) {
+                    complete(ec, ec ? 0 : bytes);
+                });
+            }
+            else
+            {
+                mBase->asyncRecvAhead(remaining, [this, pos](const error_code& ec, u64) {
+                    if (ec)
+                        complete(ec, 0);
+                    else
+                        asyncRecvAheadBody(pos);
+                });
+            }
         }
 
 
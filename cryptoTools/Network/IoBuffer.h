@@ -9,6 +9,8 @@
 #include <string> 
 #include <future> 
 #include <cassert> 
+#include <chrono>
+#include <cstring>
 #include <functional> 
 #include <memory> 
 #include <boost/asio.hpp>
@@ -261,6 +263,10 @@ namespace osuCrypto
 
             virtual std::string toString() const = 0;
 
+            // when the operation was queued and started, which are only set
+            // if the channel has telemetry, see Channel::enableTelemetry.
+            std::chrono::steady_clock::time_point mQueued, mStarted;
+
 #ifdef ENABLE_NET_LOG
             u64 mIdx = 0;
             Log* mLog = nullptr;
@@ -269,7 +275,15 @@ namespace osuCrypto
         };
 
         class RecvOperation : public ChlOperation { };
-        class SendOperation : public ChlOperation { };
+        class SendOperation : public ChlOperation
+        {
+        public:
+            // The number of bytes this operation writes if it only writes a
+            // sized buffer, and zero otherwise. Non-zero operations can be
+            // gathered with their neighbors into a single write, see
+            // ChannelBase::asyncPerformSend.
+            virtual u64 gatherSize() const { return 0; }
+        };
 
         template<typename Base>
         struct BaseCallbackOp : public Base
@@ -307,6 +321,20 @@ namespace osuCrypto
 
         using size_header_type = u32;
 
+        // A header with this value is followed by the size as a u64. This
+        // frames messages of 4 GiB or more while smaller messages keep the
+        // 4 byte header.
+        constexpr size_header_type extendedSizeHeader = ~size_header_type(0);
+
+        // The number of header bytes of a message with size bytes. The
+        // receiver reads the length from the header, see getRecvHeaderLength.
+        constexpr u64 sizeHeaderLength(u64 size)
+        {
+            return size < extendedSizeHeader ?
+                sizeof(size_header_type) :
+                sizeof(size_header_type) + sizeof(u64);
+        }
+
         // A class for sending or receiving data over a channel. 
         // Datam sent/received with this type sent over the network 
         // with a header denoting its size in bytes.
@@ -316,38 +344,60 @@ namespace osuCrypto
 
             BasicSizedBuff(BasicSizedBuff&& v)
             {
-                mHeaderSize = v.mHeaderSize;
+                memcpy(mHeader, v.mHeader, sizeof(mHeader));
                 mBuff = v.mBuff;
                 v.mBuff = {};
             }
             BasicSizedBuff() = default;
 
             BasicSizedBuff(const u8* data, u64 size)
-                : mHeaderSize(size_header_type(size))
-                , mBuff{ (u8*)data,  span<u8>::size_type(size) }
+                : mBuff{ (u8*)data,  span<u8>::size_type(size) }
             {
-                assert(size < std::numeric_limits<size_header_type>::max());
+                setHeaderSize(size);
             }
 
             void set(const u8* data, u64 size)
             {
-                assert(size < std::numeric_limits<size_header_type>::max());
                 mBuff = { (u8*)data, span<u8>::size_type(size) };
             }
 
-            inline u64 getHeaderSize() const { return mHeaderSize; }
+            inline u64 getHeaderSize() const
+            {
+                if (isExtendedHeader() == false)
+                    return mHeader[0];
+
+                u64 size;
+                memcpy(&size, &mHeader[1], sizeof(u64));
+                return size;
+            }
             inline u64 getBufferSize() const { return mBuff.size(); }
             inline u8* getBufferData() { return mBuff.data(); }
 
+            // whether the received header is followed by the u64 size.
+            inline bool isExtendedHeader() const { return mHeader[0] == extendedSizeHeader; }
+
+            // the number of bytes of the received header.
+            inline u64 getRecvHeaderLength() const
+            {
+                return sizeof(size_header_type) + (isExtendedHeader() ? sizeof(u64) : 0);
+            }
+
             inline std::array<boost::asio::mutable_buffer, 2> getSendBuffer()
             {
                 assert(mBuff.size());
-                mHeaderSize = size_header_type(mBuff.size());
-                return { { getRecvHeaderBuffer(), getRecvBuffer() } };
+                setHeaderSize(mBuff.size());
+                return { {
+                    boost::asio::mutable_buffer(mHeader, sizeHeaderLength(mBuff.size())),
+                    getRecvBuffer() } };
             }
 
             inline boost::asio::mutable_buffer getRecvHeaderBuffer() {
-                return boost::asio::mutable_buffer(&mHeaderSize, sizeof(size_header_type));
+                return boost::asio::mutable_buffer(&mHeader[0], sizeof(size_header_type));
+            }
+
+            // the u64 size that follows an extended header.
+            inline boost::asio::mutable_buffer getRecvExtendedHeaderBuffer() {
+                return boost::asio::mutable_buffer(&mHeader[1], sizeof(u64));
             }
 
             inline boost::asio::mutable_buffer getRecvBuffer() {
@@ -355,7 +405,19 @@ namespace osuCrypto
             }
 
         protected:
-            size_header_type mHeaderSize = 0;
+            void setHeaderSize(u64 size)
+            {
+                if (sizeHeaderLength(size) == sizeof(size_header_type))
+                    mHeader[0] = size_header_type(size);
+                else
+                {
+                    mHeader[0] = extendedSizeHeader;
+                    memcpy(&mHeader[1], &size, sizeof(u64));
+                }
+            }
+
+            // the size header, followed by the u64 size if it is extended.
+            size_header_type mHeader[3] = {};
             span<u8> mBuff;
         };
 
@@ -373,6 +435,8 @@ namespace osuCrypto
             FixedSendBuff(FixedSendBuff&& v) = default;
 
             void asyncPerform(ChannelBase* base, io_completion_handle&& completionHandle) override;
+
+            u64 gatherSize() const override { return sizeHeaderLength(mBuff.size()) + mBuff.size(); }
             
             void asyncCancelPending(ChannelBase* base, const error_code& ec) override {}
 
@@ -491,6 +555,22 @@ namespace osuCrypto
             std::string toString() const override;
 
             virtual void resizeBuffer(u64) {}
+
+        private:
+            // resizes the buffer to the received header. If this fails the
+            // operation is completed with an error and false is returned.
+            bool resizeToHeader();
+
+            void complete(const error_code& ec, u64 bytesTransferred);
+
+            // receive the body after a header of headerBytes bytes.
+            void asyncRecvBody(u64 headerBytes);
+
+            // receive the header and then the body from the read-ahead
+            // buffer of the channel, where pos bytes of the body have
+            // already been copied.
+            void asyncRecvAheadHeader();
+            void asyncRecvAheadBody(u64 pos);
         };
 
         template <typename F>
@@ -0,0 +1,667 @@
+#include "IoUringSocket.h"
+#if defined(ENABLE_BOOST) && defined(ENABLE_IO_URING)
+
+#include "cryptoTools/Network/IOService.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <thread>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        // the user_data of the operations that are not an Op. The
+        // completions of ignoreTag are only consumed.
+        const u64 stopTag = 1;
+        const u64 ignoreTag = 2;
+        const u64 multishotTag = 3;
+
+        int uringSetup(u32 entries, io_uring_params* p)
+        {
+            return (int)syscall(__NR_io_uring_setup, entries, p);
+        }
+
+        int uringEnter(int fd, u32 toSubmit, u32 minComplete, u32 flags)
+        {
+            return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+        }
+
+        std::runtime_error sysError(const std::string& what, int err, const char* location)
+        {
+            return std::runtime_error(what + " failed: " + strerror(err) + "\n" + location);
+        }
+
+        error_code toErrorCode(i32 res)
+        {
+            if (res == -ECANCELED)
+                return boost::asio::error::operation_aborted;
+            return error_code(-res, boost::system::system_category());
+        }
+
+        struct Completion
+        {
+            io_completion_handle mFn;
+            error_code mEc;
+            u64 mBytes;
+        };
+    }
+
+    // A send or receive. Its address is the user_data of its submissions.
+    struct IoUringOp
+    {
+        std::vector<iovec> mIov;
+
+        // the first iovec that is not complete.
+        u64 mIdx = 0;
+
+        // the number of bytes transferred and the number after which the
+        // operation is complete.
+        u64 mBytes = 0, mMinSize = 0;
+
+        msghdr mMsg;
+        io_completion_handle mFn;
+        bool mSend = false, mPending = false, mInFlight = false, mWaitAll = true;
+
+        void set(span<boost::asio::mutable_buffer> buffers, u64 minSize, io_completion_handle&& fn)
+        {
+            if (mPending)
+                throw std::runtime_error("IoUringSocket supports one outstanding operation per direction. " LOCATION);
+
+            mIov.resize(buffers.size());
+            u64 total = 0;
+            for (u64 i = 0; i < mIov.size(); ++i)
+            {
+                mIov[i].iov_base = buffers[i].data();
+                mIov[i].iov_len = buffers[i].size();
+                total += buffers[i].size();
+            }
+            mIdx = 0;
+            mBytes = 0;
+            mMinSize = std::min(minSize, total);
+            mFn = std::move(fn);
+            mPending = true;
+        }
+
+        void advance(u64 n)
+        {
+            mBytes += n;
+            while (n && mIdx < mIov.size())
+            {
+                auto& v = mIov[mIdx];
+                auto m = std::min<u64>(n, v.iov_len);
+                v.iov_base = (u8*)v.iov_base + m;
+                v.iov_len -= m;
+                n -= m;
+                if (v.iov_len == 0)
+                    ++mIdx;
+            }
+            while (mIdx < mIov.size() && mIov[mIdx].iov_len == 0)
+                ++mIdx;
+        }
+
+        bool done() const { return mBytes >= mMinSize; }
+
+        void finish(error_code ec, std::vector<Completion>& out)
+        {
+            mPending = false;
+            out.push_back({ std::move(mFn), ec, mBytes });
+        }
+    };
+
+    struct IoUringSocket::State
+    {
+        Options mOpt;
+        int mFd = -1, mRingFd = -1;
+        bool mClosed = false, mStopped = false;
+
+        // set if the ring thread could not wait for completions. The
+        // operations then fail with it.
+        error_code mRingEc;
+        IOService* mIos = nullptr;
+        std::mutex mMtx;
+        std::thread mThread;
+
+        // the mapped rings.
+        void* mSqPtr = MAP_FAILED, * mCqPtr = MAP_FAILED;
+        u64 mSqSize = 0, mCqSize = 0;
+        io_uring_sqe* mSqes = (io_uring_sqe*)MAP_FAILED;
+        u32* mSqHead = nullptr, * mSqTailPtr = nullptr, * mSqArray = nullptr;
+        u32 mSqMask = 0, mSqEntries = 0, mSqTail = 0, mSqSubmitted = 0;
+        u32* mCqHead = nullptr, * mCqTail = nullptr, mCqMask = 0;
+        io_uring_cqe* mCqes = nullptr;
+
+        IoUringOp mSend, mRecv;
+
+        // the multishot receive state. mReady holds the filled provided
+        // buffers in order, where the first mReadyBegin bytes of the front
+        // have been consumed. mFreed holds the consumed buffers that have
+        // not been provided to the kernel again.
+        struct Chunk { u16 mBid; u32 mSize; };
+        std::vector<u8> mBufData;
+        std::deque<Chunk> mReady;
+        u64 mReadyBegin = 0;
+        std::vector<u16> mFreed;
+        u64 mNumProvided = 0;
+        bool mArmed = false;
+        error_code mRecvEc;
+
+        State(int fd, Options opt)
+            : mOpt(opt)
+            , mFd(fd)
+        {
+            try {
+                setup();
+            }
+            catch (...)
+            {
+                teardown();
+                throw;
+            }
+            mThread = std::thread([this] { run(); });
+        }
+
+        ~State()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                if (mStopped == false)
+                {
+                    auto sqe = getSqe();
+                    sqe->opcode = IORING_OP_NOP;
+                    sqe->user_data = stopTag;
+                    submit();
+                }
+            }
+            mThread.join();
+            teardown();
+        }
+
+        void setup()
+        {
+            if (mOpt.mMultishotRecv &&
+                (mOpt.mNumBuffers == 0 || mOpt.mNumBuffers > (1 << 15) ||
+                    mOpt.mBufferSize == 0 || mOpt.mBufferSize > (1ull << 31)))
+                throw std::runtime_error("IoUringSocket::Options: requires 0 < mNumBuffers <= 2^15 and 0 < mBufferSize <= 2^31. " LOCATION);
+
+            // the multishot receive posts a completion per buffer, so the
+            // completion queue must hold all of them.
+            io_uring_params p;
+            memset(&p, 0, sizeof(p));
+            p.flags = IORING_SETUP_CQSIZE;
+            p.cq_entries = u32(std::max<u64>(2 * mOpt.mEntries, 2 * mOpt.mNumBuffers));
+            mRingFd = uringSetup(u32(mOpt.mEntries), &p);
+            if (mRingFd < 0)
+                throw sysError("io_uring_setup", errno, LOCATION);
+
+            mSqSize = p.sq_off.array + p.sq_entries * sizeof(u32);
+            mCqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+            if (single)
+                mSqSize = mCqSize = std::max(mSqSize, mCqSize);
+
+            mSqPtr = mmap(nullptr, mSqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQ_RING);
+            if (mSqPtr == MAP_FAILED)
+                throw sysError("mmap", errno, LOCATION);
+            if (single)
+                mCqPtr = mSqPtr;
+            else
+            {
+                mCqPtr = mmap(nullptr, mCqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_CQ_RING);
+                if (mCqPtr == MAP_FAILED)
+                    throw sysError("mmap", errno, LOCATION);
+            }
+            mSqes = (io_uring_sqe*)mmap(nullptr, p.sq_entries * sizeof(io_uring_sqe),
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQES);
+            if (mSqes == MAP_FAILED)
+                throw sysError("mmap", errno, LOCATION);
+
+            auto sq = (u8*)mSqPtr;
+            mSqHead = (u32*)(sq + p.sq_off.head);
+            mSqTailPtr = (u32*)(sq + p.sq_off.tail);
+            mSqMask = *(u32*)(sq + p.sq_off.ring_mask);
+            mSqEntries = p.sq_entries;
+            mSqArray = (u32*)(sq + p.sq_off.array);
+            mSqTail = *mSqTailPtr;
+
+            auto cq = (u8*)mCqPtr;
+            mCqHead = (u32*)(cq + p.cq_off.head);
+            mCqTail = (u32*)(cq + p.cq_off.tail);
+            mCqMask = *(u32*)(cq + p.cq_off.ring_mask);
+            mCqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+            mSend.mSend = true;
+
+            if (mOpt.mMultishotRecv)
+            {
+                mBufData.resize(mOpt.mNumBuffers * mOpt.mBufferSize);
+                for (u64 i = 0; i < mOpt.mNumBuffers; ++i)
+                    mFreed.push_back(u16(i));
+                provide();
+                submit();
+            }
+        }
+
+        void teardown()
+        {
+            if (mRingFd >= 0)
+                ::close(mRingFd);
+            if (mSqes != MAP_FAILED)
+                munmap(mSqes, mSqEntries * sizeof(io_uring_sqe));
+            if (mCqPtr != MAP_FAILED && mCqPtr != mSqPtr)
+                munmap(mCqPtr, mCqSize);
+            if (mSqPtr != MAP_FAILED)
+                munmap(mSqPtr, mSqSize);
+            if (mFd >= 0)
+                ::close(mFd);
+            mRingFd = mFd = -1;
+        }
+
+        // returns a cleared submission entry, where the entries are
+        // submitted by submit(). mMtx must be held.
+        io_uring_sqe* getSqe()
+        {
+            if (mSqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) >= mSqEntries)
+                submit();
+            if (mSqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) >= mSqEntries)
+                throw std::runtime_error("io_uring submission queue is full. " LOCATION);
+
+            auto idx = mSqTail & mSqMask;
+            auto sqe = &mSqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            mSqArray[idx] = idx;
+            ++mSqTail;
+            return sqe;
+        }
+
+        // submits the entries from getSqe(). mMtx must be held.
+        void submit()
+        {
+            __atomic_store_n(mSqTailPtr, mSqTail, __ATOMIC_RELEASE);
+            while (mSqSubmitted != mSqTail)
+            {
+                auto n = uringEnter(mRingFd, mSqTail - mSqSubmitted, 0, 0);
+                if (n < 0 && errno != EINTR)
+                    throw sysError("io_uring_enter", errno, LOCATION);
+                if (n > 0)
+                    mSqSubmitted += n;
+            }
+        }
+
+        // submits the remainder of op as a sendmsg or recvmsg.
+        void submit(IoUringOp& op)
+        {
+            memset(&op.mMsg, 0, sizeof(op.mMsg));
+            op.mMsg.msg_iov = op.mIov.data() + op.mIdx;
+            op.mMsg.msg_iovlen = std::min<u64>(IOV_MAX, op.mIov.size() - op.mIdx);
+
+            auto sqe = getSqe();
+            sqe->opcode = op.mSend ? IORING_OP_SENDMSG : IORING_OP_RECVMSG;
+            sqe->fd = mFd;
+            sqe->addr = (u64)&op.mMsg;
+            sqe->len = 1;
+            sqe->msg_flags = (op.mSend ? MSG_NOSIGNAL : 0) | (op.mWaitAll ? MSG_WAITALL : 0);
+            sqe->user_data = (u64)&op;
+            op.mInFlight = true;
+            submit();
+        }
+
+        void submitCancel(u64 userData)
+        {
+            auto sqe = getSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = userData;
+            sqe->user_data = ignoreTag;
+            submit();
+        }
+
+        // arms the multishot receive if it is not and a buffer is provided.
+        void arm()
+        {
+            if (mArmed || mRecvEc || mNumProvided == 0)
+                return;
+
+            auto sqe = getSqe();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = mFd;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = 0;
+            sqe->user_data = multishotTag;
+            mArmed = true;
+            submit();
+        }
+
+        // gives the buffers in mFreed back to the kernel with one
+        // IORING_OP_PROVIDE_BUFFERS per run of consecutive ids.
+        void provide()
+        {
+            for (u64 i = 0, j; i < mFreed.size(); i = j)
+            {
+                for (j = i + 1; j < mFreed.size() && mFreed[j] == mFreed[j - 1] + 1; ++j);
+
+                auto sqe = getSqe();
+                sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+                sqe->fd = i32(j - i);
+                sqe->addr = (u64)(mBufData.data() + mFreed[i] * mOpt.mBufferSize);
+                sqe->len = u32(mOpt.mBufferSize);
+                sqe->off = mFreed[i];
+                sqe->buf_group = 0;
+                sqe->user_data = ignoreTag;
+            }
+            mNumProvided += mFreed.size();
+            mFreed.clear();
+        }
+
+        // copies the received buffers into mRecv and completes it if possible.
+        void serve(std::vector<Completion>& out)
+        {
+            if (!mRecv.mPending)
+                return;
+
+            while (mReady.size() && mRecv.mIdx < mRecv.mIov.size())
+            {
+                auto& c = mReady.front();
+                auto& v = mRecv.mIov[mRecv.mIdx];
+                auto n = std::min<u64>(v.iov_len, c.mSize - mReadyBegin);
+                memcpy(v.iov_base, mBufData.data() + c.mBid * mOpt.mBufferSize + mReadyBegin, n);
+                mRecv.advance(n);
+                mReadyBegin += n;
+                if (mReadyBegin == c.mSize)
+                {
+                    mFreed.push_back(c.mBid);
+                    mReady.pop_front();
+                    mReadyBegin = 0;
+                }
+            }
+
+            if (mRecv.done())
+                mRecv.finish({}, out);
+            else if (mRecvEc)
+                mRecv.finish(mRecvEc, out);
+
+            if (mFreed.size() && !mRingEc)
+            {
+                provide();
+                arm();
+                submit();
+            }
+        }
+
+        // processes the completion of a send or direct receive.
+        void complete(IoUringOp& op, i32 res, std::vector<Completion>& out)
+        {
+            op.mInFlight = false;
+            if (res < 0)
+                op.finish(toErrorCode(res), out);
+            else if (res == 0 && !op.done())
+                op.finish(boost::asio::error::eof, out);
+            else
+            {
+                op.advance(res);
+                if (op.done())
+                    op.finish({}, out);
+                else
+                    submit(op);
+            }
+        }
+
+        void completeMultishot(i32 res, u32 flags, std::vector<Completion>& out)
+        {
+            if (flags & IORING_CQE_F_BUFFER)
+                --mNumProvided;
+
+            if (res > 0)
+                mReady.push_back({ u16(flags >> IORING_CQE_BUFFER_SHIFT), u32(res) });
+            else if (res == 0)
+                mRecvEc = boost::asio::error::eof;
+            else if (res != -ENOBUFS)
+                mRecvEc = toErrorCode(res);
+
+            // without F_MORE the receive is no longer armed. After ENOBUFS it
+            // is re-armed once a buffer is provided again.
+            if ((flags & IORING_CQE_F_MORE) == 0)
+                mArmed = false;
+
+            serve(out);
+            if (mArmed == false && mRecvEc == error_code{})
+            {
+                arm();
+                submit();
+            }
+        }
+
+        // fails the pending operations with ec and shuts the socket down so
+        // that the kernel completes those in flight. The ring is not used
+        // again.
+        void fail(error_code ec, std::vector<Completion>& out)
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            mRingEc = ec;
+            mRecvEc = ec;
+            mClosed = true;
+            mStopped = true;
+            ::shutdown(mFd, SHUT_RDWR);
+            if (mSend.mPending)
+                mSend.finish(ec, out);
+            if (mRecv.mPending)
+                mRecv.finish(ec, out);
+        }
+
+        void run()
+        {
+            std::vector<Completion> out;
+            bool stop = false;
+            while (!stop)
+            {
+                if (uringEnter(mRingFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                {
+                    fail(error_code(errno, boost::system::system_category()), out);
+                    dispatch(out);
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mMtx);
+                    auto head = *mCqHead;
+                    auto tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+                    for (; head != tail; ++head)
+                    {
+                        auto cqe = mCqes[head & mCqMask];
+                        __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+
+                        if (cqe.user_data == stopTag)
+                            stop = mStopped = true;
+                        else if (cqe.user_data == multishotTag)
+                            completeMultishot(cqe.res, cqe.flags, out);
+                        else if (cqe.user_data != ignoreTag)
+                            complete(*(IoUringOp*)cqe.user_data, cqe.res, out);
+                    }
+                }
+
+                dispatch(out);
+            }
+        }
+
+        // completes out on the IOService, or here if it was not set. All
+        // of the handlers go through here so that they run on the threads
+        // of the IOService, whether they complete on the ring thread or in
+        // start().
+        void dispatch(std::vector<Completion>& out)
+        {
+            for (auto& c : out)
+            {
+                if (mIos)
+                    post(mIos, [c = std::move(c)]() { c.mFn(c.mEc, c.mBytes); });
+                else
+                    c.mFn(c.mEc, c.mBytes);
+            }
+            out.clear();
+        }
+
+        // starts op on buffers. The ring thread reads mRecv while serving
+        // the multishot receive, so it is set under the lock.
+        void start(IoUringOp& op, span<boost::asio::mutable_buffer> buffers, u64 minSize, io_completion_handle&& fn, bool waitAll)
+        {
+            std::vector<Completion> out;
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                op.set(buffers, minSize, std::move(fn));
+                op.mWaitAll = waitAll;
+                if (op.mSend == false && mOpt.mMultishotRecv)
+                    serve(out);
+                else if (op.done())
+                    op.finish({}, out);
+                else if (mClosed)
+                    op.finish(mRingEc ? mRingEc : error_code(boost::asio::error::bad_descriptor), out);
+                else
+                    submit(op);
+            }
+            dispatch(out);
+        }
+    };
+
+    namespace
+    {
+        // receives a byte with a multishot receive on a socket pair.
+        bool probeMultishotRecv()
+        {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+                return false;
+
+            std::promise<error_code> prom;
+            auto fu = prom.get_future();
+            bool ok = false;
+            try
+            {
+                IoUringSocketOptions opt;
+                opt.mMultishotRecv = true;
+                opt.mNumBuffers = 1;
+                opt.mBufferSize = 64;
+                IoUringSocket::State st(fds[0], opt);
+                {
+                    std::lock_guard<std::mutex> lock(st.mMtx);
+                    st.arm();
+                }
+
+                u8 b = 1;
+                boost::asio::mutable_buffer buff(&b, 1);
+                st.start(st.mRecv, { &buff, 1 }, ~0ull, [&prom](const error_code& ec, u64) {
+                    prom.set_value(ec);
+                }, true);
+
+                ok = ::send(fds[1], &b, 1, MSG_NOSIGNAL) == 1 &&
+                    fu.wait_for(std::chrono::seconds(1)) == std::future_status::ready &&
+                    !fu.get();
+
+                // the receive is done or is canceled when the ring is closed.
+                ::shutdown(fds[0], SHUT_RDWR);
+            }
+            catch (...) {}
+            ::close(fds[1]);
+            return ok;
+        }
+
+        // falls back to direct receives if the kernel does not support the
+        // multishot receive.
+        IoUringSocketOptions checkOptions(IoUringSocketOptions opt)
+        {
+            if (opt.mMultishotRecv && IoUringSocket::isMultishotRecvSupported() == false)
+                opt.mMultishotRecv = false;
+            return opt;
+        }
+    }
+
+    IoUringSocket::IoUringSocket(int fd, Options opt)
+        : mState(new State(fd, checkOptions(opt)))
+    {
+        if (mState->mOpt.mMultishotRecv)
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->arm();
+        }
+    }
+
+    IoUringSocket::IoUringSocket(boost::asio::ip::tcp::socket&& sock, Options opt)
+        : IoUringSocket(sock.release(), opt)
+    {}
+
+    IoUringSocket::~IoUringSocket()
+    {
+        close();
+        mState.reset();
+    }
+
+    void IoUringSocket::async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        mState->start(mState->mSend, buffers, ~0ull, std::move(fn), true);
+    }
+
+    void IoUringSocket::async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        mState->start(mState->mRecv, buffers, ~0ull, std::move(fn), true);
+    }
+
+    void IoUringSocket::async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn)
+    {
+        mState->start(mState->mRecv, { &buffer, 1 }, minSize, std::move(fn), false);
+    }
+
+    void IoUringSocket::close()
+    {
+        std::lock_guard<std::mutex> lock(mState->mMtx);
+        if (mState->mClosed == false)
+        {
+            mState->mClosed = true;
+            ::shutdown(mState->mFd, SHUT_RDWR);
+        }
+    }
+
+    void IoUringSocket::cancel()
+    {
+        std::lock_guard<std::mutex> lock(mState->mMtx);
+        auto& s = *mState;
+        if (s.mStopped)
+            return;
+        if (s.mSend.mInFlight)
+            s.submitCancel((u64)&s.mSend);
+        if (s.mRecv.mInFlight)
+            s.submitCancel((u64)&s.mRecv);
+        if (s.mArmed)
+            s.submitCancel(multishotTag);
+    }
+
+    void IoUringSocket::setIOService(IOService& ios)
+    {
+        mState->mIos = &ios;
+    }
+
+    bool IoUringSocket::isSupported()
+    {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        auto fd = uringSetup(1, &p);
+        if (fd < 0)
+            return false;
+        ::close(fd);
+        return true;
+    }
+
+    bool IoUringSocket::isMultishotRecvSupported()
+    {
+        static const bool supported = isSupported() && probeMultishotRecv();
+        return supported;
+    }
+}
+#endif
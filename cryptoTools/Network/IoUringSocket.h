@@ -0,0 +1,79 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#if defined(ENABLE_BOOST) && defined(ENABLE_IO_URING)
+
+#include "cryptoTools/Network/SocketAdapter.h"
+#include <memory>
+
+namespace osuCrypto
+{
+
+    // The options of an IoUringSocket.
+    struct IoUringSocketOptions
+    {
+        // the number of submission queue entries.
+        u64 mEntries = 64;
+
+        // receive with a multishot recv into provided buffers, which
+        // requires Linux 6.0. Otherwise, or if the kernel does not support
+        // it, each receive is a recvmsg.
+        bool mMultishotRecv = false;
+
+        // the size and number of the provided buffers of the multishot
+        // receive.
+        u64 mBufferSize = 1 << 16;
+        u64 mNumBuffers = 64;
+    };
+
+    // A SocketInterface that performs the IO of a connected stream socket
+    // with io_uring instead of asio's reactor. Each socket owns a ring and
+    // a thread that reaps its completions and posts the handlers to the
+    // IOService of the Channel. If the ring fails, the operations complete
+    // with the error and the socket is shut down. Use it as
+    //
+    //   Channel chl(ios, new IoUringSocket(std::move(sock)));
+    //
+    // Sends are submitted as a single sendmsg over all of the buffers of the
+    // operation, which with the send gathering of the Channel is all of the
+    // queued messages. Receives are either a recvmsg into the caller's
+    // buffers or, if mMultishotRecv is set, served from a multishot receive
+    // into a group of provided buffers that stays armed across messages.
+    class IoUringSocket : public SocketInterface
+    {
+    public:
+        using Options = IoUringSocketOptions;
+
+        // takes ownership of the connected socket fd.
+        IoUringSocket(int fd, Options opt = {});
+
+        // takes ownership of the native handle of sock.
+        IoUringSocket(boost::asio::ip::tcp::socket&& sock, Options opt = {});
+
+        ~IoUringSocket() override;
+
+        void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn) override;
+
+        void close() override;
+
+        void cancel() override;
+
+        void setIOService(IOService& ios) override;
+
+        // returns true if the kernel supports io_uring.
+        static bool isSupported();
+
+        // returns true if the kernel supports the multishot receive, which
+        // is probed once with a receive on a socket pair.
+        static bool isMultishotRecvSupported();
+
+        struct State;
+        std::unique_ptr<State> mState;
+    };
+
+}
+#endif
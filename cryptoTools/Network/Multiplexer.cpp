@@ -0,0 +1,687 @@
+#include "Multiplexer.h"
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/IOService.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        enum class FrameType : u8
+        {
+            // the payload is "localName`remoteName" of the sender's stream.
+            Open,
+            Data,
+            // the payload is the u64 number of bytes that were consumed.
+            Credit,
+            // the sender has closed its stream.
+            Close,
+            // the sender has no more streams on this carrier.
+            Shutdown
+        };
+
+        // Open, Data and Close frames have the sender's stream id while
+        // Credit frames have the receiver's.
+        struct FrameHeader
+        {
+            FrameType mType;
+            u8 mPad[3];
+            u32 mId;
+        };
+        static_assert(sizeof(FrameHeader) == 8, "");
+
+        std::vector<u8> makeFrame(FrameType type, u32 id, u64 payloadSize)
+        {
+            std::vector<u8> f(sizeof(FrameHeader) + payloadSize);
+            FrameHeader h{ type, {}, id };
+            memcpy(f.data(), &h, sizeof(h));
+            return f;
+        }
+
+        struct Completion
+        {
+            io_completion_handle mFn;
+            error_code mEc;
+            u64 mBytes;
+        };
+
+        // a send or receive of a stream, which is complete once mMinSize
+        // bytes have been transferred.
+        struct MuxOp
+        {
+            std::vector<boost::asio::mutable_buffer> mBuffers;
+            u64 mIdx = 0, mOffset = 0, mBytes = 0, mMinSize = 0;
+            io_completion_handle mFn;
+            bool mPending = false;
+
+            void set(span<boost::asio::mutable_buffer> buffers, u64 minSize, io_completion_handle&& fn)
+            {
+                if (mPending)
+                    throw std::runtime_error("a multiplexed stream supports one outstanding operation per direction. " LOCATION);
+
+                mBuffers.clear();
+                u64 total = 0;
+                for (auto& b : buffers)
+                {
+                    if (b.size())
+                        mBuffers.push_back(b);
+                    total += b.size();
+                }
+                mIdx = mOffset = mBytes = 0;
+                mMinSize = std::min(minSize, total);
+                mFn = std::move(fn);
+                mPending = true;
+            }
+
+            // copies up to n bytes between the buffers and data. Returns
+            // the number of bytes copied.
+            u64 copy(u8* data, u64 n, bool toBuffers)
+            {
+                u64 done = 0;
+                while (done < n && !full())
+                {
+                    auto& b = mBuffers[mIdx];
+                    auto m = std::min<u64>(n - done, b.size() - mOffset);
+                    auto p = (u8*)b.data() + mOffset;
+                    if (toBuffers)
+                        memcpy(p, data + done, m);
+                    else
+                        memcpy(data + done, p, m);
+                    done += m;
+                    mBytes += m;
+                    mOffset += m;
+                    if (mOffset == b.size())
+                    {
+                        ++mIdx;
+                        mOffset = 0;
+                    }
+                }
+                return done;
+            }
+
+            u64 remaining() const
+            {
+                u64 r = 0;
+                for (u64 i = mIdx; i < mBuffers.size(); ++i)
+                    r += mBuffers[i].size();
+                return r - mOffset;
+            }
+
+            bool full() const { return mIdx == mBuffers.size(); }
+            bool done() const { return mBytes >= mMinSize; }
+
+            void finish(error_code ec, std::vector<Completion>& out)
+            {
+                mPending = false;
+                out.push_back({ std::move(mFn), ec, mBytes });
+            }
+        };
+
+        // the payload of a received data frame.
+        struct Chunk
+        {
+            std::vector<u8> mData;
+            u64 mOffset;
+        };
+    }
+
+    struct Multiplexer::State : std::enable_shared_from_this<Multiplexer::State>
+    {
+        struct Stream
+        {
+            // our id, which is zero until we have opened the stream, and
+            // the peer's id, which is zero until the peer has.
+            u32 mId = 0, mRemoteId = 0;
+            u64 mCarrier = 0;
+            std::string mKey;
+
+            MuxOp mSend, mRecv;
+
+            // the number of bytes that we may still send.
+            u64 mCredit = 0;
+
+            // the received data and the number of bytes of it that have
+            // been consumed but not yet credited to the peer.
+            std::deque<Chunk> mChunks;
+            u64 mUnacked = 0;
+
+            // whether the stream is in the ready list of its carrier.
+            bool mReady = false;
+            bool mClosed = false, mPeerClosed = false;
+        };
+
+        struct Carrier
+        {
+            Channel mChl;
+
+            // the frames other than data, which are sent first.
+            std::deque<std::vector<u8>> mControl;
+
+            // the streams that have something to send, round robin.
+            std::deque<std::shared_ptr<Stream>> mReady;
+            u64 mInFlight = 0;
+
+            // only one thread at a time hands frames to mChl to keep them
+            // in order.
+            bool mPumping = false, mRepump = false;
+
+            std::vector<u8> mFrame;
+            bool mShutdownSent = false, mPeerShutdown = false, mClosing = false;
+        };
+
+        Options mOpt;
+        IOService& mIos;
+        std::vector<Carrier> mCarriers;
+
+        std::mutex mMtx;
+        u32 mNextId = 1;
+        bool mShutdown = false;
+        error_code mError;
+
+        // our streams by our id and by the peer's id.
+        std::unordered_map<u32, std::shared_ptr<Stream>> mLocal, mRemote;
+
+        // the streams that we have opened and the peer has not, and the
+        // reverse, by the key "localName`remoteName".
+        std::unordered_map<std::string, std::shared_ptr<Stream>> mAwaiting, mUnclaimed;
+
+        State(IOService& ios, std::vector<Channel>&& carriers, Options opt)
+            : mOpt(opt)
+            , mIos(ios)
+            , mCarriers(carriers.size())
+        {
+            if (mCarriers.size() == 0)
+                throw std::runtime_error("a Multiplexer requires at least one carrier. " LOCATION);
+            if (mOpt.mWindowSize == 0 || mOpt.mFrameSize == 0 || mOpt.mMaxInFlight == 0)
+                throw std::runtime_error("invalid MultiplexOptions. " LOCATION);
+
+            for (u64 i = 0; i < mCarriers.size(); ++i)
+                mCarriers[i].mChl = std::move(carriers[i]);
+        }
+
+        void start()
+        {
+            for (u64 i = 0; i < mCarriers.size(); ++i)
+                arm(i);
+        }
+
+        void arm(u64 i)
+        {
+            auto& c = mCarriers[i];
+            c.mFrame.clear();
+            c.mChl.asyncRecv(c.mFrame, std::function<void(const error_code&)>(
+                [self = shared_from_this(), i](const error_code& ec) { self->onFrame(i, ec); }));
+        }
+
+        void post(std::vector<Completion>& out)
+        {
+            for (auto& c : out)
+                osuCrypto::post(&mIos, [c = std::move(c)]() { c.mFn(c.mEc, c.mBytes); });
+            out.clear();
+        }
+
+        bool sendable(const Stream& s) const
+        {
+            return s.mSend.mPending && !s.mSend.full() && s.mCredit && !s.mClosed && !mError;
+        }
+
+        void markReady(const std::shared_ptr<Stream>& s)
+        {
+            if (!s->mReady && sendable(*s))
+            {
+                s->mReady = true;
+                mCarriers[s->mCarrier].mReady.push_back(s);
+            }
+        }
+
+        void queueCredit(u64 carrier, u32 id, u64 n)
+        {
+            auto f = makeFrame(FrameType::Credit, id, sizeof(u64));
+            memcpy(f.data() + sizeof(FrameHeader), &n, sizeof(u64));
+            mCarriers[carrier].mControl.push_back(std::move(f));
+        }
+
+        // copies the received data into the pending receive of s and
+        // completes it if possible. mMtx must be held.
+        void serve(Stream& s, std::vector<Completion>& out)
+        {
+            auto& op = s.mRecv;
+            if (!op.mPending)
+                return;
+
+            while (!op.full() && s.mChunks.size())
+            {
+                auto& c = s.mChunks.front();
+                auto n = op.copy(c.mData.data() + c.mOffset, c.mData.size() - c.mOffset, true);
+                c.mOffset += n;
+                s.mUnacked += n;
+                if (c.mOffset == c.mData.size())
+                    s.mChunks.pop_front();
+            }
+
+            if (op.done())
+                op.finish({}, out);
+            else if (mError)
+                op.finish(mError, out);
+            else if (s.mPeerClosed && s.mChunks.empty())
+                op.finish(boost::asio::error::eof, out);
+
+            if (s.mUnacked >= mOpt.mWindowSize / 2 && s.mRemoteId)
+            {
+                queueCredit(s.mCarrier, s.mRemoteId, s.mUnacked);
+                s.mUnacked = 0;
+            }
+        }
+
+        // fails all of the streams. mMtx must be held.
+        void fail(error_code ec, std::vector<Completion>& out)
+        {
+            if (mError)
+                return;
+            mError = ec;
+            for (auto m : { &mLocal, &mRemote })
+            {
+                for (auto& s : *m)
+                {
+                    if (s.second->mSend.mPending)
+                        s.second->mSend.finish(ec, out);
+                    serve(*s.second, out);
+                }
+            }
+        }
+
+        // hands the queued frames of carrier i to its Channel.
+        void pump(u64 i)
+        {
+            auto& c = mCarriers[i];
+            std::vector<std::vector<u8>> frames;
+            std::vector<Completion> out;
+
+            std::unique_lock<std::mutex> lock(mMtx);
+            if (c.mPumping)
+            {
+                c.mRepump = true;
+                return;
+            }
+            c.mPumping = true;
+
+            do
+            {
+                c.mRepump = false;
+                while (c.mControl.size())
+                {
+                    if (c.mControl.front().size() == sizeof(FrameHeader) &&
+                        ((FrameHeader*)c.mControl.front().data())->mType == FrameType::Shutdown)
+                        c.mShutdownSent = true;
+                    frames.push_back(std::move(c.mControl.front()));
+                    c.mControl.pop_front();
+                }
+
+                while (c.mInFlight + frames.size() < mOpt.mMaxInFlight && c.mReady.size())
+                {
+                    auto s = std::move(c.mReady.front());
+                    c.mReady.pop_front();
+                    s->mReady = false;
+                    if (!sendable(*s))
+                        continue;
+
+                    auto n = std::min<u64>({ mOpt.mFrameSize, s->mCredit, s->mSend.remaining() });
+                    auto f = makeFrame(FrameType::Data, s->mId, n);
+                    s->mSend.copy(f.data() + sizeof(FrameHeader), n, false);
+                    s->mCredit -= n;
+                    frames.push_back(std::move(f));
+
+                    if (s->mSend.full())
+                        s->mSend.finish({}, out);
+                    markReady(s);
+                }
+
+                c.mInFlight += frames.size();
+                lock.unlock();
+
+                for (auto& f : frames)
+                    c.mChl.asyncSend(std::move(f), std::function<void(const error_code&)>(
+                        [self = shared_from_this(), i](const error_code& ec) { self->onSent(i, ec); }));
+                frames.clear();
+                post(out);
+
+                lock.lock();
+            } while (c.mRepump);
+
+            c.mPumping = false;
+            auto close = mShutdown && c.mShutdownSent && c.mPeerShutdown && !c.mClosing;
+            c.mClosing |= close;
+            lock.unlock();
+
+            // the peer has stopped receiving on this carrier and all of our
+            // frames have been handed to it.
+            if (close)
+                c.mChl.asyncClose([self = shared_from_this()]() {});
+        }
+
+        void pumpAll()
+        {
+            for (u64 i = 0; i < mCarriers.size(); ++i)
+                pump(i);
+        }
+
+        void onSent(u64 i, const error_code& ec)
+        {
+            std::vector<Completion> out;
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                --mCarriers[i].mInFlight;
+                if (ec)
+                    fail(ec, out);
+            }
+            post(out);
+            pump(i);
+        }
+
+        void onFrame(u64 i, const error_code& ec)
+        {
+            auto& c = mCarriers[i];
+            std::vector<Completion> out;
+            bool rearm;
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                if (ec || c.mFrame.size() < sizeof(FrameHeader))
+                {
+                    // the peer is gone, or will not send more on any carrier.
+                    c.mPeerShutdown = true;
+                    if (!mShutdown)
+                        fail(ec ? ec : make_error_code(boost::system::errc::protocol_error), out);
+                }
+                else
+                    handle(i, out);
+                rearm = !c.mPeerShutdown;
+            }
+            post(out);
+
+            if (rearm)
+                arm(i);
+            pumpAll();
+        }
+
+        // processes the frame that carrier i received. mMtx must be held.
+        void handle(u64 i, std::vector<Completion>& out)
+        {
+            auto& c = mCarriers[i];
+            FrameHeader h;
+            memcpy(&h, c.mFrame.data(), sizeof(h));
+            auto payload = c.mFrame.size() - sizeof(FrameHeader);
+
+            switch (h.mType)
+            {
+            case FrameType::Open:
+            {
+                std::string names((char*)c.mFrame.data() + sizeof(FrameHeader), payload);
+                auto pos = names.find('`');
+                if (pos == std::string::npos)
+                    break;
+                auto key = names.substr(pos + 1) + '`' + names.substr(0, pos);
+
+                std::shared_ptr<Stream> s;
+                auto iter = mAwaiting.find(key);
+                if (iter != mAwaiting.end())
+                {
+                    s = std::move(iter->second);
+                    mAwaiting.erase(iter);
+                }
+                else
+                {
+                    s = std::make_shared<Stream>();
+                    s->mKey = key;
+                    s->mCredit = mOpt.mWindowSize;
+                    mUnclaimed[key] = s;
+                }
+                s->mRemoteId = h.mId;
+                mRemote[h.mId] = s;
+                break;
+            }
+            case FrameType::Data:
+            {
+                auto iter = mRemote.find(h.mId);
+                if (iter == mRemote.end() || iter->second->mClosed)
+                {
+                    // nobody will read it. Let the sender continue.
+                    queueCredit(i, h.mId, payload);
+                }
+                else
+                {
+                    auto& s = *iter->second;
+                    s.mChunks.push_back({ std::move(c.mFrame), sizeof(FrameHeader) });
+                    serve(s, out);
+                }
+                break;
+            }
+            case FrameType::Credit:
+            {
+                u64 n;
+                if (payload != sizeof(n))
+                    break;
+                memcpy(&n, c.mFrame.data() + sizeof(FrameHeader), sizeof(n));
+                auto iter = mLocal.find(h.mId);
+                if (iter != mLocal.end())
+                {
+                    iter->second->mCredit += n;
+                    markReady(iter->second);
+                }
+                break;
+            }
+            case FrameType::Close:
+            {
+                auto iter = mRemote.find(h.mId);
+                if (iter != mRemote.end())
+                {
+                    iter->second->mPeerClosed = true;
+                    serve(*iter->second, out);
+                }
+                break;
+            }
+            case FrameType::Shutdown:
+                c.mPeerShutdown = true;
+                break;
+            default:
+                break;
+            }
+        }
+
+        std::shared_ptr<Stream> open(std::string localName, std::string remoteName)
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            if (mShutdown)
+                throw std::runtime_error("the Multiplexer has been destroyed. " LOCATION);
+
+            auto key = localName + '`' + remoteName;
+            std::shared_ptr<Stream> s;
+            auto iter = mUnclaimed.find(key);
+            if (iter != mUnclaimed.end())
+            {
+                s = std::move(iter->second);
+                mUnclaimed.erase(iter);
+            }
+            else
+            {
+                if (mAwaiting.count(key))
+                    throw std::runtime_error("the stream " + key + " is already open. " LOCATION);
+
+                s = std::make_shared<Stream>();
+                s->mKey = key;
+                s->mCredit = mOpt.mWindowSize;
+                mAwaiting[key] = s;
+            }
+
+            s->mId = mNextId++;
+            s->mCarrier = s->mId % mCarriers.size();
+            mLocal[s->mId] = s;
+
+            auto f = makeFrame(FrameType::Open, s->mId, key.size());
+            memcpy(f.data() + sizeof(FrameHeader), key.data(), key.size());
+            mCarriers[s->mCarrier].mControl.push_back(std::move(f));
+            return s;
+        }
+
+        // mMtx must be held.
+        void close(Stream& s, std::vector<Completion>& out)
+        {
+            if (s.mClosed)
+                return;
+            s.mClosed = true;
+
+            if (s.mSend.mPending)
+                s.mSend.finish(boost::asio::error::operation_aborted, out);
+            if (s.mRecv.mPending)
+                s.mRecv.finish(boost::asio::error::operation_aborted, out);
+
+            // return the credit of the data that will not be read.
+            for (auto& c : s.mChunks)
+                s.mUnacked += c.mData.size() - c.mOffset;
+            s.mChunks.clear();
+            if (s.mUnacked && s.mRemoteId)
+                queueCredit(s.mCarrier, s.mRemoteId, s.mUnacked);
+            s.mUnacked = 0;
+
+            mCarriers[s.mCarrier].mControl.push_back(makeFrame(FrameType::Close, s.mId, 0));
+        }
+
+        void shutdown()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                mShutdown = true;
+                for (auto& c : mCarriers)
+                    c.mControl.push_back(makeFrame(FrameType::Shutdown, 0, 0));
+            }
+            pumpAll();
+        }
+    };
+
+    namespace
+    {
+        class MuxStreamSocket : public SocketInterface
+        {
+        public:
+            using Stream = Multiplexer::State::Stream;
+
+            std::shared_ptr<Multiplexer> mMux;
+            Multiplexer::State& mState;
+            std::shared_ptr<Stream> mStream;
+
+            MuxStreamSocket(std::shared_ptr<Multiplexer> mux, std::shared_ptr<Stream> s)
+                : mMux(std::move(mux))
+                , mState(*mMux->mState)
+                , mStream(std::move(s))
+            {}
+
+            ~MuxStreamSocket() override
+            {
+                close();
+
+                std::lock_guard<std::mutex> lock(mState.mMtx);
+                mState.mLocal.erase(mStream->mId);
+                if (mStream->mRemoteId)
+                    mState.mRemote.erase(mStream->mRemoteId);
+                else
+                    mState.mAwaiting.erase(mStream->mKey);
+            }
+
+            void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override
+            {
+                std::vector<Completion> out;
+                {
+                    std::lock_guard<std::mutex> lock(mState.mMtx);
+                    auto& s = *mStream;
+                    s.mSend.set(buffers, ~0ull, std::move(fn));
+                    if (mState.mError)
+                        s.mSend.finish(mState.mError, out);
+                    else if (s.mClosed || s.mPeerClosed)
+                        s.mSend.finish(boost::asio::error::broken_pipe, out);
+                    else if (s.mSend.full())
+                        s.mSend.finish({}, out);
+                    else
+                        mState.markReady(mStream);
+                }
+                mState.post(out);
+                mState.pump(mStream->mCarrier);
+            }
+
+            void async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override
+            {
+                recv(buffers, ~0ull, std::move(fn));
+            }
+
+            void async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn) override
+            {
+                recv({ &buffer, 1 }, minSize, std::move(fn));
+            }
+
+            void recv(span<boost::asio::mutable_buffer> buffers, u64 minSize, io_completion_handle&& fn)
+            {
+                std::vector<Completion> out;
+                {
+                    std::lock_guard<std::mutex> lock(mState.mMtx);
+                    auto& s = *mStream;
+                    s.mRecv.set(buffers, minSize, std::move(fn));
+                    if (s.mClosed)
+                        s.mRecv.finish(boost::asio::error::operation_aborted, out);
+                    else
+                        mState.serve(s, out);
+                }
+                mState.post(out);
+                mState.pump(mStream->mCarrier);
+            }
+
+            // the peer receives eof once it has read all of the data.
+            void close() override
+            {
+                std::vector<Completion> out;
+                {
+                    std::lock_guard<std::mutex> lock(mState.mMtx);
+                    mState.close(*mStream, out);
+                }
+                mState.post(out);
+                mState.pump(mStream->mCarrier);
+            }
+
+            void cancel() override
+            {
+                std::vector<Completion> out;
+                {
+                    std::lock_guard<std::mutex> lock(mState.mMtx);
+                    auto& s = *mStream;
+                    if (s.mSend.mPending)
+                        s.mSend.finish(boost::asio::error::operation_aborted, out);
+                    if (s.mRecv.mPending)
+                        s.mRecv.finish(boost::asio::error::operation_aborted, out);
+                }
+                mState.post(out);
+            }
+        };
+    }
+
+    Multiplexer::Multiplexer(IOService& ios, std::vector<Channel> carriers, Options opt)
+        : mState(std::make_shared<State>(ios, std::move(carriers), opt))
+    {
+        mState->start();
+    }
+
+    Multiplexer::~Multiplexer()
+    {
+        mState->shutdown();
+    }
+
+    SocketInterface* Multiplexer::addStream(std::string localName, std::string remoteName)
+    {
+        auto s = mState->open(std::move(localName), std::move(remoteName));
+        auto sock = new MuxStreamSocket(shared_from_this(), s);
+        mState->pump(s->mCarrier);
+        return sock;
+    }
+}
+#endif
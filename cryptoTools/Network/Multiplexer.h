@@ -0,0 +1,68 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/Channel.h"
+#include "cryptoTools/Network/SocketAdapter.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace osuCrypto
+{
+
+    // The options of a Multiplexer.
+    struct MultiplexOptions
+    {
+        // the number of sockets that the streams are spread over.
+        u64 mNumSockets = 1;
+
+        // the number of bytes that the sender of a stream may have in flight
+        // before the receiver has consumed them.
+        u64 mWindowSize = 1 << 20;
+
+        // the maximum payload of a frame. A stream that has more to send
+        // waits for the other streams on the socket to send a frame.
+        u64 mFrameSize = 1 << 16;
+
+        // the number of data frames that may be queued on a socket at once.
+        u64 mMaxInFlight = 4;
+    };
+
+    // Carries many streams over a small set of Channels, the carriers.
+    // Each stream is a SocketInterface for a Channel with the usual API, e.g.
+    //
+    //   auto mux = std::make_shared<Multiplexer>(ios, carriers);
+    //   Channel chl(ios, mux->addStream("local", "remote"));
+    //
+    // The streams are matched by name with the streams of the peer, which
+    // must use a Multiplexer over the other end of the same carriers. Each
+    // stream is pinned to one carrier. The carrier sends the frames of its
+    // streams round robin and the receiver grants the sender of each stream
+    // a window of mWindowSize bytes, so a stream that is not read does not
+    // hold up the others. See Session::multiplex.
+    //
+    // The carriers are closed once the Multiplexer and all of its streams
+    // have been destroyed at both ends.
+    class Multiplexer : public std::enable_shared_from_this<Multiplexer>
+    {
+    public:
+        using Options = MultiplexOptions;
+
+        // carriers[i] must be connected to the peer's carriers[i].
+        Multiplexer(IOService& ios, std::vector<Channel> carriers, Options opt = {});
+
+        ~Multiplexer();
+
+        // returns the socket of the stream that is matched with the peer's
+        // stream that has the names swapped. The Multiplexer must be owned
+        // by a std::shared_ptr.
+        SocketInterface* addStream(std::string localName, std::string remoteName);
+
+        struct State;
+        std::shared_ptr<State> mState;
+    };
+
+}
+#endif
@@ -0,0 +1,283 @@
+#include "NetEmuSocket.h"
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/IOService.h"
+#include "cryptoTools/Crypto/PRNG.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace osuCrypto
+{
+
+    struct NetEmuSocket::State : std::enable_shared_from_this<NetEmuSocket::State>
+    {
+        using Clock = std::chrono::steady_clock;
+
+        State(SocketInterface* sock, const Options& opt)
+            : mSock(sock)
+            , mOpt(opt)
+            , mPrng(toBlock(opt.mSeed))
+        {}
+
+        std::unique_ptr<SocketInterface> mSock;
+        Options mOpt;
+        PRNG mPrng;
+        IOService* mIos = nullptr;
+
+        std::mutex mMtx;
+        std::unique_ptr<boost::asio::steady_timer> mSendTimer, mDeliverTimer;
+
+        // when the link has transmitted the previous sends and when the
+        // last of them arrives.
+        Clock::time_point mLinkFree, mLastArrival;
+
+        // the data on the link. The first mDelivering of them are being
+        // sent on the wrapped socket, or a timer is waiting for the first
+        // one if mDelivering is set but mBuffers is empty.
+        struct Packet
+        {
+            std::vector<u8> mData;
+            Clock::time_point mArrival;
+        };
+        std::deque<Packet> mLink;
+        std::vector<boost::asio::mutable_buffer> mBuffers;
+        bool mDelivering = false;
+
+        // an error of the wrapped socket, which the sends that follow return.
+        error_code mEC;
+        bool mClosing = false, mClosed = false;
+
+        bool mRecvSinceSend = true;
+        std::atomic<u64> mRounds{ 0 }, mPackets{ 0 }, mWireBytes{ 0 };
+
+        // what deliver() leaves to be done on the wrapped socket once the
+        // lock is released, since its handlers might run inline and lock it.
+        enum class Action { None, Send, Close };
+
+        // hands the packets that have arrived to the wrapped socket, or
+        // waits for the first one. Requires the lock and the returned
+        // action must be passed to perform() after it is released.
+        Action deliver()
+        {
+            if (mDelivering)
+                return Action::None;
+
+            if (mLink.empty())
+            {
+                if (mClosing && !mClosed)
+                {
+                    mClosed = true;
+                    return Action::Close;
+                }
+                return Action::None;
+            }
+
+            mDelivering = true;
+            auto now = Clock::now();
+            if (mLink.front().mArrival > now)
+            {
+                // the timer is aborted by cancel(), after which the wrapped
+                // socket is still closed if close() was called.
+                mDeliverTimer->expires_at(mLink.front().mArrival);
+                mDeliverTimer->async_wait([st = shared_from_this()](const error_code& ec) {
+                    Action a = Action::None;
+                    {
+                        std::lock_guard<std::mutex> lock(st->mMtx);
+                        st->mDelivering = false;
+                        if (!ec || st->mClosing)
+                            a = st->deliver();
+                    }
+                    st->perform(a);
+                });
+                return Action::None;
+            }
+
+            // mBuffers is not changed until the send completes.
+            mBuffers.clear();
+            for (u64 i = 0; i < mLink.size() && mLink[i].mArrival <= now; ++i)
+                mBuffers.emplace_back(mLink[i].mData.data(), mLink[i].mData.size());
+            return Action::Send;
+        }
+
+        void perform(Action a)
+        {
+            if (a == Action::Close)
+                mSock->close();
+            else if (a == Action::Send)
+            {
+                mSock->async_send(mBuffers, [st = shared_from_this()](const error_code& ec, u64) {
+                    Action a;
+                    {
+                        std::lock_guard<std::mutex> lock(st->mMtx);
+                        st->mLink.erase(st->mLink.begin(), st->mLink.begin() + st->mBuffers.size());
+                        st->mBuffers.clear();
+                        st->mDelivering = false;
+                        if (ec)
+                        {
+                            st->mEC = ec;
+                            st->mLink.clear();
+                        }
+                        a = st->deliver();
+                    }
+                    st->perform(a);
+                });
+            }
+        }
+    };
+
+    NetEmuSocket::NetEmuSocket(SocketInterface* sock, Options opt)
+        : mState(std::make_shared<State>(sock, opt))
+    {
+        if (sock == nullptr || opt.mPacketSize == 0)
+            throw std::runtime_error("NetEmuSocket requires a socket and a positive packet size. " LOCATION);
+    }
+
+    NetEmuSocket::~NetEmuSocket()
+    {
+        close();
+    }
+
+    void NetEmuSocket::setIOService(IOService& ios)
+    {
+        auto& st = *mState;
+        st.mIos = &ios;
+        st.mSendTimer.reset(new boost::asio::steady_timer(ios.mIoService));
+        st.mDeliverTimer.reset(new boost::asio::steady_timer(ios.mIoService));
+        st.mSock->setIOService(ios);
+    }
+
+    void NetEmuSocket::async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        using Clock = State::Clock;
+        auto& st = *mState;
+        std::unique_lock<std::mutex> lock(st.mMtx);
+        if (st.mIos == nullptr)
+            throw std::runtime_error("NetEmuSocket::setIOService must be called first. " LOCATION);
+
+        if (st.mEC || st.mClosing)
+        {
+            auto ec = st.mEC ? st.mEC : boost::asio::error::operation_aborted;
+            post(st.mIos, [fn = std::move(fn), ec]() { fn(ec, 0); });
+            return;
+        }
+
+        State::Packet p;
+        for (auto& b : buffers)
+        {
+            auto d = static_cast<u8*>(b.data());
+            p.mData.insert(p.mData.end(), d, d + b.size());
+        }
+        auto size = p.mData.size();
+
+        if (st.mRecvSinceSend)
+        {
+            ++st.mRounds;
+            st.mRecvSinceSend = false;
+        }
+
+        auto packets = (size + st.mOpt.mPacketSize - 1) / st.mOpt.mPacketSize;
+        auto wire = size + packets * st.mOpt.mPacketOverhead;
+        st.mPackets += packets;
+        st.mWireBytes += wire;
+
+        // the link transmits the sends one after the other.
+        auto now = Clock::now();
+        st.mLinkFree = std::max(now, st.mLinkFree);
+        if (st.mOpt.mBandwidth)
+            st.mLinkFree += std::chrono::nanoseconds(wire * 1000000000ull / st.mOpt.mBandwidth);
+
+        auto arrival = st.mLinkFree + st.mOpt.mLatency;
+        if (st.mOpt.mJitter.count())
+            arrival += std::chrono::microseconds(st.mPrng.get<u64>() % (st.mOpt.mJitter.count() + 1));
+        st.mLastArrival = std::max(arrival, st.mLastArrival);
+
+        p.mArrival = st.mLastArrival;
+        st.mLink.push_back(std::move(p));
+        auto a = st.deliver();
+
+        if (st.mLinkFree <= now)
+        {
+            post(st.mIos, [fn = std::move(fn), size]() { fn({}, size); });
+        }
+        else
+        {
+            st.mSendTimer->expires_at(st.mLinkFree);
+            st.mSendTimer->async_wait([fn = std::move(fn), size](const error_code& ec) {
+                fn(ec, ec ? 0 : size);
+            });
+        }
+
+        lock.unlock();
+        st.perform(a);
+    }
+
+    void NetEmuSocket::async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        mState->mSock->async_recv(buffers, [st = mState, fn = std::move(fn)](const error_code& ec, u64 bt) {
+            if (bt)
+            {
+                std::lock_guard<std::mutex> lock(st->mMtx);
+                st->mRecvSinceSend = true;
+            }
+            fn(ec, bt);
+        });
+    }
+
+    void NetEmuSocket::async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn)
+    {
+        mState->mSock->async_recv_some(buffer, minSize, [st = mState, fn = std::move(fn)](const error_code& ec, u64 bt) {
+            if (bt)
+            {
+                std::lock_guard<std::mutex> lock(st->mMtx);
+                st->mRecvSinceSend = true;
+            }
+            fn(ec, bt);
+        });
+    }
+
+    void NetEmuSocket::close()
+    {
+        auto& st = *mState;
+        State::Action a;
+        {
+            std::lock_guard<std::mutex> lock(st.mMtx);
+            st.mClosing = true;
+            a = st.deliver();
+        }
+        st.perform(a);
+    }
+
+    void NetEmuSocket::cancel()
+    {
+        auto& st = *mState;
+        std::lock_guard<std::mutex> lock(st.mMtx);
+        if (st.mSendTimer)
+        {
+            st.mSendTimer->cancel();
+            st.mDeliverTimer->cancel();
+        }
+        if (st.mBuffers.empty())
+            st.mLink.clear();
+        st.mSock->cancel();
+    }
+
+    u64 NetEmuSocket::rounds() const
+    {
+        return mState->mRounds;
+    }
+
+    u64 NetEmuSocket::packets() const
+    {
+        return mState->mPackets;
+    }
+
+    u64 NetEmuSocket::wireBytes() const
+    {
+        return mState->mWireBytes;
+    }
+
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/SocketAdapter.h"
+#include <chrono>
+#include <memory>
+
+namespace osuCrypto
+{
+
+    // The link that a NetEmuSocket emulates.
+    struct NetEmuOptions
+    {
+        // the one way delay of the link.
+        std::chrono::microseconds mLatency{ 0 };
+
+        // each send is delayed by a further uniformly random amount of at
+        // most mJitter. The data still arrives in order.
+        std::chrono::microseconds mJitter{ 0 };
+
+        // the bytes per second of the link, headers included. Zero is
+        // unlimited.
+        u64 mBandwidth = 0;
+
+        // the data is carried in packets of at most mPacketSize bytes that
+        // each have mPacketOverhead bytes of headers. The default is TCP
+        // with timestamps over IPv4 with an MTU of 1500.
+        u64 mPacketSize = 1448;
+        u64 mPacketOverhead = 52;
+
+        // the seed of the jitter.
+        u64 mSeed = 0;
+    };
+
+    // A SocketInterface that wraps another one and delays the data that it
+    // sends as if it went over the link that the options describe, e.g.
+    //
+    //   NetEmuOptions opt;
+    //   opt.mLatency = std::chrono::milliseconds(20);
+    //   opt.mBandwidth = 100'000'000 / 8;
+    //   Channel chl(ios, new NetEmuSocket(new BoostSocketInterface(std::move(sock)), opt));
+    //
+    // Each end emulates the direction that it sends in, so both ends should
+    // be wrapped. A send takes the time that the link needs to transmit it
+    // after the previous sends, after which it completes. The data is handed
+    // to the wrapped socket once it would have arrived, that is mLatency plus
+    // the jitter later. The wrapped socket should be much faster than the
+    // emulated link.
+    class NetEmuSocket : public SocketInterface
+    {
+    public:
+        using Options = NetEmuOptions;
+
+        // takes ownership of sock.
+        NetEmuSocket(SocketInterface* sock, Options opt);
+
+        ~NetEmuSocket() override;
+
+        void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn) override;
+
+        // the data that is still on the link is delivered before the wrapped
+        // socket is closed.
+        void close() override;
+
+        void cancel() override;
+
+        void setIOService(IOService& ios) override;
+
+        // the number of flights of data that this end has sent, i.e. the
+        // first send and each send that follows a receive. The rounds of a
+        // protocol are the sum over the parties.
+        u64 rounds() const;
+
+        // the number of packets and the bytes that this end has sent on the
+        // link, headers included.
+        u64 packets() const;
+        u64 wireBytes() const;
+
+        struct State;
+        std::shared_ptr<State> mState;
+    };
+
+}
+#endif
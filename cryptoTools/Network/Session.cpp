@@ -5,6 +5,7 @@
 #include <cryptoTools/Network/IOService.h>
 #include <cryptoTools/Network/Channel.h>
 #include <cryptoTools/Network/SocketAdapter.h>
+#include <cryptoTools/Network/StripedSocket.h>
 #include <cryptoTools/Network/IoBuffer.h>
 #include <cryptoTools/Common/Log.h>
 #include <cryptoTools/Common/Timer.h>
@@ -19,6 +20,8 @@ namespace osuCrypto {
 
 	//extern std::vector<std::string> split(const std::string &s, char delim);
 
+	// the prefix of an address that names a unix domain socket.
+	static const std::string unixPrefix = "unix:";
 
 
 	SessionBase::SessionBase(IOService& ios) 
@@ -34,6 +37,12 @@ namespace osuCrypto {
 
 	void Session::start(IOService& ioService, std::string address, SessionMode host, std::string name)
 	{
+		if (address.compare(0, unixPrefix.size(), unixPrefix) == 0)
+		{
+			start(ioService, address, 0, host, name);
+			return;
+		}
+
 		auto vec = split(address, ':');
 
 		auto ip = vec[0];
@@ -59,10 +68,26 @@ namespace osuCrypto {
             throw std::runtime_error("TLS context isServer does not match SessionMode");
 #endif
 
+        std::string unixPath;
+        if (ip.compare(0, unixPrefix.size(), unixPrefix) == 0)
+        {
+            unixPath = ip.substr(unixPrefix.size());
+            if (unixPath.empty())
+                throw std::runtime_error("the unix domain socket path is empty. " LOCATION);
+#ifndef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            throw std::runtime_error("unix domain sockets are not supported on this platform. " LOCATION);
+#endif
+#ifdef ENABLE_WOLFSSL
+            if (tls)
+                throw std::runtime_error("TLS is not supported over unix domain sockets. " LOCATION);
+#endif
+        }
+
 
         mBase.reset(new SessionBase(ioService));
         mBase->mIP = std::move(ip);
         mBase->mPort = static_cast<u32>(port);
+        mBase->mUnixPath = std::move(unixPath);
         mBase->mMode = (type);
         mBase->mIOService = &(ioService);
         mBase->mStopped = (false);
@@ -81,9 +106,18 @@ namespace osuCrypto {
 #ifdef ENABLE_WOLFSSL
 			mBase->mTLSSessionID = prng.get();
 #endif
-            boost::asio::ip::tcp::resolver resolver(ioService.mIoService);
-            auto results = resolver.resolve(mBase->mIP, boost::lexical_cast<std::string>(port));
-            mBase->mRemoteAddr = *results.begin();
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            if (mBase->mUnixPath.size())
+            {
+                mBase->mRemoteAddr = boost::asio::local::stream_protocol::endpoint(mBase->mUnixPath);
+            }
+            else
+#endif
+            {
+                boost::asio::ip::tcp::resolver resolver(ioService.mIoService);
+                auto results = resolver.resolve(mBase->mIP, boost::lexical_cast<std::string>(port));
+                mBase->mRemoteAddr = results.begin()->endpoint();
+            }
         }
     }
 
@@ -179,6 +213,21 @@ namespace osuCrypto {
 
 		if (mBase->mStopped == true) throw std::runtime_error("rt error at " LOCATION);
 
+		if (mBase->mMux)
+			return Channel(*mBase->mIOService, mBase->mMux->addStream(localName, remoteName));
+
+		auto& opt = mBase->mSocketOptions;
+		if (opt.mStripes > 1)
+		{
+			std::vector<Channel> stripes;
+			for (u64 i = 0; i < opt.mStripes; ++i)
+			{
+				std::string idx = "#";
+				idx += std::to_string(i);
+				stripes.push_back(Channel(*this, localName + idx, remoteName + idx));
+			}
+			return Channel(*mBase->mIOService, new StripedSocket(std::move(stripes), opt.mStripeSize));
+		}
 
 		// construct the basic channel. Has no socket.
 		Channel chl(*this, localName, remoteName);
@@ -186,6 +235,41 @@ namespace osuCrypto {
 	}
 
 
+	void Session::multiplex(MultiplexOptions opt)
+	{
+		if (mBase == nullptr || mBase->mStopped)
+			throw std::runtime_error("Session is not started. " LOCATION);
+		if (mBase->mMux)
+			throw std::runtime_error("Session is already multiplexed. " LOCATION);
+		if (opt.mNumSockets == 0)
+			throw std::runtime_error("MultiplexOptions::mNumSockets must be positive. " LOCATION);
+
+		std::vector<Channel> carriers;
+		for (u64 i = 0; i < opt.mNumSockets; ++i)
+		{
+			auto name = "_mux_" + std::to_string(i);
+			carriers.push_back(Channel(*this, name, name));
+		}
+		mBase->mMux = std::make_shared<Multiplexer>(*mBase->mIOService, std::move(carriers), opt);
+	}
+
+	void Session::setSocketOptions(const SocketOptions& opt)
+	{
+		if (mBase == nullptr)
+			throw std::runtime_error("Session is not initialized. " LOCATION);
+		if (opt.mStripes == 0 || opt.mStripeSize == 0)
+			throw std::runtime_error("SocketOptions::mStripes and mStripeSize must be positive. " LOCATION);
+
+		{
+			std::lock_guard<std::mutex> lock(mBase->mAddChannelMtx);
+			mBase->mSocketOptions = opt;
+		}
+
+		// the accepted sockets inherit the buffer sizes of the listening socket.
+		if (mBase->mAcceptor && (opt.mSendBufferSize || opt.mRecvBufferSize))
+			mBase->mAcceptor->setListenBufferSizes(opt);
+	}
+
 	void Session::stop()
 	{
 		mBase->stop();
@@ -198,6 +282,10 @@ namespace osuCrypto {
 			mStopped = true;
 			if (mAcceptor)
 				mAcceptor->unsubscribe(this);
+
+			// the carriers refer to this session. The channels keep the
+			// Multiplexer alive.
+			mMux.reset();
 			mWorker.reset();
 		}
 	}
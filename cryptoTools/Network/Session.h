@@ -5,6 +5,8 @@
 
 #include "cryptoTools/Common/Defines.h"
 #include <cryptoTools/Network/Channel.h>
+#include <cryptoTools/Network/Multiplexer.h>
+#include <cryptoTools/Network/SocketOptions.h>
 
 #include <string>
 #include <list>
@@ -32,6 +34,7 @@ namespace osuCrypto {
 		// The client should use the address of the server.
 		// The same name should be used by both sessions. Multiple Sessions can be bound to the same
 		// address if the same IOService is used but with different name.
+		// remoteIp can also be "unix:<path>", see below, in which case port is ignored.
         void start(IOService& ioService, std::string remoteIp, u32 port, SessionMode type, std::string name = "");
 
 		// Start a session for the given address in either Client or Server mode.
@@ -39,6 +42,9 @@ namespace osuCrypto {
 		// The client should use the address of the server.
 		// The same name should be used by both sessions. Multiple Sessions can be bound to the same
 		// address if the same IOService is used but with different name.
+		// An address of the form "unix:<path>" uses the unix domain socket at path
+		// instead of TCP. The server creates the socket file and removes it once
+		// it stops listening. TLS is not supported over unix domain sockets.
         void start(IOService& ioService, std::string address, SessionMode type, std::string name = "");
 
         void start(IOService& ioService, std::string ip, u64 port, SessionMode type, TLSContext& tls, std::string name = "");
@@ -71,6 +77,20 @@ namespace osuCrypto {
         // Adds a new channel (data pipe) between this endpoint and the remote. The channel is named at each end.
         Channel addChannel(std::string localName = "", std::string remoteName = "");
 
+        // Carries the channels that are added after this call as streams over
+        // opt.mNumSockets sockets instead of a socket per channel, see Multiplexer.
+        // Both sessions must call it before adding their first channel.
+        void multiplex(MultiplexOptions opt = {});
+
+        // Sets the options of the sockets of the channels that are added
+        // after this call, see SocketOptions. With opt.mStripes > 1 each
+        // channel is a StripedSocket over that many sockets. Both sessions
+        // must use the same mStripes and mStripeSize. On a server the buffer
+        // sizes are also set on the listening socket so that the accepted
+        // sockets are created with them, as the TCP window scale is fixed
+        // once they are connected. Call this before the client connects.
+        void setSocketOptions(const SocketOptions& opt);
+
         // Stops this Session.
 		void stop(/*const std::optional<std::chrono::milliseconds>& waitTime = {}*/);
 
@@ -103,6 +123,9 @@ namespace osuCrypto {
 		//void cancelPendingConnection(ChannelBase* chl);
 
 		std::string mIP;
+
+		// the path of the unix domain socket, or empty for TCP.
+		std::string mUnixPath;
 		u32 mPort = 0, mAnonymousChannelIdx = 0;
 		SessionMode mMode = SessionMode::Client;
 		bool mStopped = true;
@@ -117,6 +140,12 @@ namespace osuCrypto {
 		//bool mHasGroup = false;
 		std::shared_ptr<details::SessionGroup> mGroup;
 
+		// the streams of a multiplexed session, see Session::multiplex.
+		std::shared_ptr<Multiplexer> mMux;
+
+		// see Session::setSocketOptions.
+		SocketOptions mSocketOptions;
+
         TLSContext mTLSContext;
 
 		std::mutex mAddChannelMtx;
@@ -130,7 +159,7 @@ namespace osuCrypto {
 		block mTLSSessionID;
 #endif
 
-		boost::asio::ip::tcp::endpoint mRemoteAddr;
+		boost::asio::generic::stream_protocol::endpoint mRemoteAddr;
 	};
 
 
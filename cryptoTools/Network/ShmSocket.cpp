@@ -0,0 +1,628 @@
+#include "ShmSocket.h"
+#if defined(ENABLE_BOOST) && defined(__linux__)
+
+#include "cryptoTools/Network/IOService.h"
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+
+namespace osuCrypto
+{
+    namespace
+    {
+        const u32 shmMagic = 0x6f63736d;
+
+        // the state of a party in the shared memory. The server is party 0.
+        struct alignas(64) ShmParty
+        {
+            // incremented whenever the party might be able to make progress.
+            // The worker sleeps on it with a futex if mSleeping is set.
+            std::atomic<u32> mBell;
+            std::atomic<u32> mSleeping;
+            std::atomic<u32> mClosed;
+        };
+
+        // the ring buffer that carries the data of a party, where the byte i
+        // of the stream is at i % capacity.
+        struct ShmRing
+        {
+            alignas(64) std::atomic<u64> mWritten;
+            alignas(64) std::atomic<u64> mRead;
+        };
+
+        // the start of the shared memory, which is followed by the data of
+        // ring 0 and then ring 1.
+        struct alignas(64) ShmHeader
+        {
+            // set once the server has initialized the header.
+            std::atomic<u32> mMagic;
+            std::atomic<u32> mClientAttached;
+
+            // the process of the server, which is set before mMagic.
+            std::atomic<i32> mServerPid;
+            u64 mCapacity;
+            ShmParty mParty[2];
+            ShmRing mRing[2];
+        };
+
+        std::runtime_error sysError(const std::string& what, int err, const char* location)
+        {
+            return std::runtime_error(what + " failed: " + strerror(err) + "\n" + location);
+        }
+
+        // whether the process pid might still exist. Only its absence is
+        // certain.
+        bool processExists(i32 pid)
+        {
+            return ::kill(pid, 0) == 0 || errno != ESRCH;
+        }
+
+        void futexWait(std::atomic<u32>& word, u32 value)
+        {
+            syscall(SYS_futex, (u32*)&word, FUTEX_WAIT, value, nullptr, nullptr, 0);
+        }
+
+        void futexWake(std::atomic<u32>& word)
+        {
+            syscall(SYS_futex, (u32*)&word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+        }
+
+        // lets party p make progress.
+        void ring(ShmParty& p)
+        {
+            p.mBell.fetch_add(1);
+            if (p.mSleeping.load())
+                futexWake(p.mBell);
+        }
+
+        struct Completion
+        {
+            io_completion_handle mFn;
+            error_code mEc;
+            u64 mBytes;
+        };
+
+        // a send or receive, which is complete once mMinSize bytes have been
+        // transferred.
+        struct ShmOp
+        {
+            std::vector<boost::asio::mutable_buffer> mBuffers;
+            u64 mIdx = 0, mOffset = 0, mBytes = 0, mMinSize = 0;
+            io_completion_handle mFn;
+            bool mPending = false;
+
+            void set(span<boost::asio::mutable_buffer> buffers, u64 minSize, io_completion_handle&& fn)
+            {
+                if (mPending)
+                    throw std::runtime_error("ShmSocket supports one outstanding operation per direction. " LOCATION);
+
+                mBuffers.clear();
+                u64 total = 0;
+                for (auto& b : buffers)
+                {
+                    if (b.size())
+                        mBuffers.push_back(b);
+                    total += b.size();
+                }
+                mIdx = mOffset = mBytes = 0;
+                mMinSize = std::min(minSize, total);
+                mFn = std::move(fn);
+                mPending = true;
+            }
+
+            // the rest of the current buffer.
+            span<u8> current()
+            {
+                auto& b = mBuffers[mIdx];
+                return { (u8*)b.data() + mOffset, b.size() - mOffset };
+            }
+
+            void advance(u64 n)
+            {
+                mBytes += n;
+                mOffset += n;
+                if (mOffset == mBuffers[mIdx].size())
+                {
+                    ++mIdx;
+                    mOffset = 0;
+                }
+            }
+
+            bool full() const { return mIdx == mBuffers.size(); }
+            bool done() const { return mBytes >= mMinSize; }
+
+            void finish(error_code ec, std::vector<Completion>& out)
+            {
+                mPending = false;
+                out.push_back({ std::move(mFn), ec, mBytes });
+            }
+        };
+    }
+
+    struct ShmSocket::State
+    {
+        Options mOpt;
+        std::string mPath;
+        u64 mSide = 0, mCapacity = 0, mMapSize = 0;
+        IOService* mIos = nullptr;
+
+        // the shared memory, which the client sets under mMtx once it has
+        // attached. It does not change after that.
+        ShmHeader* mHeader = nullptr;
+        u8* mTx = nullptr, * mRx = nullptr;
+
+        std::mutex mMtx;
+        ShmOp mSend, mRecv;
+        bool mStop = false, mCancel = false, mClose = false;
+
+        // the error of the operations of a client that failed to attach.
+        error_code mAttachEc;
+        std::condition_variable mAttachCv;
+        std::thread mThread;
+
+        State(const std::string& name, SessionMode mode, Options opt)
+            : mOpt(opt)
+            , mPath("/cryptoTools_" + name)
+            , mSide(mode == SessionMode::Server ? 0 : 1)
+        {
+            if (mode == SessionMode::Server)
+                create();
+
+            mThread = std::thread([this] {
+                if (mSide == 0 || attach())
+                    run();
+            });
+        }
+
+        ~State()
+        {
+            ShmHeader* header;
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                mStop = true;
+                header = mHeader;
+            }
+            if (header)
+                ring(me());
+            else
+                mAttachCv.notify_all();
+            mThread.join();
+
+            if (mHeader)
+            {
+                if (mSide == 0 && mHeader->mClientAttached.load() == 0)
+                    shm_unlink(mPath.c_str());
+                munmap(mHeader, mMapSize);
+            }
+        }
+
+        void setRings()
+        {
+            auto data = (u8*)mHeader + sizeof(ShmHeader);
+            mTx = data + mSide * mCapacity;
+            mRx = data + (mSide ^ 1) * mCapacity;
+        }
+
+        // removes the shared memory at mPath if the server that created it
+        // has exited, e.g. crashed before a client attached. The segment is
+        // locked and the name checked to still refer to it so that two
+        // servers cannot both replace it. Returns true if the name can be
+        // created again.
+        bool removeStale()
+        {
+            auto fd = shm_open(mPath.c_str(), O_RDWR, 0600);
+            if (fd < 0)
+                return errno == ENOENT;
+
+            bool removed = false;
+            struct stat st;
+            if (flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0 && u64(st.st_size) >= sizeof(ShmHeader))
+            {
+                auto ptr = mmap(nullptr, sizeof(ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+                if (ptr != MAP_FAILED)
+                {
+                    auto header = (ShmHeader*)ptr;
+                    if (header->mMagic.load(std::memory_order_acquire) == shmMagic &&
+                        processExists(header->mServerPid.load()) == false)
+                    {
+                        struct stat cur;
+                        auto fd2 = shm_open(mPath.c_str(), O_RDONLY, 0600);
+                        if (fd2 >= 0 && fstat(fd2, &cur) == 0 &&
+                            cur.st_dev == st.st_dev && cur.st_ino == st.st_ino)
+                            removed = shm_unlink(mPath.c_str()) == 0;
+                        if (fd2 >= 0)
+                            ::close(fd2);
+                    }
+                    munmap(ptr, sizeof(ShmHeader));
+                }
+            }
+
+            // also releases the lock.
+            ::close(fd);
+            return removed;
+        }
+
+        void create()
+        {
+            mCapacity = mOpt.mCapacity;
+            if (mCapacity == 0 || (mCapacity & (mCapacity - 1)))
+                throw std::runtime_error("ShmSocket::Options::mCapacity must be a power of two. " LOCATION);
+
+            // the name of a live server is not taken over.
+            auto fd = shm_open(mPath.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0 && errno == EEXIST && removeStale())
+                fd = shm_open(mPath.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0)
+                throw sysError("shm_open(" + mPath + ")", errno, LOCATION);
+
+            mMapSize = sizeof(ShmHeader) + 2 * mCapacity;
+            if (ftruncate(fd, mMapSize) < 0)
+            {
+                auto err = errno;
+                ::close(fd);
+                shm_unlink(mPath.c_str());
+                throw sysError("ftruncate", err, LOCATION);
+            }
+
+            auto ptr = mmap(nullptr, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (ptr == MAP_FAILED)
+            {
+                shm_unlink(mPath.c_str());
+                throw sysError("mmap", errno, LOCATION);
+            }
+
+            // the memory is zero, which is a valid state of the atomics.
+            mHeader = (ShmHeader*)ptr;
+            mHeader->mCapacity = mCapacity;
+            mHeader->mServerPid.store(::getpid());
+            mHeader->mMagic.store(shmMagic, std::memory_order_release);
+            setRings();
+        }
+
+        // maps the shared memory if a live server has created it. Sets ec
+        // if it cannot be opened.
+        ShmHeader* tryMap(u64& size, error_code& ec)
+        {
+            auto fd = shm_open(mPath.c_str(), O_RDWR, 0600);
+            if (fd < 0)
+            {
+                if (errno != ENOENT)
+                    ec = error_code(errno, boost::system::system_category());
+                return nullptr;
+            }
+
+            struct stat st;
+            void* ptr = MAP_FAILED;
+            if (fstat(fd, &st) == 0 && u64(st.st_size) >= sizeof(ShmHeader))
+                ptr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (ptr == MAP_FAILED)
+                return nullptr;
+
+            // the server might still be initializing it or have exited.
+            auto header = (ShmHeader*)ptr;
+            if (header->mMagic.load(std::memory_order_acquire) != shmMagic ||
+                processExists(header->mServerPid.load()) == false)
+            {
+                munmap(ptr, st.st_size);
+                return nullptr;
+            }
+            size = st.st_size;
+            return header;
+        }
+
+        // called by the worker of the client to wait for the server to
+        // create the shared memory and map it. The wait ends early if the
+        // socket is closed or destroyed, or fails once mAttachTimeout has
+        // passed. Then the operations fail with the error and false is
+        // returned.
+        bool attach()
+        {
+            auto deadline = std::chrono::steady_clock::now() + mOpt.mAttachTimeout;
+            std::vector<Completion> out;
+            while (true)
+            {
+                error_code ec;
+                u64 size = 0;
+                auto header = tryMap(size, ec);
+
+                bool attached = false;
+                {
+                    std::unique_lock<std::mutex> lock(mMtx);
+                    if (mCancel)
+                    {
+                        mCancel = false;
+                        if (mSend.mPending)
+                            mSend.finish(boost::asio::error::operation_aborted, out);
+                        if (mRecv.mPending)
+                            mRecv.finish(boost::asio::error::operation_aborted, out);
+                    }
+
+                    if (mStop || mClose)
+                        ec = boost::asio::error::operation_aborted;
+                    else if (header == nullptr && !ec && std::chrono::steady_clock::now() >= deadline)
+                        ec = boost::asio::error::timed_out;
+
+                    if (ec)
+                    {
+                        mAttachEc = ec;
+                        if (mSend.mPending)
+                            mSend.finish(ec, out);
+                        if (mRecv.mPending)
+                            mRecv.finish(ec, out);
+                    }
+                    else if (header)
+                    {
+                        mHeader = header;
+                        mMapSize = size;
+                        mCapacity = header->mCapacity;
+                        setRings();
+                        mHeader->mClientAttached.store(1);
+                        shm_unlink(mPath.c_str());
+                        attached = true;
+                    }
+                    else
+                        mAttachCv.wait_for(lock, std::chrono::milliseconds(1),
+                            [&] { return mStop || mClose || mCancel; });
+                }
+
+                if (ec && header)
+                    munmap(header, size);
+                dispatch(out);
+                if (ec || attached)
+                    return attached;
+            }
+        }
+
+        ShmParty& me() { return mHeader->mParty[mSide]; }
+        ShmParty& peer() { return mHeader->mParty[mSide ^ 1]; }
+
+        // copies as much of op into the outgoing ring as fits.
+        bool write(ShmOp& op)
+        {
+            auto& r = mHeader->mRing[mSide];
+            auto w = r.mWritten.load(std::memory_order_relaxed);
+            auto space = mCapacity - (w - r.mRead.load(std::memory_order_acquire));
+            auto begin = w;
+            while (space && !op.full())
+            {
+                auto src = op.current();
+                auto pos = w & (mCapacity - 1);
+                auto n = std::min<u64>({ space, src.size(), mCapacity - pos });
+                memcpy(mTx + pos, src.data(), n);
+                op.advance(n);
+                w += n;
+                space -= n;
+            }
+            r.mWritten.store(w, std::memory_order_release);
+            return w != begin;
+        }
+
+        // copies as much of the incoming ring into op as is available.
+        bool read(ShmOp& op)
+        {
+            auto& r = mHeader->mRing[mSide ^ 1];
+            auto rd = r.mRead.load(std::memory_order_relaxed);
+            auto avail = r.mWritten.load(std::memory_order_acquire) - rd;
+            auto begin = rd;
+            while (avail && !op.full())
+            {
+                auto dest = op.current();
+                auto pos = rd & (mCapacity - 1);
+                auto n = std::min<u64>({ avail, dest.size(), mCapacity - pos });
+                memcpy(dest.data(), mRx + pos, n);
+                op.advance(n);
+                rd += n;
+                avail -= n;
+            }
+            r.mRead.store(rd, std::memory_order_release);
+            return rd != begin;
+        }
+
+        // advances the pending operations. Returns true if the peer should
+        // be woken. mMtx must be held.
+        bool step(std::vector<Completion>& out)
+        {
+            bool progress = false;
+            auto peerClosed = peer().mClosed.load() != 0;
+
+            if (mCancel)
+            {
+                mCancel = false;
+                if (mSend.mPending)
+                    mSend.finish(boost::asio::error::operation_aborted, out);
+                if (mRecv.mPending)
+                    mRecv.finish(boost::asio::error::operation_aborted, out);
+            }
+
+            if (mSend.mPending)
+            {
+                if (peerClosed)
+                    mSend.finish(boost::asio::error::broken_pipe, out);
+                else
+                {
+                    progress |= write(mSend);
+                    if (mSend.done())
+                        mSend.finish({}, out);
+                }
+            }
+
+            if (mRecv.mPending)
+            {
+                // all data that the peer wrote before closing is read here.
+                progress |= read(mRecv);
+                if (mRecv.done())
+                    mRecv.finish({}, out);
+                else if (peerClosed)
+                    mRecv.finish(boost::asio::error::eof, out);
+            }
+
+            return progress;
+        }
+
+        void run()
+        {
+            std::vector<Completion> out;
+            u64 spins = 0;
+            while (true)
+            {
+                auto bell = me().mBell.load();
+                bool progress, stop, pending;
+                {
+                    std::lock_guard<std::mutex> lock(mMtx);
+                    stop = mStop;
+                    progress = step(out);
+                    pending = mSend.mPending || mRecv.mPending;
+                }
+
+                if (progress)
+                    ring(peer());
+                dispatch(out);
+
+                if (stop)
+                    return;
+
+                if (progress)
+                    spins = 0;
+                else if (pending && spins < mOpt.mSpinCount)
+                {
+                    ++spins;
+                    std::this_thread::yield();
+                }
+                else
+                {
+                    me().mSleeping.store(1);
+                    if (me().mBell.load() == bell)
+                        futexWait(me().mBell, bell);
+                    me().mSleeping.store(0);
+                    spins = 0;
+                }
+            }
+        }
+
+        // completes out on the IOService, or here if it was not set. The
+        // handlers of the worker and of start() go through here so that
+        // they always run on the threads of the IOService.
+        void dispatch(std::vector<Completion>& out)
+        {
+            for (auto& c : out)
+            {
+                if (mIos)
+                    post(mIos, [c = std::move(c)]() { c.mFn(c.mEc, c.mBytes); });
+                else
+                    c.mFn(c.mEc, c.mBytes);
+            }
+            out.clear();
+        }
+
+        // transfers what it can of op now and leaves the rest to the worker.
+        // Before the client has attached, op waits for the worker unless
+        // the attach has failed.
+        void start(ShmOp& op)
+        {
+            std::vector<Completion> out;
+            bool progress = false, pending;
+            ShmHeader* header;
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                header = mHeader;
+                if (header)
+                    progress = step(out);
+                else if (mAttachEc)
+                    op.finish(mAttachEc, out);
+                pending = op.mPending;
+            }
+
+            if (progress)
+                ring(peer());
+            if (pending && header)
+                ring(me());
+            dispatch(out);
+        }
+    };
+
+    ShmSocket::ShmSocket(const std::string& name, SessionMode mode, Options opt)
+        : mState(new State(name, mode, opt))
+    {}
+
+    ShmSocket::~ShmSocket()
+    {
+        close();
+        mState.reset();
+    }
+
+    void ShmSocket::async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->mSend.set(buffers, ~0ull, std::move(fn));
+        }
+        mState->start(mState->mSend);
+    }
+
+    void ShmSocket::async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->mRecv.set(buffers, ~0ull, std::move(fn));
+        }
+        mState->start(mState->mRecv);
+    }
+
+    void ShmSocket::async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->mRecv.set({ &buffer, 1 }, minSize, std::move(fn));
+        }
+        mState->start(mState->mRecv);
+    }
+
+    void ShmSocket::close()
+    {
+        ShmHeader* header;
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->mClose = true;
+            header = mState->mHeader;
+        }
+
+        if (header == nullptr)
+            mState->mAttachCv.notify_all();
+        else if (mState->me().mClosed.exchange(1) == 0)
+            ring(mState->peer());
+    }
+
+    void ShmSocket::cancel()
+    {
+        ShmHeader* header;
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->mCancel = true;
+            header = mState->mHeader;
+        }
+
+        if (header == nullptr)
+            mState->mAttachCv.notify_all();
+        else
+            ring(mState->me());
+    }
+
+    void ShmSocket::setIOService(IOService& ios)
+    {
+        mState->mIos = &ios;
+    }
+}
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#if defined(ENABLE_BOOST) && defined(__linux__)
+
+#include "cryptoTools/Network/SocketAdapter.h"
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace osuCrypto
+{
+
+    // The options of a ShmSocket.
+    struct ShmSocketOptions
+    {
+        // the size of the ring buffer in each direction, which must be a
+        // power of two. Only the server's value is used.
+        u64 mCapacity = 1 << 22;
+
+        // the number of times the worker yields before it sleeps when there
+        // is no progress.
+        u64 mSpinCount = 64;
+
+        // how long the client waits for the server to create the shared
+        // memory. The operations of the client then fail with timed_out.
+        std::chrono::milliseconds mAttachTimeout = std::chrono::seconds(30);
+    };
+
+    // A SocketInterface between two parties on the same host that moves the
+    // data through a shared memory ring buffer in each direction instead of
+    // the TCP loopback. The parties are matched by name in the same way as
+    // Session::start, e.g.
+    //
+    //   Channel server(ios, new ShmSocket("myName", SessionMode::Server));
+    //   Channel client(ios, new ShmSocket("myName", SessionMode::Client));
+    //
+    // where the server creates the shared memory object
+    // /dev/shm/cryptoTools_<name> and throws if a live server already has
+    // the name. The name of a server that exited without a client is
+    // replaced. The client does not block. Its operations wait until it has
+    // mapped the shared memory, which then removes the name, and fail if
+    // this takes longer than mAttachTimeout or the socket is closed first.
+    // The parties can be different processes.
+    //
+    // Each socket has a worker thread that copies between the rings and the
+    // buffers of the Channel and posts the handlers to the IOService. It
+    // sleeps on a futex in the shared memory that the peer wakes when it
+    // reads or writes a ring.
+    class ShmSocket : public SocketInterface
+    {
+    public:
+        using Options = ShmSocketOptions;
+
+        ShmSocket(const std::string& name, SessionMode mode, Options opt = {});
+
+        ~ShmSocket() override;
+
+        void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn) override;
+
+        // the peer receives eof once it has read all of the data.
+        void close() override;
+
+        void cancel() override;
+
+        void setIOService(IOService& ios) override;
+
+        struct State;
+        std::unique_ptr<State> mState;
+    };
+
+}
+#endif
@@ -43,6 +43,16 @@ namespace osuCrypto
         // @fn [input]:   A call back that should be called on completion of the IO
         virtual void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) = 0;
 
+        // OPTIONAL -- receive at least minSize and at most buffer.size() bytes
+        // into buffer and call fn with the number received. The caller owns
+        // buffer until fn is called. This is used by the receive read-ahead of
+        // the Channel. The default receives exactly minSize bytes.
+        virtual void async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn)
+        {
+            buffer = boost::asio::mutable_buffer(buffer.data(), minSize);
+            async_recv({ &buffer, 1 }, std::move(fn));
+        }
+
 
         // OPTIONAL -- no-op close is default. Will be called when all Channels that refernece it are destructed/
         virtual void close() {};
@@ -322,21 +332,30 @@ namespace osuCrypto
 
 
 
-    class BoostSocketInterface : public SocketInterface
+    // A SocketInterface for an asio stream socket, e.g. a tcp::socket or
+    // a local::stream_protocol::socket.
+    template<typename Socket>
+    class BasicBoostSocketInterface : public SocketInterface
     {
     public:
-        boost::asio::ip::tcp::socket mSock;
+        Socket mSock;
 
 #ifndef BOOST_ASIO_HAS_MOVE
 #error "require move"
 #endif
 
-        BoostSocketInterface(boost::asio::ip::tcp::socket&& ios)
-            : mSock(std::forward<boost::asio::ip::tcp::socket>(ios))
+        BasicBoostSocketInterface(Socket&& ios)
+            : mSock(std::forward<Socket>(ios))
+        {
+        }
+
+        // constructs an unopened socket in place.
+        BasicBoostSocketInterface(boost::asio::io_context& ios)
+            : mSock(ios)
         {
         }
 
-        ~BoostSocketInterface() override
+        ~BasicBoostSocketInterface() override
         {
             close();
         }
@@ -345,7 +364,7 @@ namespace osuCrypto
 			boost::system::error_code ec;
 			mSock.close(ec);
 			if (ec) 
-                std::cout <<"BoostSocketInterface::close() error: "<< ec.message() << std::endl; 
+                std::cout <<"BasicBoostSocketInterface::close() error: "<< ec.message() << std::endl; 
 		}
 
         void cancel() override
@@ -360,7 +379,7 @@ namespace osuCrypto
 #endif
 
 			if (ec) 
-                std::cout <<"BoostSocketInterface::cancel() error: "<< ec.message() << std::endl; 
+                std::cout <<"BasicBoostSocketInterface::cancel() error: "<< ec.message() << std::endl; 
         }
 
         void async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override
@@ -372,6 +391,18 @@ namespace osuCrypto
         {
             boost::asio::async_write(mSock, buffers, std::forward<io_completion_handle>(fn));
         }
+
+        void async_recv_some(boost::asio::mutable_buffer& buffer, u64 minSize, io_completion_handle&& fn) override
+        {
+            boost::asio::async_read(mSock, buffer, boost::asio::transfer_at_least(minSize),
+                std::forward<io_completion_handle>(fn));
+        }
     };
+
+    using BoostSocketInterface = BasicBoostSocketInterface<boost::asio::ip::tcp::socket>;
+
+    // The socket that the Session accepts and connects, which is either
+    // TCP or a unix domain socket.
+    using StreamSocketInterface = BasicBoostSocketInterface<boost::asio::generic::stream_protocol::socket>;
 }
 #endif
@@ -0,0 +1,47 @@
+#include "SocketOptions.h"
+#ifdef ENABLE_BOOST
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace osuCrypto
+{
+
+    void applySocketOptions(
+        boost::asio::generic::stream_protocol::socket& sock,
+        const SocketOptions& opt,
+        error_code& ec)
+    {
+        ec = {};
+        auto family = sock.local_endpoint(ec).protocol().family();
+        if (ec)
+            return;
+        bool tcp = family == AF_INET || family == AF_INET6;
+
+        if (opt.mSendBufferSize && !ec)
+            sock.set_option(boost::asio::socket_base::send_buffer_size(
+                static_cast<int>(opt.mSendBufferSize)), ec);
+        if (opt.mRecvBufferSize && !ec)
+            sock.set_option(boost::asio::socket_base::receive_buffer_size(
+                static_cast<int>(opt.mRecvBufferSize)), ec);
+        if (tcp && !ec)
+            sock.set_option(boost::asio::ip::tcp::no_delay(opt.mNoDelay), ec);
+
+#ifdef __linux__
+        if (tcp && opt.mQuickAck && !ec)
+            sock.set_option(boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK>(true), ec);
+        if (opt.mBusyPoll && !ec)
+            sock.set_option(boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>(
+                static_cast<int>(opt.mBusyPoll)), ec);
+#ifdef SO_ZEROCOPY
+        if (tcp && opt.mZeroCopy && !ec)
+            sock.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_ZEROCOPY>(true), ec);
+#endif
+#endif
+    }
+
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/SocketAdapter.h"
+
+namespace osuCrypto
+{
+
+    // The options of the sockets of a Session, see Session::setSocketOptions.
+    // The defaults are those that the Session has always used.
+    struct SocketOptions
+    {
+        // SO_SNDBUF and SO_RCVBUF in bytes. Zero keeps the system default,
+        // which lets the kernel tune the size. A link with a large bandwidth
+        // delay product needs a receive buffer of at least bandwidth * rtt,
+        // which may also require raising net.core.rmem_max.
+        u64 mSendBufferSize = 0;
+        u64 mRecvBufferSize = 0;
+
+        // TCP_NODELAY.
+        bool mNoDelay = true;
+
+        // Linux only, TCP_QUICKACK. The kernel clears it again after it
+        // leaves the quick ack mode, so it mostly helps the first rounds.
+        bool mQuickAck = false;
+
+        // Linux only, SO_BUSY_POLL in microseconds. Zero disables it.
+        // A value above net.core.busy_poll requires CAP_NET_ADMIN.
+        u64 mBusyPoll = 0;
+
+        // Linux only, the sends of at least mZeroCopyThreshold bytes use
+        // MSG_ZEROCOPY, see ZeroCopySocket. Ignored with TLS.
+        bool mZeroCopy = false;
+        u64 mZeroCopyThreshold = 1 << 14;
+
+        // the number of sockets of each channel. The data is striped over
+        // them in blocks of mStripeSize bytes, see StripedSocket.
+        u64 mStripes = 1;
+        u64 mStripeSize = 1 << 18;
+    };
+
+    // sets the options that apply to the socket. The TCP options are skipped
+    // for other protocols and the Linux options are ignored elsewhere.
+    // mZeroCopy only sets SO_ZEROCOPY.
+    void applySocketOptions(
+        boost::asio::generic::stream_protocol::socket& sock,
+        const SocketOptions& opt,
+        error_code& ec);
+
+}
+#endif
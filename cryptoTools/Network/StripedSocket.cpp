@@ -0,0 +1,224 @@
+#include "StripedSocket.h"
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/IOService.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+namespace osuCrypto
+{
+
+    namespace
+    {
+        // a send or receive that is split over the stripes.
+        struct StripedOp
+        {
+            std::mutex mMtx;
+            std::vector<std::vector<boost::asio::mutable_buffer>> mPieces;
+            u64 mPending = 0, mTotal = 0;
+            error_code mEC;
+            io_completion_handle mFn;
+        };
+    }
+
+    struct StripedSocket::State : std::enable_shared_from_this<StripedSocket::State>
+    {
+        u64 mStripeSize = 0;
+        std::vector<std::unique_ptr<SocketInterface>> mStripes;
+
+        // the position in the stream of the next send and receive.
+        u64 mSendPos = 0, mRecvPos = 0;
+        StripedOp mSend, mRecv;
+
+        // the channels whose sockets are taken once they are connected, and
+        // the operations that wait for them.
+        std::mutex mMtx;
+        std::vector<Channel> mChannels;
+        u64 mConnecting = 0;
+        error_code mConnectEC;
+        std::vector<std::function<void(const error_code&)>> mWaiting;
+
+        void start(StripedOp& op, u64& pos, span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn, bool send)
+        {
+            auto n = mStripes.size();
+            op.mPieces.resize(n);
+            for (auto& p : op.mPieces)
+                p.clear();
+
+            u64 total = 0;
+            for (auto& b : buffers)
+            {
+                auto ptr = static_cast<u8*>(b.data());
+                u64 size = b.size();
+                total += size;
+                while (size)
+                {
+                    auto m = std::min<u64>(size, mStripeSize - pos % mStripeSize);
+                    auto& pieces = op.mPieces[(pos / mStripeSize) % n];
+                    if (pieces.size() && static_cast<u8*>(pieces.back().data()) + pieces.back().size() == ptr)
+                        pieces.back() = boost::asio::mutable_buffer(pieces.back().data(), pieces.back().size() + m);
+                    else
+                        pieces.emplace_back(ptr, m);
+
+                    ptr += m;
+                    size -= m;
+                    pos += m;
+                }
+            }
+
+            op.mTotal = total;
+            op.mEC = {};
+            op.mFn = std::move(fn);
+            op.mPending = std::count_if(op.mPieces.begin(), op.mPieces.end(),
+                [](const std::vector<boost::asio::mutable_buffer>& p) { return p.size(); });
+
+            if (op.mPending == 0)
+            {
+                auto f = std::move(op.mFn);
+                f({}, 0);
+                return;
+            }
+
+            for (u64 i = 0; i < n; ++i)
+            {
+                if (op.mPieces[i].empty())
+                    continue;
+
+                auto cb = [st = shared_from_this(), &op](const error_code& ec, u64) {
+                    std::unique_lock<std::mutex> lock(op.mMtx);
+                    if (ec && !op.mEC)
+                        op.mEC = ec;
+                    if (--op.mPending == 0)
+                    {
+                        auto fn = std::move(op.mFn);
+                        auto e = op.mEC;
+                        auto bt = e ? 0 : op.mTotal;
+                        lock.unlock();
+                        fn(e, bt);
+                    }
+                };
+
+                if (send)
+                    mStripes[i]->async_send(op.mPieces[i], std::move(cb));
+                else
+                    mStripes[i]->async_recv(op.mPieces[i], std::move(cb));
+            }
+        }
+
+        // starts the operation now or, if the stripes are still connecting,
+        // once they are. The span of the caller is only valid during this
+        // call, so the buffer descriptors are copied if the start is deferred.
+        void startWhenConnected(StripedOp& op, u64& pos, span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn, bool send)
+        {
+            std::unique_lock<std::mutex> lock(mMtx);
+            if (mConnecting)
+            {
+                std::vector<boost::asio::mutable_buffer> copy(buffers.begin(), buffers.end());
+                mWaiting.push_back([this, &op, &pos, copy = std::move(copy), fn = std::move(fn), send](const error_code& ec) mutable {
+                    if (ec)
+                        fn(ec, 0);
+                    else
+                        start(op, pos, { copy.data(), copy.size() }, std::move(fn), send);
+                });
+                return;
+            }
+
+            auto ec = mConnectEC;
+            lock.unlock();
+            if (ec)
+                fn(ec, 0);
+            else
+                start(op, pos, buffers, std::move(fn), send);
+        }
+    };
+
+    StripedSocket::StripedSocket(std::vector<std::unique_ptr<SocketInterface>> stripes, u64 stripeSize)
+        : mState(std::make_shared<State>())
+    {
+        if (stripes.empty() || stripeSize == 0)
+            throw std::runtime_error("StripedSocket requires a stripe and a positive stripe size. " LOCATION);
+
+        mState->mStripeSize = stripeSize;
+        mState->mStripes = std::move(stripes);
+    }
+
+    StripedSocket::StripedSocket(std::vector<Channel> stripes, u64 stripeSize)
+        : mState(std::make_shared<State>())
+    {
+        if (stripes.empty() || stripeSize == 0)
+            throw std::runtime_error("StripedSocket requires a stripe and a positive stripe size. " LOCATION);
+
+        auto st = mState;
+        st->mStripeSize = stripeSize;
+        st->mStripes.resize(stripes.size());
+        st->mConnecting = stripes.size();
+        st->mChannels = std::move(stripes);
+
+        // each channel is closed once it is connected and hands over its
+        // socket. The closed channels are kept so that cancel() can abort
+        // those that are still connecting.
+        for (u64 i = 0; i < st->mChannels.size(); ++i)
+        {
+            st->mChannels[i].asyncReleaseSocket([st, i](const error_code& ec, std::unique_ptr<SocketInterface> sock) {
+                std::unique_lock<std::mutex> lock(st->mMtx);
+                if (ec && !st->mConnectEC)
+                    st->mConnectEC = ec;
+                else if (!ec)
+                    st->mStripes[i] = std::move(sock);
+
+                if (--st->mConnecting)
+                    return;
+
+                auto waiting = std::move(st->mWaiting);
+                auto e = st->mConnectEC;
+                lock.unlock();
+
+                for (auto& fn : waiting)
+                    fn(e);
+            });
+        }
+    }
+
+    StripedSocket::~StripedSocket()
+    {
+        close();
+    }
+
+    void StripedSocket::async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        mState->startWhenConnected(mState->mSend, mState->mSendPos, buffers, std::move(fn), true);
+    }
+
+    void StripedSocket::async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        mState->startWhenConnected(mState->mRecv, mState->mRecvPos, buffers, std::move(fn), false);
+    }
+
+    void StripedSocket::close()
+    {
+        std::lock_guard<std::mutex> lock(mState->mMtx);
+        for (auto& s : mState->mStripes)
+            if (s)
+                s->close();
+    }
+
+    void StripedSocket::cancel()
+    {
+        std::lock_guard<std::mutex> lock(mState->mMtx);
+        for (auto& chl : mState->mChannels)
+            chl.asyncCancel([]() {});
+        for (auto& s : mState->mStripes)
+            if (s)
+                s->cancel();
+    }
+
+    void StripedSocket::setIOService(IOService& ios)
+    {
+        for (auto& s : mState->mStripes)
+            if (s)
+                s->setIOService(ios);
+    }
+
+}
+#endif
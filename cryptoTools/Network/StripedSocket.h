@@ -0,0 +1,51 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#ifdef ENABLE_BOOST
+
+#include "cryptoTools/Network/Channel.h"
+#include "cryptoTools/Network/SocketAdapter.h"
+#include <memory>
+#include <vector>
+
+namespace osuCrypto
+{
+
+    // A SocketInterface that spreads the data over several sockets so that a
+    // large message is sent over all of them in parallel, e.g.
+    //
+    //   Channel chl(ios, new StripedSocket(std::move(sockets), 1 << 18));
+    //
+    // The byte stream is cut into blocks of stripeSize bytes and block i is
+    // sent over stripe i % stripes.size(). The receiver reads each block from
+    // the stripe that it knows it was sent on, so no header is needed and the
+    // data arrives in order. Both ends must use the same stripe size and the
+    // same order of the stripes. See SocketOptions::mStripes.
+    class StripedSocket : public SocketInterface
+    {
+    public:
+        StripedSocket(std::vector<std::unique_ptr<SocketInterface>> stripes, u64 stripeSize);
+
+        // takes the sockets of the channels once they are connected, see
+        // Channel::asyncReleaseSocket. The operations that are started before
+        // then wait for them and keep a copy of their buffer descriptors.
+        StripedSocket(std::vector<Channel> stripes, u64 stripeSize);
+
+        ~StripedSocket() override;
+
+        void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void async_recv(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void close() override;
+
+        void cancel() override;
+
+        void setIOService(IOService& ios) override;
+
+        struct State;
+        std::shared_ptr<State> mState;
+    };
+
+}
+#endif
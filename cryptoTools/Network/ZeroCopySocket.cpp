@@ -0,0 +1,275 @@
+#include "ZeroCopySocket.h"
+#if defined(ENABLE_BOOST) && defined(__linux__)
+
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <vector>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0
+#endif
+
+namespace osuCrypto
+{
+
+    struct ZeroCopySocket::State
+    {
+        State(boost::asio::any_io_executor ex)
+            : mExecutor(std::move(ex))
+        {}
+
+        boost::asio::any_io_executor mExecutor;
+
+        std::mutex mMtx;
+        bool mClosed = false;
+        bool mEnabled = false;
+        u64 mThreshold = 0;
+
+        // the send in progress, mIov[mIdx...] is what is left of it.
+        std::vector<iovec> mIov;
+        u64 mIdx = 0, mLeft = 0, mTotal = 0;
+        io_completion_handle mFn;
+        error_code mEC;
+
+        // the number of MSG_ZEROCOPY sends that have been made and that the
+        // kernel has reported done. The kernel numbers them from zero.
+        u32 mIssued = 0, mDone = 0;
+
+        // an async_wait for the error queue is pending.
+        bool mErrWait = false;
+
+        std::atomic<u64> mZeroCopySends{ 0 }, mCopied{ 0 };
+
+        // reads the notifications that are on the error queue.
+        void drain(int fd)
+        {
+            for (;;)
+            {
+                char control[128];
+                msghdr msg{};
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return;
+                }
+
+                for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+                {
+                    if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                        !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+                        continue;
+
+                    auto err = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cm));
+                    if (err->ee_errno || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                        continue;
+
+                    // the sends ee_info, ..., ee_data are done.
+                    u32 n = err->ee_data - err->ee_info + 1;
+                    mDone += n;
+                    if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                        mCopied += n;
+                }
+            }
+        }
+
+        // posts the handler of the send in progress.
+        void complete(std::unique_lock<std::mutex>& lock)
+        {
+            if (!mFn)
+                return;
+
+            auto fn = std::move(mFn);
+            mFn = {};
+            auto ec = mEC;
+            auto bt = mTotal - mLeft;
+            lock.unlock();
+
+            boost::asio::post(mExecutor, [fn = std::move(fn), ec, bt]() mutable { fn(ec, bt); });
+        }
+    };
+
+    ZeroCopySocket::ZeroCopySocket(boost::asio::generic::stream_protocol::socket&& sock, u64 threshold)
+        : StreamSocketInterface(std::move(sock))
+        , mState(std::make_shared<State>(mSock.get_executor()))
+    {
+        mState->mThreshold = threshold;
+
+#if defined(SO_ZEROCOPY)
+        error_code ec;
+        mSock.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_ZEROCOPY>(true), ec);
+        mState->mEnabled = !ec && MSG_ZEROCOPY;
+#endif
+    }
+
+    ZeroCopySocket::~ZeroCopySocket()
+    {
+        close();
+    }
+
+    void ZeroCopySocket::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mState->mMtx);
+            mState->mClosed = true;
+        }
+        StreamSocketInterface::close();
+    }
+
+    void ZeroCopySocket::cancel()
+    {
+        StreamSocketInterface::cancel();
+    }
+
+    u64 ZeroCopySocket::zeroCopySends() const
+    {
+        return mState->mZeroCopySends;
+    }
+
+    u64 ZeroCopySocket::copiedSends() const
+    {
+        return mState->mCopied;
+    }
+
+    void ZeroCopySocket::async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn)
+    {
+        {
+            auto& st = *mState;
+            std::lock_guard<std::mutex> lock(st.mMtx);
+            st.mIov.clear();
+            st.mLeft = 0;
+            for (auto& b : buffers)
+            {
+                if (b.size())
+                    st.mIov.push_back({ b.data(), b.size() });
+                st.mLeft += b.size();
+            }
+            st.mIdx = 0;
+            st.mTotal = st.mLeft;
+            st.mFn = std::move(fn);
+            st.mEC = {};
+        }
+        sendSome();
+    }
+
+    void ZeroCopySocket::sendSome()
+    {
+        auto st = mState;
+        std::unique_lock<std::mutex> lock(st->mMtx);
+        if (!st->mFn)
+            return;
+
+        // the kernel limits the memory that a socket may have pinned, after
+        // which we copy until the next send succeeds.
+        bool copy = false;
+        while (st->mLeft && !st->mClosed)
+        {
+            msghdr msg{};
+            msg.msg_iov = st->mIov.data() + st->mIdx;
+            msg.msg_iovlen = std::min<u64>(st->mIov.size() - st->mIdx, IOV_MAX);
+
+            bool zc = !copy && st->mEnabled && st->mLeft >= st->mThreshold;
+            auto n = ::sendmsg(mSock.native_handle(), &msg,
+                MSG_NOSIGNAL | MSG_DONTWAIT | (zc ? MSG_ZEROCOPY : 0));
+
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == ENOBUFS && zc)
+                {
+                    copy = true;
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    mSock.async_wait(boost::asio::socket_base::wait_write,
+                        [this, st](const error_code& ec) {
+                            if (ec)
+                            {
+                                std::unique_lock<std::mutex> lock(st->mMtx);
+                                st->mEC = ec;
+                                st->complete(lock);
+                            }
+                            else
+                                sendSome();
+                        });
+                    return;
+                }
+
+                st->mEC = error_code(errno, boost::system::system_category());
+                break;
+            }
+
+            copy = false;
+            if (zc)
+            {
+                ++st->mIssued;
+                ++st->mZeroCopySends;
+            }
+
+            u64 bt = n;
+            st->mLeft -= bt;
+            while (bt)
+            {
+                auto& iov = st->mIov[st->mIdx];
+                auto m = std::min<u64>(bt, iov.iov_len);
+                iov.iov_base = static_cast<u8*>(iov.iov_base) + m;
+                iov.iov_len -= m;
+                bt -= m;
+                if (iov.iov_len == 0)
+                    ++st->mIdx;
+            }
+        }
+
+        if (st->mClosed && !st->mEC)
+            st->mEC = boost::asio::error::operation_aborted;
+
+        waitDone(lock);
+    }
+
+    void ZeroCopySocket::waitDone(std::unique_lock<std::mutex>& lock)
+    {
+        auto& st = *mState;
+        if (!st.mEC && !st.mClosed)
+        {
+            auto fd = mSock.native_handle();
+            st.drain(fd);
+            if (st.mDone != st.mIssued && !st.mErrWait)
+            {
+                st.mErrWait = true;
+                mSock.async_wait(boost::asio::socket_base::wait_error,
+                    [this, st = mState](const error_code& ec) {
+                        std::unique_lock<std::mutex> lock(st->mMtx);
+                        st->mErrWait = false;
+                        if (ec)
+                        {
+                            st->mEC = ec;
+                            st->complete(lock);
+                        }
+                        else if (!st->mClosed && (!st->mFn || st->mLeft == 0))
+                            waitDone(lock);
+                    });
+
+                // a notification that came before the wait was registered
+                // did not wake it.
+                st.drain(fd);
+            }
+
+            if (st.mDone != st.mIssued || st.mLeft)
+                return;
+        }
+
+        st.complete(lock);
+    }
+
+}
+#endif
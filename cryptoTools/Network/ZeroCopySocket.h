@@ -0,0 +1,48 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use.
+#include <cryptoTools/Common/config.h>
+#if defined(ENABLE_BOOST) && defined(__linux__)
+
+#include "cryptoTools/Network/SocketAdapter.h"
+#include <memory>
+
+namespace osuCrypto
+{
+
+    // A TCP socket whose large sends use MSG_ZEROCOPY, so the kernel sends
+    // from the buffers of the Channel instead of copying them. A send only
+    // completes once the kernel has reported on the error queue of the
+    // socket that it is done with the buffers. Sends of fewer than threshold
+    // bytes are copied as usual since the notification costs more than the
+    // copy. If the socket does not support SO_ZEROCOPY all sends are copied.
+    // See SocketOptions::mZeroCopy.
+    class ZeroCopySocket : public StreamSocketInterface
+    {
+    public:
+        ZeroCopySocket(boost::asio::generic::stream_protocol::socket&& sock, u64 threshold = 1 << 14);
+
+        ~ZeroCopySocket() override;
+
+        void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override;
+
+        void close() override;
+
+        void cancel() override;
+
+        // the number of sendmsg calls that used MSG_ZEROCOPY.
+        u64 zeroCopySends() const;
+
+        // the number of those that the kernel completed by copying anyway,
+        // e.g. on the loopback device.
+        u64 copiedSends() const;
+
+        struct State;
+        std::shared_ptr<State> mState;
+
+    private:
+        void sendSome();
+        void waitDone(std::unique_lock<std::mutex>& lock);
+    };
+
+}
+#endif
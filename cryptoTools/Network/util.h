@@ -99,6 +99,12 @@ namespace osuCrypto
                 return *(T*)&mStorage[mPopIdx % capacity()];
             }
 
+            T& operator[](u64 i)
+            {
+                assert(i < size());
+                return *(T*)&mStorage[(mPopIdx + i) % capacity()];
+            }
+
             void pop_front(T&out)
             {
                 out = std::move(front());
@@ -128,6 +134,29 @@ namespace osuCrypto
             return mQueues.front().empty();
         }
 
+        u64 size() const
+        {
+            std::lock_guard<std::mutex> l(mMtx);
+            u64 s = 0;
+            for (auto& q : mQueues)
+                s += q.size();
+            return s;
+        }
+
+        // the i'th item from the front. Items do not move once pushed
+        // so the reference is valid until the item is popped.
+        T& operator[](u64 i)
+        {
+            std::lock_guard<std::mutex> l(mMtx);
+            for (auto& q : mQueues)
+            {
+                if (i < q.size())
+                    return q[i];
+                i -= q.size();
+            }
+            throw RTE_LOC;
+        }
+
         void push_back(T&& v)
         {
             std::lock_guard<std::mutex> l(mMtx);
@@ -0,0 +1,97 @@
+#include "AesBench.h"
+
+#include <cryptoTools/Common/CLP.h>
+#include <cryptoTools/Crypto/AES.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using osuCrypto::block;
+    using osuCrypto::u64;
+
+    template<typename Operation>
+    double medianSeconds(u64 repetitions, Operation&& operation)
+    {
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        for (u64 repetition = 0; repetition != repetitions; ++repetition)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            operation();
+            const auto end = std::chrono::steady_clock::now();
+            samples.emplace_back(std::chrono::duration<double>(end - begin).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+}
+
+void aesBench(const osuCrypto::CLP& cmd)
+{
+    const auto logBlocks = cmd.getOr<u64>("n", 22);
+    const auto repetitions = cmd.getOr<u64>("r", 5);
+    const auto maxThreads = cmd.getOr<u64>("t",
+        std::max<u64>(1, std::thread::hardware_concurrency()));
+    if (logBlocks > 32 || repetitions == 0 || maxThreads == 0)
+        throw std::invalid_argument("aes benchmark requires -n <= 32, -r > 0 and -t > 0");
+
+    const u64 blocks = 1ull << logBlocks;
+    const double bytes = blocks * sizeof(block);
+    osuCrypto::AES aes(block(0x9d47a21, 0x6cb85f3));
+    std::vector<block> src(blocks), dst(blocks);
+    aes.ecbEncCounterMode(block(0, 0), src);
+
+    std::cout << "AES benchmark, " << blocks << " blocks (" << bytes / (1 << 20)
+              << " MiB), median of " << repetitions << "\n\n"
+              << std::setw(8) << "threads"
+              << std::setw(16) << "ctr GB/s"
+              << std::setw(16) << "hash GB/s" << '\n';
+
+    std::vector<u64> threadCounts;
+    for (u64 t = 1; t < maxThreads; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    // the serial output is the reference for every thread count.
+    std::vector<block> expectedCtr(blocks), expectedHash(blocks);
+    aes.ecbEncCounterMode(block(0, 0), expectedCtr);
+    aes.hashBlocks(src, expectedHash);
+
+    for (auto t : threadCounts)
+    {
+        auto ctr = medianSeconds(repetitions, [&] { aes.ecbEncCounterMode(block(0, 0), dst, t); });
+        if (dst != expectedCtr)
+            throw std::runtime_error("parallel counter mode does not match the serial output");
+
+        auto hash = medianSeconds(repetitions, [&] { aes.hashBlocks(src, dst, t); });
+        if (dst != expectedHash)
+            throw std::runtime_error("parallel hashBlocks does not match the serial output");
+
+        std::cout << std::setw(8) << t << std::fixed << std::setprecision(2)
+                  << std::setw(16) << bytes / ctr / 1e9
+                  << std::setw(16) << bytes / hash / 1e9 << '\n';
+    }
+
+    // single threaded decryption, src is treated as the ciphertext.
+    osuCrypto::AESDec dec(block(0x9d47a21, 0x6cb85f3));
+    auto ecb = medianSeconds(repetitions, [&] { dec.ecbDecBlocks(src, dst); });
+    auto ecb1 = medianSeconds(repetitions, [&] {
+        for (u64 i = 0; i < blocks; ++i)
+            dec.ecbDecBlock(src[i], dst[i]);
+        });
+    auto cbc = medianSeconds(repetitions, [&] { dec.cbcDecBlocks(block(0, 0), src, dst); });
+    auto ctr = medianSeconds(repetitions, [&] { aes.ctrEncBlocks(block(0, 0), src, dst); });
+
+    std::cout << "\ndecryption GB/s, 1 thread\n" << std::fixed << std::setprecision(2)
+              << "  ecb (per block) " << bytes / ecb1 / 1e9 << '\n'
+              << "  ecb             " << bytes / ecb / 1e9 << '\n'
+              << "  cbc             " << bytes / cbc / 1e9 << '\n'
+              << "  ctr             " << bytes / ctr / 1e9 << '\n';
+}
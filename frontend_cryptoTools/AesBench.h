@@ -0,0 +1,8 @@
+#pragma once
+
+namespace osuCrypto
+{
+    class CLP;
+}
+
+void aesBench(const osuCrypto::CLP& cmd);
@@ -0,0 +1,293 @@
+#include "NetBench.h"
+
+#include <cryptoTools/Common/CLP.h>
+#include <cryptoTools/Common/config.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#ifdef ENABLE_BOOST
+#include <cryptoTools/Common/Finally.h>
+#include <cryptoTools/Network/Channel.h>
+#include <cryptoTools/Network/IOService.h>
+#include <cryptoTools/Network/Session.h>
+#include <cryptoTools/Network/IoUringSocket.h>
+#include <cryptoTools/Network/Multiplexer.h>
+#include <cryptoTools/Network/NetEmuSocket.h>
+#include <cryptoTools/Network/ShmSocket.h>
+#include <cryptoTools/Network/SocketOptions.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace osuCrypto;
+
+    struct Backend
+    {
+        std::string mName;
+
+        // returns a pair of connected channels.
+        std::function<std::pair<Channel, Channel>(IOService&)> mConnect;
+    };
+
+    // a pair of channels over a loopback connection, where make returns
+    // the socket interface of a connected socket.
+    template<typename Make>
+    std::pair<Channel, Channel> connectTcp(IOService& ios, Make make)
+    {
+        boost::asio::ip::tcp::acceptor acceptor(ios.mIoService,
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        boost::asio::ip::tcp::socket s0(ios.mIoService), s1(ios.mIoService);
+        s0.connect(acceptor.local_endpoint());
+        acceptor.accept(s1);
+        s0.set_option(boost::asio::ip::tcp::no_delay(true));
+        s1.set_option(boost::asio::ip::tcp::no_delay(true));
+        return { Channel(ios, make(std::move(s0))), Channel(ios, make(std::move(s1))) };
+    }
+
+    // the seconds to send total bytes as messages of size msgSize one way.
+    double throughput(Channel& send, Channel& recv, u64 total, u64 msgSize)
+    {
+        std::vector<u8> msg(msgSize), dest(msgSize);
+        auto n = total / msgSize;
+        auto t0 = std::chrono::steady_clock::now();
+        auto thrd = std::thread([&] {
+            for (u64 i = 0; i < n; ++i)
+                recv.recv(dest.data(), dest.size());
+        });
+        for (u64 i = 0; i + 1 < n; ++i)
+            send.asyncSend(msg.data(), msg.size());
+        send.send(msg.data(), msg.size());
+        thrd.join();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // the seconds per round trip of a u64.
+    double roundTrip(Channel& c0, Channel& c1, u64 rounds)
+    {
+        auto thrd = std::thread([&] {
+            u64 v;
+            for (u64 i = 0; i < rounds; ++i)
+            {
+                c1.recv(v);
+                c1.send(v);
+            }
+        });
+        auto t0 = std::chrono::steady_clock::now();
+        u64 v = 0;
+        for (u64 i = 0; i < rounds; ++i)
+        {
+            c0.send(v);
+            c0.recv(v);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        thrd.join();
+        return std::chrono::duration<double>(t1 - t0).count() / rounds;
+    }
+
+    // the seconds to connect a pair of sessions with count channels and
+    // send msgSize bytes over each of them, with a socket per channel or
+    // with the channels multiplexed over two sockets.
+    double manyChannels(IOService& ios, u64 count, u64 msgSize, bool mux)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        Session server(ios, "127.0.0.1", 1213, SessionMode::Server, "netBench");
+        Session client(ios, "127.0.0.1", 1213, SessionMode::Client, "netBench");
+        if (mux)
+        {
+            MultiplexOptions opt;
+            opt.mNumSockets = 2;
+            server.multiplex(opt);
+            client.multiplex(opt);
+        }
+
+        std::vector<Channel> c0(count), c1(count);
+        std::vector<u8> msg(msgSize), r;
+        for (u64 i = 0; i < count; ++i)
+        {
+            c0[i] = server.addChannel();
+            c1[i] = client.addChannel();
+            c0[i].asyncSend(msg.data(), msg.size());
+        }
+        for (u64 i = 0; i < count; ++i)
+            c1[i].recv(r);
+        auto t1 = std::chrono::steady_clock::now();
+
+        for (u64 i = 0; i < count; ++i)
+        {
+            c0[i].close();
+            c1[i].close();
+        }
+        return std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    // a pair of session channels over the loopback with the given options.
+    std::pair<Channel, Channel> connectSession(IOService& ios, const SocketOptions& opt, std::string name)
+    {
+        Session server(ios, "127.0.0.1", 1214, SessionMode::Server, name);
+        Session client(ios, "127.0.0.1", 1214, SessionMode::Client, name);
+        server.setSocketOptions(opt);
+        client.setSocketOptions(opt);
+        auto c0 = server.addChannel();
+        auto c1 = client.addChannel();
+        c0.waitForConnection();
+        c1.waitForConnection();
+        return { c0, c1 };
+    }
+}
+
+void netBench(const osuCrypto::CLP& cmd)
+{
+    const auto logBytes = cmd.getOr<u64>("n", 28);
+    const auto rounds = cmd.getOr<u64>("r", 10000);
+    const auto numChannels = cmd.getOr<u64>("c", 64);
+    const auto stripes = cmd.getOr<u64>("s", 4);
+    if (logBytes < 20 || logBytes > 34 || rounds == 0 || stripes == 0)
+        throw std::invalid_argument("network benchmark requires 20 <= -n <= 34, -r > 0 and -s > 0");
+    const u64 total = 1ull << logBytes;
+
+    std::vector<Backend> backends;
+    backends.push_back({ "asio", [](IOService& ios) {
+        return connectTcp(ios, [](boost::asio::ip::tcp::socket&& s) {
+            return new BoostSocketInterface(std::move(s)); });
+    } });
+#ifdef ENABLE_IO_URING
+    if (IoUringSocket::isSupported())
+    {
+        backends.push_back({ "io_uring", [](IOService& ios) {
+            return connectTcp(ios, [](boost::asio::ip::tcp::socket&& s) {
+                return new IoUringSocket(std::move(s)); });
+        } });
+        backends.push_back({ "io_uring multishot", [](IOService& ios) {
+            return connectTcp(ios, [](boost::asio::ip::tcp::socket&& s) {
+                IoUringSocket::Options opt;
+                opt.mMultishotRecv = true;
+                return new IoUringSocket(std::move(s), opt); });
+        } });
+    }
+    else
+        std::cout << "io_uring is not supported by the kernel.\n";
+#else
+    std::cout << "io_uring is not enabled, configure with -DENABLE_IO_URING=ON.\n";
+#endif
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    backends.push_back({ "unix socket", [](IOService& ios) {
+        Session server(ios, "unix:netBench.sock", SessionMode::Server);
+        Session client(ios, "unix:netBench.sock", SessionMode::Client);
+        return std::make_pair(server.addChannel(), client.addChannel());
+    } });
+#endif
+#ifdef __linux__
+    backends.push_back({ "shared memory", [](IOService& ios) {
+        Channel c0(ios, new ShmSocket("netBench", SessionMode::Server));
+        Channel c1(ios, new ShmSocket("netBench", SessionMode::Client));
+        return std::make_pair(c0, c1);
+    } });
+#endif
+
+    std::cout << "intra-host network benchmark, " << total / double(1 << 20)
+              << " MiB per message size, " << rounds << " round trips\n\n"
+              << std::setw(20) << "socket"
+              << std::setw(12) << "msg size"
+              << std::setw(12) << "MB/s"
+              << std::setw(14) << "msgs/s" << '\n';
+
+    IOService ios;
+    for (auto& backend : backends)
+    {
+        auto chls = backend.mConnect(ios);
+        for (u64 msgSize : { 16, 1 << 10, 1 << 16, 1 << 20 })
+        {
+            // the small messages are limited by the per message cost.
+            auto bytes = std::min<u64>(total, msgSize << 18);
+            auto s = throughput(chls.first, chls.second, bytes, msgSize);
+            std::cout << std::setw(20) << backend.mName
+                      << std::setw(12) << msgSize
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(12) << bytes / s / 1e6
+                      << std::setw(14) << std::setprecision(0) << bytes / msgSize / s << '\n';
+        }
+
+        auto rt = roundTrip(chls.first, chls.second, rounds);
+        std::cout << std::setw(20) << backend.mName
+                  << std::setw(12) << "round trip"
+                  << std::setprecision(2) << std::setw(12) << rt * 1e6 << " us\n";
+    }
+
+    std::cout << '\n' << numChannels << " session channels, connect and send 64 KiB each\n";
+    for (auto mux : { false, true })
+    {
+        auto s = manyChannels(ios, numChannels, 1 << 16, mux);
+        std::cout << std::setw(20) << (mux ? "2 sockets, muxed" : "socket per channel")
+                  << std::setprecision(2) << std::setw(12) << s * 1e3 << " ms\n";
+    }
+
+    SocketOptions buffers;
+    buffers.mSendBufferSize = 1 << 22;
+    buffers.mRecvBufferSize = 1 << 22;
+    std::vector<std::pair<std::string, SocketOptions>> configs;
+    configs.emplace_back("default", SocketOptions{});
+    configs.emplace_back("4 MiB buffers", buffers);
+#ifdef __linux__
+    configs.emplace_back("zero copy", buffers);
+    configs.back().second.mZeroCopy = true;
+#endif
+    configs.emplace_back(std::to_string(stripes) + " stripes", buffers);
+    configs.back().second.mStripes = stripes;
+
+    std::cout << "\nsession socket options, " << total / double(1 << 20) << " MiB per message size\n";
+    for (u64 i = 0; i < configs.size(); ++i)
+    {
+        auto chls = connectSession(ios, configs[i].second, "netBench" + std::to_string(i));
+        for (u64 msgSize : { 1 << 16, 1 << 20, 1 << 24 })
+        {
+            auto bytes = std::max<u64>(total, msgSize);
+            auto s = throughput(chls.first, chls.second, bytes, msgSize);
+            std::cout << std::setw(20) << configs[i].first
+                      << std::setw(12) << msgSize
+                      << std::setprecision(1) << std::setw(12) << bytes / s / 1e6 << '\n';
+        }
+        chls.first.close();
+        chls.second.close();
+    }
+
+    // the same protocols over emulated links, which shows whether the
+    // rounds or the bandwidth dominate.
+    std::vector<std::pair<std::string, NetEmuOptions>> links(2);
+    links[0].first = "LAN 0.1ms 10Gbps";
+    links[0].second.mLatency = std::chrono::microseconds(100);
+    links[0].second.mBandwidth = 10000000000ull / 8;
+    links[1].first = "WAN 20ms 100Mbps";
+    links[1].second.mLatency = std::chrono::milliseconds(20);
+    links[1].second.mBandwidth = 100000000 / 8;
+
+    const u64 emuBytes = 1 << 24, emuRounds = 20;
+    std::cout << "\nemulated links, " << emuBytes / double(1 << 20) << " MiB and "
+              << emuRounds << " round trips\n";
+    for (auto& link : links)
+    {
+        auto opt = link.second;
+        auto chls = connectTcp(ios, [opt](boost::asio::ip::tcp::socket&& s) {
+            return new NetEmuSocket(new BoostSocketInterface(std::move(s)), opt); });
+        auto s = throughput(chls.first, chls.second, emuBytes, 1 << 20);
+        auto rt = roundTrip(chls.first, chls.second, emuRounds);
+        std::cout << std::setw(20) << link.first
+                  << std::setprecision(1) << std::setw(12) << emuBytes / s / 1e6 << " MB/s"
+                  << std::setprecision(2) << std::setw(12) << rt * 1e3 << " ms round trip\n";
+        chls.first.close();
+        chls.second.close();
+    }
+}
+#else
+void netBench(const osuCrypto::CLP& cmd)
+{
+    std::cout << "ENABLE_BOOST must be defined to run the network benchmark." << std::endl;
+}
+#endif
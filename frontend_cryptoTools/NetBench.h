@@ -0,0 +1,8 @@
+#pragma once
+
+namespace osuCrypto
+{
+    class CLP;
+}
+
+void netBench(const osuCrypto::CLP& cmd);
@@ -0,0 +1,118 @@
+#include "PrngBench.h"
+
+#include <cryptoTools/Common/CLP.h>
+#include <cryptoTools/Crypto/PRNG.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define OC_PRNG_BENCH_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define OC_PRNG_BENCH_TSC
+#endif
+
+namespace
+{
+    using osuCrypto::block;
+    using osuCrypto::u64;
+    using osuCrypto::u8;
+
+    struct Sample
+    {
+        double mSeconds = 0;
+        double mCycles = 0;
+    };
+
+    u64 readTsc()
+    {
+#ifdef OC_PRNG_BENCH_TSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // the median time and reference cycles of operation over repetitions.
+    template<typename Operation>
+    Sample median(u64 repetitions, Operation&& operation)
+    {
+        std::vector<Sample> samples(repetitions);
+        for (auto& s : samples)
+        {
+            auto c0 = readTsc();
+            auto t0 = std::chrono::steady_clock::now();
+            operation();
+            auto t1 = std::chrono::steady_clock::now();
+            auto c1 = readTsc();
+            s.mSeconds = std::chrono::duration<double>(t1 - t0).count();
+            s.mCycles = double(c1 - c0);
+        }
+        std::sort(samples.begin(), samples.end(),
+            [](const Sample& a, const Sample& b) { return a.mSeconds < b.mSeconds; });
+        return samples[samples.size() / 2];
+    }
+}
+
+void prngBench(const osuCrypto::CLP& cmd)
+{
+    const auto logBytes = cmd.getOr<u64>("n", 26);
+    const auto repetitions = cmd.getOr<u64>("r", 5);
+    if (logBytes < 4 || logBytes > 34 || repetitions == 0)
+        throw std::invalid_argument("prng benchmark requires 4 <= -n <= 34 and -r > 0");
+
+    const u64 total = 1ull << logBytes;
+    osuCrypto::PRNG prng(block(0x5f3a91c, 0x2e8b7d4));
+    osuCrypto::AlignedUnVector<u8> dest(total + 1);
+
+    std::cout << "PRNG benchmark, " << total / double(1 << 20) << " MiB per size, median of "
+              << repetitions << "\n"
+#ifdef OC_PRNG_BENCH_TSC
+              << "cycles are time stamp counter cycles\n"
+#endif
+              << "\n"
+              << std::setw(12) << "get size"
+              << std::setw(12) << "aligned"
+              << std::setw(12) << "GB/s"
+              << std::setw(14) << "bytes/cycle" << '\n';
+
+    // get(dest, size) in a loop until total bytes are generated.
+    for (u64 size : std::vector<u64>{ 1, 8, 16, 64, 1 << 10, 1 << 16, 1 << 20, total })
+    {
+        if (size > total)
+            continue;
+
+        for (u64 misalign : { 0, 1 })
+        {
+            auto s = median(repetitions, [&] {
+                auto d = dest.data() + misalign;
+                for (u64 i = 0; i < total; i += size)
+                    prng.get(d + i, size);
+                });
+
+            std::cout << std::setw(12) << size
+                      << std::setw(12) << (misalign ? "no" : "yes")
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(12) << total / s.mSeconds / 1e9
+                      << std::setw(14) << (s.mCycles ? total / s.mCycles : 0) << '\n';
+        }
+    }
+
+    // the scalar interface.
+    auto s = median(repetitions, [&] {
+        u64 sum = 0;
+        for (u64 i = 0; i < total; i += sizeof(u64))
+            sum += prng.get<u64>();
+        dest[0] = u8(sum);
+        });
+    std::cout << std::setw(12) << "get<u64>()"
+              << std::setw(12) << "-"
+              << std::setw(12) << total / s.mSeconds / 1e9
+              << std::setw(14) << (s.mCycles ? total / s.mCycles : 0) << '\n';
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+namespace osuCrypto
+{
+    class CLP;
+}
+
+void prngBench(const osuCrypto::CLP& cmd);
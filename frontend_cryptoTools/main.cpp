@@ -2,6 +2,9 @@
 #include "../tests_cryptoTools/UnitTests.h"
 #include "Tutorials/Network.h"
 #include "CurveBench.h"
+#include "AesBench.h"
+#include "PrngBench.h"
+#include "NetBench.h"
 #include "cryptoTools/Network/Channel.h"
 #include "cryptoTools/Network/IOService.h"
 #include <cryptoTools/Common/Matrix.h>
@@ -151,6 +154,18 @@ int main(int argc, char** argv)
     {
         curveBench(cmd);
     }
+    else if (cmd.isSet("aesBench"))
+    {
+        aesBench(cmd);
+    }
+    else if (cmd.isSet("prngBench"))
+    {
+        prngBench(cmd);
+    }
+    else if (cmd.isSet("netBench"))
+    {
+        netBench(cmd);
+    }
     else if(cmd.isSet("u"))
     {
         tests_cryptoTools::Tests.runIf(cmd);
@@ -162,7 +177,13 @@ int main(int argc, char** argv)
             << "Run the  network tutorial with:\n\n\t"
             << Color::Green << cmd.mProgramName << " -tut\n\n" << Color::Default
             << "Benchmark Edwards25519 curve operations with:\n\n\t"
-            << Color::Green << cmd.mProgramName << " -curveBench"
+            << Color::Green << cmd.mProgramName << " -curveBench\n\n" << Color::Default
+            << "Benchmark multi-threaded AES counter mode and hashing (-t max threads, -n log2 blocks) with:\n\n\t"
+            << Color::Green << cmd.mProgramName << " -aesBench\n\n" << Color::Default
+            << "Benchmark PRNG::get for small and large requests (-n log2 bytes) with:\n\n\t"
+            << Color::Green << cmd.mProgramName << " -prngBench\n\n" << Color::Default
+            << "Benchmark intra-host throughput and round trips of the socket interfaces (-n log2 bytes, -r round trips, -c channels, -s stripes) with:\n\n\t"
+            << Color::Green << cmd.mProgramName << " -netBench"
             << Color::Default
             << std::endl;
     }
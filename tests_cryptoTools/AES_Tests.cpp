@@ -8,6 +8,9 @@
 #include <cryptoTools/Common/Defines.h>
 #include <cryptoTools/Crypto/AES.h> 
 #include <cryptoTools/Common/Log.h>
+#include <cryptoTools/Common/ParallelFor.h>
+#include <cryptoTools/Crypto/MultiKeyAES.h>
+#include <cryptoTools/Crypto/PRNG.h>
 
 namespace osuCrypto
 {
@@ -159,8 +162,93 @@ namespace tests_cryptoTools
 			if (b0 != b1)
 				throw RTE_LOC;
 		}
+
+		// the bulk paths of the two implementations unroll differently,
+		// so check every length that hits a different mix of the loops.
+		for (u64 length = 0; length < 100; ++length)
+		{
+			std::vector<block> data(length), c0(length), c1(length);
+			for (u64 i = 0; i < length; ++i)
+				data[i] = block(length, 3423 * i);
+
+			enc0.ecbEncBlocks(data, c0);
+			enc1.ecbEncBlocks(data, c1);
+			if (c0 != c1)
+				throw RTE_LOC;
+
+			enc0.hashBlocks(data, c0);
+			enc1.hashBlocks(data, c1);
+			if (c0 != c1)
+				throw RTE_LOC;
+
+			enc0.ecbEncCounterMode(block(length, ~0ull - 20), c0);
+			enc1.ecbEncCounterMode(block(length, ~0ull - 20), c1);
+			if (c0 != c1)
+				throw RTE_LOC;
+		}
 	}
     
+	template<details::AESTypes type>
+	void testDec()
+	{
+		block userKey(2342134234, 213421341234);
+		details::AES<type> enc(userKey);
+		details::AESDec<type> dec(userKey);
+		block iv(4532, 2345234);
+
+		// every length that hits a different mix of the 32, 8 and tail paths.
+		for (u64 length = 0; length < 100; ++length)
+		{
+			std::vector<block> data(length), c(length), p(length);
+			for (u64 i = 0; i < length; ++i)
+				data[i] = block(length, 3423 * i);
+
+			enc.ecbEncBlocks(data, c);
+			dec.ecbDecBlocks(c, p);
+			if (p != data)
+				throw RTE_LOC;
+			for (u64 i = 0; i < length; ++i)
+				if (dec.ecbDecBlock(c[i]) != data[i])
+					throw RTE_LOC;
+
+			dec.ecbDecBlocks(c, c);
+			if (c != data)
+				throw RTE_LOC;
+
+			// cbc encryption is inherently sequential.
+			block prev = iv;
+			for (u64 i = 0; i < length; ++i)
+				prev = c[i] = enc.ecbEncBlock(data[i] ^ prev);
+
+			std::fill(p.begin(), p.end(), ZeroBlock);
+			dec.cbcDecBlocks(iv, c, p);
+			if (p != data)
+				throw RTE_LOC;
+
+			dec.cbcDecBlocks(iv, c, c);
+			if (c != data)
+				throw RTE_LOC;
+
+			enc.ctrEncBlocks(iv, data, c);
+			for (u64 i = 0; i < length; ++i)
+				if (c[i] != (data[i] ^ enc.ecbEncBlock(iv.add_epi64(block(i)))))
+					throw RTE_LOC;
+			enc.ctrEncBlocks(iv, c, c);
+			if (c != data)
+				throw RTE_LOC;
+		}
+
+		// the multi-threaded ctr mode with a partial last chunk.
+		u64 length = details::AES<type>::parallelChunkSize * 2 + 13;
+		std::vector<block> data(length), c0(length), c1(length);
+		for (u64 i = 0; i < length; ++i)
+			data[i] = block(length, 3423 * i);
+		enc.ctrEncBlocks(iv, data, c0);
+		enc.ctrEncBlocks(iv, data, c1, 3);
+		if (c0 != c1)
+			throw RTE_LOC;
+	}
+
 	void AES_EncDec_Test()
 	{
 
@@ -170,6 +258,9 @@ namespace tests_cryptoTools
 #ifdef OC_ENABLE_AESNI
 		test<details::AESTypes::NI>();
 #endif // ENABLE_SSE
+#ifdef OC_ENABLE_VAES
+		test<details::AESTypes::VAES>();
+#endif // OC_ENABLE_VAES
 #ifdef ENABLE_ARM_AES
 		test<details::AESTypes::ARM>();
 #endif // ENABLE_ARM_AES
@@ -178,10 +269,145 @@ namespace tests_cryptoTools
 		compare<details::AESTypes::NI, details::AESTypes::Portable>();
 #endif
 
+#if defined(OC_ENABLE_VAES)
+		compare<details::AESTypes::VAES, details::AESTypes::NI>();
+#endif
+
 #if defined(ENABLE_ARM_AES) && defined(OC_ENABLE_PORTABLE_AES)
 		compare<details::AESTypes::ARM, details::AESTypes::Portable>();
 #endif
 
 }
 
+	void AES_Dec_Test()
+	{
+#ifdef OC_ENABLE_PORTABLE_AES
+		testDec<details::AESTypes::Portable>();
+#endif
+#ifdef OC_ENABLE_AESNI
+		testDec<details::AESTypes::NI>();
+#endif
+#ifdef OC_ENABLE_VAES
+		testDec<details::AESTypes::VAES>();
+#endif
+#ifdef ENABLE_ARM_AES
+		testDec<details::AESTypes::ARM>();
+#endif
+	}
+
+	void AES_Parallel_Test()
+	{
+		AES aes(block(2342134234, 213421341234));
+		block base(23, ~0ull - 100000);
+
+		// not a multiple of the chunk size so the last chunk is partial.
+		u64 length = AES::parallelChunkSize * 5 + 13;
+		std::vector<block> data(length), c0(length), c1(length);
+		for (u64 i = 0; i < length; ++i)
+			data[i] = block(length, 3423 * i);
+
+		aes.ecbEncCounterMode(base, c0);
+		for (u64 numThreads : { 0, 1, 3, 8 })
+		{
+			std::fill(c1.begin(), c1.end(), ZeroBlock);
+			aes.ecbEncCounterMode(base, c1, numThreads);
+			if (c0 != c1)
+				throw RTE_LOC;
+		}
+
+		aes.hashBlocks(data, c0);
+		for (u64 numThreads : { 0, 1, 3, 8 })
+		{
+			std::fill(c1.begin(), c1.end(), ZeroBlock);
+			aes.hashBlocks(data, c1, numThreads);
+			if (c0 != c1)
+				throw RTE_LOC;
+		}
+
+		// a scheduler which defers the helpers until after the call returns,
+		// the caller should then process every chunk by itself.
+		std::vector<std::function<void()>> deferred;
+		TaskScheduler defer = [&](std::function<void()> task) { deferred.push_back(std::move(task)); };
+
+		std::fill(c1.begin(), c1.end(), ZeroBlock);
+		aes.hashBlocks(data, c1, defer, 4);
+		if (c0 != c1 || deferred.size() != 4)
+			throw RTE_LOC;
+		for (auto& task : deferred)
+			task();
+
+		// a scheduler which runs the helpers on threads.
+		std::vector<std::thread> thrds;
+		TaskScheduler spawn = [&](std::function<void()> task) { thrds.emplace_back(std::move(task)); };
+		std::fill(c1.begin(), c1.end(), ZeroBlock);
+		aes.ecbEncCounterMode(base, c1, spawn, 3);
+		for (auto& t : thrds)
+			t.join();
+		aes.ecbEncCounterMode(base, c0);
+		if (c0 != c1)
+			throw RTE_LOC;
+
+		bool threw = false;
+		try {
+			parallelFor(100, 10, 4, [](u64 begin, u64) { if (begin == 50) throw std::runtime_error("test"); });
+		}
+		catch (std::runtime_error&) {
+			threw = true;
+		}
+		if (!threw)
+			throw RTE_LOC;
+	}
+
+	void AES_MultiKey_Test()
+	{
+		PRNG prng(block(324, 5345));
+
+		// the key counts hit the 16, 8, 4 and single key schedules.
+		for (u64 numKeys : { 0, 1, 3, 4, 8, 13, 16, 29, 100 })
+		{
+			std::vector<block> keys(numKeys);
+			prng.get(keys.data(), keys.size());
+
+			DynMultiKeyAES mk(keys);
+			for (u64 i = 0; i < numKeys; ++i)
+			{
+				AES aes(keys[i]);
+				if (aes.mRoundKey != mk.mAESs[i].mRoundKey)
+					throw RTE_LOC;
+			}
+
+			for (u64 blocksPerKey = 0; blocksPerKey < 12; ++blocksPerKey)
+			{
+				u64 n = numKeys * blocksPerKey;
+				std::vector<block> data(n), exp(n), c(n);
+				prng.get(data.data(), data.size());
+
+				for (u64 i = 0; i < n; ++i)
+					exp[i] = mk.mAESs[i / blocksPerKey].ecbEncBlock(data[i]);
+				mk.ecbEncBlocks(data.data(), blocksPerKey, c.data());
+				if (exp != c)
+					throw RTE_LOC;
+
+				for (u64 i = 0; i < n; ++i)
+					exp[i] = exp[i] ^ data[i];
+				mk.hashBlocks(data.data(), blocksPerKey, c.data());
+				if (exp != c)
+					throw RTE_LOC;
+
+				// in place
+				mk.hashBlocks(data, data);
+				if (numKeys && exp != data)
+					throw RTE_LOC;
+			}
+		}
+
+		// MultiKeyAES<N> for N that is not a multiple of 8.
+		std::array<block, 13> keys;
+		prng.get(keys.data(), keys.size());
+		MultiKeyAES<13> mk(keys);
+		for (u64 i = 0; i < keys.size(); ++i)
+			if (mk.mAESs[i].mRoundKey != AES(keys[i]).mRoundKey)
+				throw RTE_LOC;
+	}
+
 }
@@ -5,4 +5,7 @@ namespace tests_cryptoTools
 {
 
     void AES_EncDec_Test();
+    void AES_Dec_Test();
+    void AES_Parallel_Test();
+    void AES_MultiKey_Test();
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "Blake2_Tests.h"
+
+#include <cryptoTools/Crypto/Blake2.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <array>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+    void Blake2_Batch_Test()
+    {
+        PRNG prng(block(7534, 2345));
+
+        // the lengths cover empty, partial, full and multiple blake2b blocks
+        // and the counts cover partial and several batches of lanes.
+        for (u64 inLength : { 0, 1, 16, 33, 64, 127, 128, 129, 256, 300 })
+        {
+            for (u64 outLength : { 1, 16, 20, 32, 64 })
+            {
+                for (u64 n : { 0, 1, 3, 4, 5, 8, 9, 17 })
+                {
+                    std::vector<u8> in(n * inLength), out(n * outLength), exp(n * outLength);
+                    prng.get(in.data(), in.size());
+
+                    for (u64 i = 0; i < n; ++i)
+                    {
+                        Blake2 hasher(outLength);
+                        hasher.Update(in.data() + i * inLength, inLength);
+                        hasher.Final(exp.data() + i * outLength);
+                    }
+
+                    Blake2::hashBatch(in.data(), inLength, n, out.data(), outLength);
+                    if (out != exp)
+                        throw RTE_LOC;
+                }
+            }
+        }
+
+        std::vector<block> x(10), y(10);
+        prng.get(x.data(), x.size());
+        Blake2::hashBatch(span<const block>(x), span<block>(y));
+        for (u64 i = 0; i < x.size(); ++i)
+        {
+            block h;
+            Blake2 hasher(sizeof(block));
+            hasher.Update(x[i]);
+            hasher.Final(h);
+            if (h != y[i])
+                throw RTE_LOC;
+        }
+    }
+
+    void Blake2bp_Test()
+    {
+        PRNG prng(block(2345, 7534));
+        std::vector<u8> in(5000 + (1 << 20));
+        prng.get(in.data(), in.size());
+
+        // the split points cover the stripe buffer being empty, partial and
+        // full when the bulk of the input arrives.
+        for (u64 inLength : { 0, 1, 128, 511, 512, 513, 1024, 3000, 5000 })
+        {
+            for (u64 outLength : { 1, 20, 32, 64 })
+            {
+                std::vector<u8> exp(outLength), out(outLength);
+                blake2bp(exp.data(), outLength, in.data(), inLength, nullptr, 0);
+
+                for (u64 split : { 0, 1, 127, 128, 384, 512, 700 })
+                {
+                    split = std::min(split, inLength);
+                    Blake2bp hasher(outLength);
+                    hasher.Update(in.data(), split);
+                    hasher.Update(in.data() + split, 0);
+                    for (u64 i = split; i < inLength; i += 1100)
+                        hasher.Update(in.data() + i, std::min<u64>(1100, inLength - i));
+                    hasher.Final(out.data());
+
+                    if (out != exp)
+                        throw RTE_LOC;
+                }
+            }
+        }
+
+        // large updates are split between threads.
+        for (u64 numThreads : { 1, 2, 4 })
+        {
+            block exp, out;
+            blake2bp(&exp, sizeof(block), in.data(), in.size(), nullptr, 0);
+
+            Blake2bp hasher(sizeof(block), numThreads);
+            hasher.Update(in.data(), 300);
+            hasher.Update(in.data() + 300, in.size() - 300);
+            hasher.Final(out);
+            if (out != exp)
+                throw RTE_LOC;
+        }
+
+        Blake2bp hasher(sizeof(block));
+        block x = prng.get(), exp, out;
+        blake2bp(&exp, sizeof(block), &x, sizeof(block), nullptr, 0);
+        hasher.Update(x);
+        hasher.Final(out);
+        if (out != exp)
+            throw RTE_LOC;
+    }
+
+    void Blake2Xb_Test()
+    {
+        PRNG prng(block(3425, 5734));
+        std::vector<u8> in(1000);
+        prng.get(in.data(), in.size());
+
+        // the output lengths cover partial and several batches of lanes.
+        for (u64 outLength : { 1, 20, 64, 65, 128, 255, 256, 257, 511, 512, 513, 1000, 4096 })
+        {
+            for (u64 inLength : { 0, 1, 128, 129, 1000 })
+            {
+                std::vector<u8> exp(outLength), out(outLength);
+                blake2xb(exp.data(), outLength, in.data(), inLength, nullptr, 0);
+
+                Blake2Xb hasher(outLength);
+                auto split = inLength / 3;
+                hasher.Update(in.data(), split);
+                hasher.Update(in.data() + split, inLength - split);
+                hasher.Final(out);
+
+                if (out != exp)
+                    throw RTE_LOC;
+            }
+        }
+
+        block x = prng.get();
+        std::array<block, 5> exp, out;
+        blake2xb(&exp, sizeof(exp), &x, sizeof(x), nullptr, 0);
+        Blake2Xb hasher(sizeof(out));
+        hasher.Update(x);
+        hasher.Final(out);
+        if (out != exp)
+            throw RTE_LOC;
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use. 
+
+namespace tests_cryptoTools
+{
+    void Blake2_Batch_Test();
+    void Blake2bp_Test();
+    void Blake2Xb_Test();
+}
@@ -12,11 +12,19 @@
 #include <cryptoTools/Network/Session.h>
 #include <cryptoTools/Network/IOService.h>
 #include <cryptoTools/Network/Channel.h>
+#include <cryptoTools/Network/Coroutine.h>
+#include <cryptoTools/Network/IoUringSocket.h>
+#include <cryptoTools/Network/Multiplexer.h>
+#include <cryptoTools/Network/NetEmuSocket.h>
+#include <cryptoTools/Network/ShmSocket.h>
+#include <cryptoTools/Network/StripedSocket.h>
+#include <cryptoTools/Network/ZeroCopySocket.h>
 
 #include <cryptoTools/Common/Log.h>
 #include <cryptoTools/Common/Timer.h>
 #include <cryptoTools/Common/BitVector.h>
 #include <cryptoTools/Common/Finally.h>
+#include <cryptoTools/Crypto/PRNG.h>
 
 
 #include "BtChannel_Tests.h"
@@ -24,8 +32,13 @@
 #include "Common.h"
 #include <cryptoTools/Common/TestCollection.h>
 #include <chrono>
+#include <fstream>
 #include <thread>
 #include "cryptoTools/Common/CLP.h"
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using namespace osuCrypto;
 
@@ -50,6 +63,45 @@ namespace tests_cryptoTools
         return ctx;
     }
 
+    namespace
+    {
+    // A connected pair of channels for the tests that do not depend on the
+    // transport. The channels are connected over the loopback by a pair of
+    // sessions or, with -shm, by a ShmSocket. mChl0 is the client.
+    struct ChannelPair
+    {
+        ChannelPair(IOService& ios, const CLP& cmd, const std::string& name = "TestChannel")
+        {
+#ifdef __linux__
+            if (cmd.isSet("shm"))
+            {
+                mChl1 = Channel(ios, new ShmSocket(name, SessionMode::Server));
+                mChl0 = Channel(ios, new ShmSocket(name, SessionMode::Client));
+                return;
+            }
+#endif
+            auto tls = getIfTLS(cmd);
+            mEp0.start(ios, "127.0.0.1", 1212, SessionMode::Client, tls, "endpoint");
+            mEp1.start(ios, "127.0.0.1", 1212, SessionMode::Server, tls, "endpoint");
+            mChl0 = mEp0.addChannel(name, name);
+            mChl1 = mEp1.addChannel(name, name);
+        }
+
+        // stops the sessions, if any.
+        void stop()
+        {
+            if (mEp0.mBase)
+            {
+                mEp0.stop();
+                mEp1.stop();
+            }
+        }
+
+        Session mEp0, mEp1;
+        Channel mChl0, mChl1;
+    };
+    }
+
 
     void BtNetwork_AnonymousMode_Test(const CLP& cmd)
     {
@@ -633,13 +685,13 @@ namespace tests_cryptoTools
         memset(oneMegabyte.data() + 100, 0xcc, 1000000 - 100);
 
         IOService ioService(0);
+        ChannelPair pair(ioService, cmd, channelName);
 
         auto thrd = std::thread([&]()
             {
                 setThreadName("Test_Client");
 
-                Session endpoint(ioService, "127.0.0.1", 1212, SessionMode::Client, tls, "endpoint");
-                Channel chl = endpoint.addChannel(channelName, channelName);
+                Channel chl = pair.mChl0;
 
                 std::vector<u8> srvRecv;
                 chl.recv(srvRecv);
@@ -662,8 +714,7 @@ namespace tests_cryptoTools
         Finally f([&] { thrd.join(); });
 
 
-        Session endpoint(ioService, "127.0.0.1", 1212, SessionMode::Server, tls, "endpoint");
-        auto chl = endpoint.addChannel(channelName, channelName);
+        auto chl = pair.mChl1;
 
 
         if (!tls && chl.getTotalDataSent() != 0)
@@ -999,20 +1050,16 @@ namespace tests_cryptoTools
     {
         setThreadName("Test_Host");
         std::string channelName{ "TestChannel" }, msg{ "This is the message" };
-        auto tls = getIfTLS(cmd);
         IOService ioService;
 
-        Session ep1(ioService, "127.0.0.1", 1212, SessionMode::Client, tls, "endpoint");
-        Session ep2(ioService, "127.0.0.1", 1212, SessionMode::Server, tls, "endpoint");
-
-        auto chl1 = ep1.addChannel(channelName, channelName);
-        auto chl2 = ep2.addChannel(channelName, channelName);
+        ChannelPair pair(ioService, cmd, channelName);
+        auto chl1 = pair.mChl0;
+        auto chl2 = pair.mChl1;
 
         Finally cleanup([&]() {
             chl1.close();
             chl2.close();
-            ep1.stop();
-            ep2.stop();
+            pair.stop();
             ioService.stop();
             });
 
@@ -1051,14 +1098,11 @@ namespace tests_cryptoTools
     {
         setThreadName("Test_Host");
         std::string channelName{ "TestChannel" }, msg{ "This is the message" };
-        auto tls = getIfTLS(cmd);
         IOService ioService;
 
-        Session ep1(ioService, "127.0.0.1", 1212, SessionMode::Client, tls, "endpoint");
-        Session ep2(ioService, "127.0.0.1", 1212, SessionMode::Server, tls, "endpoint");
-
-        auto chl1 = ep1.addChannel(channelName, channelName);
-        auto chl2 = ep2.addChannel(channelName, channelName);
+        ChannelPair pair(ioService, cmd, channelName);
+        auto chl1 = pair.mChl0;
+        auto chl2 = pair.mChl1;
 
 
         BitVector bb(77);
@@ -1084,22 +1128,18 @@ namespace tests_cryptoTools
 
         setThreadName("Test_Host");
         std::string channelName{ "TestChannel" }, msg{ "This is the message" };
-        auto tls = getIfTLS(cmd);
         IOService ioService;
 
         ioService.showErrorMessages(false);
 
-        Session ep1(ioService, "127.0.0.1", 1212, SessionMode::Client, tls, "endpoint");
-        Session ep2(ioService, "127.0.0.1", 1212, SessionMode::Server, tls, "endpoint");
-
-        auto chl1 = ep1.addChannel(channelName, channelName);
-        auto chl2 = ep2.addChannel(channelName, channelName);
+        ChannelPair pair(ioService, cmd, channelName);
+        auto chl1 = pair.mChl0;
+        auto chl2 = pair.mChl1;
 
         Finally cleanup([&]() {
             chl1.close();
             chl2.close();
-            ep1.stop();
-            ep2.stop();
+            pair.stop();
             ioService.stop();
             });
 
@@ -1706,6 +1746,1084 @@ namespace tests_cryptoTools
             thrds[tt].join();
     }
 
+    void BtNetwork_SendCoalescing_Test(const osuCrypto::CLP& cmd)
+    {
+        auto tls = getIfTLS(cmd);
+        IOService ioService;
+        u64 n = 1000, big = 100;
+        std::vector<u8> bigMsg(1 << 20, 0xcc);
+
+        Session server(ioService, "127.0.0.1", 1212, SessionMode::Server, tls);
+        auto chl = server.addChannel();
+
+        // the sends are queued before the socket is connected so that the
+        // send loop finds many operations to gather.
+        std::atomic<u64> callbacks(0);
+        std::future<void> fu;
+        for (u64 i = 0; i < n; ++i)
+        {
+            if (i == big)
+                chl.asyncSend(bigMsg);
+            else if (i == n - 1)
+                fu = chl.asyncSendFuture(&n, 1);
+            else if (i % 3 == 0)
+                chl.asyncSend(std::vector<u64>{ i, i + 1 }, [&]() { ++callbacks; });
+            else
+                chl.asyncSendCopy(i);
+        }
+
+        auto thrd = std::thread([&]() {
+            Session client(ioService, "127.0.0.1", 1212, SessionMode::Client, tls);
+            auto chl = client.addChannel();
+            for (u64 i = 0; i < n; ++i)
+            {
+                if (i == big)
+                {
+                    std::vector<u8> r;
+                    chl.recv(r);
+                    if (r != bigMsg)
+                        throw UnitTestFail(LOCATION);
+                }
+                else if (i % 3 == 0 && i != n - 1)
+                {
+                    std::vector<u64> r;
+                    chl.recv(r);
+                    if (r.size() != 2 || r[0] != i || r[1] != i + 1)
+                        throw UnitTestFail(LOCATION);
+                }
+                else
+                {
+                    u64 r;
+                    chl.recv(r);
+                    if (r != (i == n - 1 ? n : i))
+                        throw UnitTestFail(LOCATION);
+                }
+            }
+            chl.send(n);
+        });
+
+        u64 done;
+        chl.recv(done);
+        thrd.join();
+        fu.get();
+
+        // the callbacks are posted to the io service and may still be pending.
+        for (u64 i = 0; i < 1000 && callbacks != n / 3; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (chl.mBase->mTotalGatherWrites == 0)
+            throw UnitTestFail("sends were not gathered. " LOCATION);
+        if (!tls && chl.getTotalDataSent() != bigMsg.size() + n * sizeof(details::size_header_type) +
+            (n / 3) * 2 * sizeof(u64) + (n - n / 3 - 1) * sizeof(u64))
+            throw UnitTestFail("channel send statistics incorrect. " LOCATION);
+        if (callbacks != n / 3)
+            throw UnitTestFail(LOCATION);
+    }
+
+    void BtNetwork_RecvReadAhead_Test(const osuCrypto::CLP& cmd)
+    {
+        auto tls = getIfTLS(cmd);
+        IOService ioService;
+        u64 n = 1000, big = 500, aheadSize = 4096;
+
+        // small messages, ones between half and all of the read-ahead
+        // buffer and one that is much larger.
+        auto msgSize = [&](u64 i) { return i == big ? u64(1 << 20) : (i * 37) % 3000 + 1; };
+
+        ChannelPair pair(ioService, cmd);
+        auto chl = pair.mChl1;
+        chl.setRecvReadAhead(aheadSize);
+
+        auto thrd = std::thread([&]() {
+            auto chl = pair.mChl0;
+            for (u64 i = 0; i < n; ++i)
+                chl.asyncSend(std::vector<u8>(msgSize(i), u8(i)));
+            chl.send(n);
+        });
+        Finally f([&] { thrd.join(); });
+
+        u64 total = 0;
+        std::vector<u8> r;
+        for (u64 i = 0; i < n; ++i)
+        {
+            if (i & 1)
+            {
+                r.resize(msgSize(i));
+                chl.recv(r.data(), r.size());
+            }
+            else
+                chl.recv(r);
+
+            total += msgSize(i) + sizeof(details::size_header_type);
+            if (r.size() != msgSize(i) || r.front() != u8(i) || r.back() != u8(i))
+                throw UnitTestFail(LOCATION);
+        }
+
+        u64 done;
+        chl.recv(done);
+        total += sizeof(u64) + sizeof(details::size_header_type);
+
+        if (done != n)
+            throw UnitTestFail(LOCATION);
+        if (!tls && chl.getTotalDataRecv() != total)
+            throw UnitTestFail("channel recv statistics incorrect. " LOCATION);
+        if (chl.mBase->mTotalRecvAheadReads == 0 ||
+            chl.mBase->mTotalRecvAheadReads > total / aheadSize * 4 + n / 2)
+            throw UnitTestFail("too many socket reads. " LOCATION);
+    }
+
+    void BtNetwork_ExtendedHeader_Test(const osuCrypto::CLP& cmd)
+    {
+        // the buffer is never read, only its size is framed.
+        u64 size = (5ull << 30) + 3;
+        details::FixedSendBuff send((u8*)&size, size);
+        auto buffs = send.getSendBuffer();
+        if (buffs[0].size() != sizeof(details::size_header_type) + sizeof(u64) ||
+            buffs[1].size() != size ||
+            send.gatherSize() != buffs[0].size() + size)
+            throw UnitTestFail(LOCATION);
+
+        std::future<void> fu;
+        details::FixedRecvBuff recv(fu);
+        auto header = (u8*)buffs[0].data();
+        memcpy(recv.getRecvHeaderBuffer().data(), header, sizeof(details::size_header_type));
+        if (recv.isExtendedHeader() == false)
+            throw UnitTestFail(LOCATION);
+        memcpy(recv.getRecvExtendedHeaderBuffer().data(), header + sizeof(details::size_header_type), sizeof(u64));
+        if (recv.getHeaderSize() != size)
+            throw UnitTestFail(LOCATION);
+
+        // smaller messages keep the 4 byte header.
+        details::FixedSendBuff small((u8*)&size, sizeof(size));
+        if (small.getSendBuffer()[0].size() != sizeof(details::size_header_type))
+            throw UnitTestFail(LOCATION);
+
+        // a channel receives the extended framing of messages of any size,
+        // with and without read-ahead. The frames are written to a raw socket
+        // so that small messages can have the extended header.
+        IOService ioService;
+        PRNG prng(ZeroBlock);
+        for (u64 ahead : { 0, 1 << 12 })
+        {
+            boost::asio::ip::tcp::acceptor acceptor(ioService.mIoService,
+                boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+            boost::asio::ip::tcp::socket s0(ioService.mIoService), s1(ioService.mIoService);
+            s0.connect(acceptor.local_endpoint());
+            acceptor.accept(s1);
+            Channel chl(ioService, new BoostSocketInterface(std::move(s1)));
+            if (ahead)
+                chl.setRecvReadAhead(ahead);
+
+            for (u64 s : { 1, 999, 100000 })
+            {
+                std::vector<u8> m(s), frame;
+                prng.get(m.data(), m.size());
+                for (u64 i = 0; i < 2; ++i)
+                {
+                    auto pos = frame.size();
+                    frame.resize(pos + sizeof(details::size_header_type) + sizeof(u64) + s);
+                    memcpy(&frame[pos], &details::extendedSizeHeader, sizeof(details::size_header_type));
+                    memcpy(&frame[pos + sizeof(details::size_header_type)], &s, sizeof(u64));
+                    memcpy(&frame[pos + sizeof(details::size_header_type) + sizeof(u64)], m.data(), s);
+                }
+                std::thread thrd([&] { boost::asio::write(s0, boost::asio::buffer(frame)); });
+                Finally f([&] { thrd.join(); });
+
+                std::vector<u8> r;
+                chl.recv(r);
+                if (r != m)
+                    throw UnitTestFail(LOCATION);
+
+                // a fixed size buffer.
+                std::vector<u8> r2(s);
+                chl.recv(r2.data(), r2.size());
+                if (r2 != m)
+                    throw UnitTestFail(LOCATION);
+            }
+
+            // the received header bytes are counted.
+            u64 total = 2 * (sizeof(details::size_header_type) + sizeof(u64)) * 3 + 2 * (1 + 999 + 100000);
+            if (chl.getTotalDataRecv() != total)
+                throw UnitTestFail(LOCATION);
+            chl.close();
+        }
+    }
+
+    void BtNetwork_Stream_Test(const osuCrypto::CLP& cmd)
+    {
+        IOService ioService;
+        u64 size = 10000003, chunkSize = 1 << 20;
+        std::vector<u8> data(size);
+        PRNG prng(ZeroBlock);
+        prng.get(data.data(), data.size());
+
+        ChannelPair pair(ioService, cmd);
+        auto thrd = std::thread([&]() {
+            auto chl = pair.mChl0;
+            chl.sendStream(data.data(), data.size(), chunkSize);
+            auto fu = chl.asyncSendStream(data.data(), data.size());
+            chl.sendStream(data.data(), 0);
+            fu.get();
+        });
+        Finally f([&] { thrd.join(); });
+
+        auto chl = pair.mChl1;
+
+        // each chunk is consumed in order while the rest is in flight.
+        std::vector<u8> r(size);
+        u64 pos = 0;
+        chl.recvStream(r.data(), r.size(), [&](span<u8> chunk) {
+            if (chunk.data() != r.data() + pos ||
+                chunk.size() != std::min<u64>(chunkSize, size - pos) ||
+                memcmp(chunk.data(), data.data() + pos, chunk.size()))
+                throw UnitTestFail(LOCATION);
+            pos += chunk.size();
+        });
+        if (pos != size)
+            throw UnitTestFail(LOCATION);
+
+        std::vector<u8> r2;
+        chl.recvStream(r2);
+        if (r2 != data)
+            throw UnitTestFail(LOCATION);
+
+        chl.recvStream(r2);
+        if (r2.size())
+            throw UnitTestFail(LOCATION);
+    }
+
+    namespace
+    {
+    // gathered sends, exact receives, receives through the read-ahead
+    // buffer of c0 and a stream over a pair of channels that are connected
+    // by some SocketInterface.
+    void channelPairTest(Channel& c0, Channel& c1)
+    {
+        u64 n = 1000, big = 500;
+        auto msgSize = [&](u64 i) { return i == big ? u64(1 << 20) : (i * 37) % 3000 + 1; };
+
+        std::vector<u8> data(10000003);
+        PRNG prng(ZeroBlock);
+        prng.get(data.data(), data.size());
+
+        c0.setRecvReadAhead(1 << 14);
+
+        for (u64 i = 0; i < n; ++i)
+            c0.asyncSend(std::vector<u8>(msgSize(i), u8(i)));
+        std::vector<u8> r;
+        for (u64 i = 0; i < n; ++i)
+        {
+            c1.recv(r);
+            if (r.size() != msgSize(i) || r.front() != u8(i) || r.back() != u8(i))
+                throw UnitTestFail(LOCATION);
+        }
+
+        for (u64 i = 0; i < 100; ++i)
+        {
+            u64 j;
+            c1.send(i);
+            c0.recv(j);
+            if (j != i)
+                throw UnitTestFail(LOCATION);
+        }
+
+        auto fu = c1.asyncSendStream(data.data(), data.size(), 1 << 20);
+        c0.recvStream(r);
+        fu.get();
+        if (r != data)
+            throw UnitTestFail(LOCATION);
+    }
+    }
+
+    void BtNetwork_IoUring_Test(const osuCrypto::CLP& cmd)
+    {
+#ifdef ENABLE_IO_URING
+        if (IoUringSocket::isSupported() == false)
+            throw UnitTestSkipped("io_uring is not supported by the kernel.");
+
+        IOService ioService;
+        for (bool multishot : { false, true })
+        {
+            // before Linux 6.0 the sockets would fall back to recvmsg.
+            if (multishot && IoUringSocket::isMultishotRecvSupported() == false)
+                continue;
+
+            boost::asio::ip::tcp::acceptor acceptor(ioService.mIoService,
+                boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+            boost::asio::ip::tcp::socket s0(ioService.mIoService), s1(ioService.mIoService);
+            s0.connect(acceptor.local_endpoint());
+            acceptor.accept(s1);
+
+            // few small buffers so that the multishot receive runs out of
+            // them and is re-armed.
+            IoUringSocket::Options opt;
+            opt.mMultishotRecv = multishot;
+            opt.mBufferSize = 4096;
+            opt.mNumBuffers = 8;
+            Channel c0(ioService, new IoUringSocket(std::move(s0), opt));
+            Channel c1(ioService, new IoUringSocket(std::move(s1), opt));
+            channelPairTest(c0, c1);
+
+            // the handlers run on the threads of the IOService rather than
+            // on the ring thread, whether or not the data had arrived.
+            boost::asio::ip::tcp::socket s2(ioService.mIoService), s3(ioService.mIoService);
+            s2.connect(acceptor.local_endpoint());
+            acceptor.accept(s3);
+            IoUringSocket sock(std::move(s3), opt);
+            sock.setIOService(ioService);
+            auto onWorker = [&] {
+                for (auto& t : ioService.mWorkerThrds)
+                    if (t.first.get_id() == std::this_thread::get_id())
+                        return true;
+                return false;
+            };
+            for (u64 i = 0; i < 10; ++i)
+            {
+                std::promise<bool> prom;
+                u64 r = ~0ull;
+                boost::asio::mutable_buffer buff(&r, sizeof(r));
+                if (i & 1)
+                {
+                    boost::asio::write(s2, boost::asio::buffer(&i, sizeof(i)));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                sock.async_recv({ &buff, 1 }, [&](const error_code& ec, u64) {
+                    prom.set_value(!ec && onWorker());
+                });
+                if ((i & 1) == 0)
+                    boost::asio::write(s2, boost::asio::buffer(&i, sizeof(i)));
+                if (prom.get_future().get() == false || r != i)
+                    throw UnitTestFail(LOCATION);
+            }
+        }
+#else
+        throw UnitTestSkipped("ENABLE_IO_URING not defined.");
+#endif
+    }
+
+    void BtNetwork_Shm_Test(const osuCrypto::CLP& cmd)
+    {
+#ifdef __linux__
+        // a server whose process exits without a client leaves the name
+        // behind, which a new server replaces. This forks before the threads
+        // of the IOService exist.
+        auto pid = ::fork();
+        if (pid == 0)
+        {
+            new ShmSocket("BtNetwork_Shm_Test", SessionMode::Server);
+            ::_exit(0);
+        }
+        if (pid < 0 || ::waitpid(pid, nullptr, 0) != pid)
+            throw UnitTestFail(LOCATION);
+
+        IOService ioService;
+
+        // a small ring so that the large messages wrap around it.
+        ShmSocket::Options opt;
+        opt.mCapacity = 1 << 16;
+        {
+            Channel c0(ioService, new ShmSocket("BtNetwork_Shm_Test", SessionMode::Server, opt));
+            Channel c1(ioService, new ShmSocket("BtNetwork_Shm_Test", SessionMode::Client, opt));
+            channelPairTest(c0, c1);
+        }
+
+        {
+            // the operations of the client wait for the server and the name
+            // can be reused.
+            Channel c1(ioService, new ShmSocket("BtNetwork_Shm_Test", SessionMode::Client));
+            std::vector<u8> msg(1000, 3), r, r1;
+            auto fu = c1.asyncRecv(r1);
+            Channel c0(ioService, new ShmSocket("BtNetwork_Shm_Test", SessionMode::Server));
+
+            // a second server cannot take the name of a live one.
+            bool threw = false;
+            try
+            {
+                ShmSocket s("BtNetwork_Shm_Test", SessionMode::Server);
+            }
+            catch (std::runtime_error&)
+            {
+                threw = true;
+            }
+            if (threw == false)
+                throw UnitTestFail(LOCATION);
+
+            c0.send(msg);
+            fu.get();
+            c1.send(r1);
+            c0.recv(r);
+            if (r != msg)
+                throw UnitTestFail(LOCATION);
+        }
+
+        // without a server the client fails once mAttachTimeout has passed
+        // or it is closed.
+        for (bool close : { false, true })
+        {
+            ShmSocket::Options clientOpt;
+            clientOpt.mAttachTimeout = std::chrono::milliseconds(close ? 100000 : 10);
+            ShmSocket s("BtNetwork_Shm_Test_none", SessionMode::Client, clientOpt);
+            s.setIOService(ioService);
+
+            u64 v;
+            boost::asio::mutable_buffer buff(&v, sizeof(v));
+            std::promise<error_code> prom;
+            s.async_recv({ &buff, 1 }, [&](const error_code& ec, u64) { prom.set_value(ec); });
+            if (close)
+                s.close();
+
+            auto fu = prom.get_future();
+            if (fu.wait_for(std::chrono::seconds(10)) != std::future_status::ready ||
+                fu.get() != (close ? boost::asio::error::operation_aborted : boost::asio::error::timed_out))
+                throw UnitTestFail(LOCATION);
+        }
+
+        // the tests that do not depend on the transport.
+        CLP shm(cmd);
+        shm.set("shm");
+        BtNetwork_OneMegabyteSend_Test(shm);
+        BtNetwork_bitVector_Test(shm);
+        BtNetwork_std_Containers_Test(shm);
+        BtNetwork_recvErrorHandler_Test(shm);
+        BtNetwork_RecvReadAhead_Test(shm);
+        BtNetwork_Stream_Test(shm);
+#else
+        throw UnitTestSkipped("ShmSocket requires Linux.");
+#endif
+    }
+
+    void BtNetwork_UnixSocket_Test(const osuCrypto::CLP& cmd)
+    {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        IOService ioService;
+        std::string path = "BtNetwork_UnixSocket_Test.sock";
+        std::string address = "unix:" + path;
+
+        {
+            // the client connects before the server is listening.
+            Session client(ioService, address, SessionMode::Client, "name");
+            auto c1 = client.addChannel("c0", "c1");
+            auto d1 = client.addChannel("d");
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            Session server(ioService, address, SessionMode::Server, "name");
+            auto d0 = server.addChannel("d");
+            auto c0 = server.addChannel("c1", "c0");
+
+            channelPairTest(c0, c1);
+
+            std::string msg = "hello", r;
+            d1.send(msg);
+            d0.recv(r);
+            if (r != msg)
+                throw UnitTestFail(LOCATION);
+        }
+
+        // the server removed the socket file when it stopped.
+        boost::asio::local::stream_protocol::socket sock(ioService.mIoService);
+        boost::system::error_code ec;
+        sock.connect(boost::asio::local::stream_protocol::endpoint(path), ec);
+        if (ec != boost::system::errc::no_such_file_or_directory)
+            throw UnitTestFail(LOCATION);
+
+        // a file at the path that is not a socket is not replaced.
+        std::ofstream(path) << "data";
+        bool threw = false;
+        try
+        {
+            Session server(ioService, address, SessionMode::Server, "file");
+        }
+        catch (std::runtime_error&)
+        {
+            threw = true;
+        }
+        std::string contents;
+        std::ifstream(path) >> contents;
+        std::remove(path.c_str());
+        if (threw == false || contents != "data")
+            throw UnitTestFail(LOCATION);
+
+        // the socket of a live listener is not replaced, while that of one
+        // that has stopped is.
+        boost::asio::local::stream_protocol::endpoint ep(path);
+        {
+            boost::asio::local::stream_protocol::acceptor live(ioService.mIoService, ep);
+            threw = false;
+            try
+            {
+                Session server(ioService, address, SessionMode::Server, "live");
+            }
+            catch (std::runtime_error&)
+            {
+                threw = true;
+            }
+            boost::asio::local::stream_protocol::socket s(ioService.mIoService);
+            s.connect(ep, ec);
+            if (threw == false || ec)
+                throw UnitTestFail(LOCATION);
+        }
+        {
+            // the stopped acceptor leaves its socket file behind.
+            Session server(ioService, address, SessionMode::Server, "stale");
+            Session client(ioService, address, SessionMode::Client, "stale");
+            auto c0 = server.addChannel();
+            auto c1 = client.addChannel();
+            u64 v = 42;
+            c0.send(v);
+            c1.recv(v);
+            if (v != 42)
+                throw UnitTestFail(LOCATION);
+        }
+#else
+        throw UnitTestSkipped("unix domain sockets are not supported.");
+#endif
+    }
+
+    void BtNetwork_Multiplex_Test(const osuCrypto::CLP& cmd)
+    {
+        IOService ioService;
+        Session server(ioService, "127.0.0.1", 1212, SessionMode::Server, "mux");
+        Session client(ioService, "127.0.0.1", 1212, SessionMode::Client, "mux");
+
+        // a small window and frames so that the flow control is exercised.
+        MultiplexOptions opt;
+        opt.mNumSockets = 3;
+        opt.mWindowSize = 1 << 13;
+        opt.mFrameSize = 1 << 10;
+        server.multiplex(opt);
+        client.multiplex(opt);
+
+        // the client opens its streams in the reverse order.
+        u64 n = 8;
+        std::vector<Channel> c0(n), c1(n);
+        auto name = [](char c, u64 i) { return std::string(1, c) + std::to_string(i); };
+        for (u64 i = 0; i < n; ++i)
+        {
+            c0[i] = server.addChannel(name('c', i), name('s', i));
+            c1[n - 1 - i] = client.addChannel(name('s', n - 1 - i), name('c', n - 1 - i));
+        }
+
+        channelPairTest(c0[0], c1[0]);
+
+        // a stream that is not read does not block the others on its
+        // carrier. The server's streams c0[i] have the ids i + 1, so c0[1]
+        // and c0[4] send on the same carrier, i.e. (i + 1) % 3 = 2.
+        std::vector<u8> big(1 << 20, 5), r;
+        c0[1].asyncSend(big);
+        for (u64 i = 0; i < 10; ++i)
+        {
+            c0[4].send(i);
+            c1[4].recv(r);
+            c1[4].send(r);
+            c0[4].recv(r);
+        }
+        c1[1].recv(r);
+        if (r != big)
+            throw UnitTestFail(LOCATION);
+
+        // all of the streams at once.
+        std::vector<std::thread> thrds;
+        std::vector<std::exception_ptr> errors(n);
+        for (u64 i = 0; i < n; ++i)
+        {
+            thrds.emplace_back([&, i] {
+                try
+                {
+                    for (u64 j = 0; j < 100; ++j)
+                    {
+                        std::vector<u8> m((i * 1000 + j * 77) % 20000 + 1, u8(i + j)), r;
+                        // the messages are larger than the window so the sends
+                        // only complete once the peer receives.
+                        c0[i].asyncSend(m);
+                        c1[i].recv(r);
+                        c1[i].asyncSend(std::move(r));
+                        c0[i].recv(r);
+                        if (r != m)
+                            throw UnitTestFail(LOCATION);
+                    }
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& t : thrds)
+            t.join();
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+
+        // the peer receives eof once a stream is closed.
+        c0[3].close();
+        std::vector<u8> tmp;
+        bool threw = false;
+        try
+        {
+            c1[3].recv(tmp);
+        }
+        catch (std::runtime_error&)
+        {
+            threw = true;
+        }
+        if (threw == false)
+            throw UnitTestFail(LOCATION);
+
+        for (u64 i = 0; i < n; ++i)
+        {
+            c0[i].close();
+            c1[i].close();
+        }
+    }
+
+    void BtNetwork_SocketOptions_Test(const osuCrypto::CLP& cmd)
+    {
+        IOService ioService;
+        Session server(ioService, "127.0.0.1", 1214, SessionMode::Server, "opt");
+        Session client(ioService, "127.0.0.1", 1214, SessionMode::Client, "opt");
+
+        SocketOptions opt;
+        opt.mSendBufferSize = 1 << 16;
+        opt.mRecvBufferSize = 1 << 16;
+        opt.mQuickAck = true;
+        opt.mZeroCopy = true;
+        opt.mZeroCopyThreshold = 1 << 12;
+        server.setSocketOptions(opt);
+        client.setSocketOptions(opt);
+
+        auto c0 = server.addChannel("c");
+        auto c1 = client.addChannel("c");
+        channelPairTest(c0, c1);
+
+#ifdef __linux__
+        for (auto chl : { c0, c1 })
+        {
+            auto zc = dynamic_cast<ZeroCopySocket*>(chl.mBase->mHandle.get());
+            if (zc == nullptr)
+                throw UnitTestFail(LOCATION);
+
+            boost::asio::socket_base::send_buffer_size size;
+            zc->mSock.get_option(size);
+            if (size.value() < int(opt.mSendBufferSize))
+                throw UnitTestFail(LOCATION);
+        }
+        auto zc = dynamic_cast<ZeroCopySocket*>(c1.mBase->mHandle.get());
+        if (zc->zeroCopySends() == 0)
+            throw UnitTestFail(LOCATION);
+
+        // the accepted sockets inherit the receive buffer of the listening
+        // socket, which is set before they are connected.
+        boost::asio::socket_base::receive_buffer_size recvSize;
+        server.mBase->mAcceptor->mHandle.get_option(recvSize);
+        if (recvSize.value() < int(opt.mRecvBufferSize))
+            throw UnitTestFail(LOCATION);
+#endif
+
+        // an odd stripe size so that the messages straddle the stripes.
+        Session server2(ioService, "127.0.0.1", 1214, SessionMode::Server, "stripe");
+        Session client2(ioService, "127.0.0.1", 1214, SessionMode::Client, "stripe");
+        opt.mStripes = 3;
+        opt.mStripeSize = 1001;
+        server2.setSocketOptions(opt);
+        client2.setSocketOptions(opt);
+
+        auto s0 = server2.addChannel("s");
+        auto s1 = client2.addChannel("s");
+        if (dynamic_cast<StripedSocket*>(s0.mBase->mHandle.get()) == nullptr)
+            throw UnitTestFail(LOCATION);
+        channelPairTest(s0, s1);
+
+        // the peer receives eof once the channel is closed.
+        s0.close();
+        std::vector<u8> tmp;
+        bool threw = false;
+        try
+        {
+            s1.recv(tmp);
+        }
+        catch (std::runtime_error&)
+        {
+            threw = true;
+        }
+        if (threw == false)
+            throw UnitTestFail(LOCATION);
+        s1.close();
+
+        // a send that is started before the stripes connect does not keep
+        // the caller's span of buffers.
+        std::vector<Channel> x0Chls, x1Chls;
+        for (u64 i = 0; i < 2; ++i)
+            x0Chls.push_back(server2.addChannel("x" + std::to_string(i)));
+        StripedSocket x0(std::move(x0Chls), 7);
+        std::vector<u8> data(100), dest(100);
+        for (u64 i = 0; i < data.size(); ++i)
+            data[i] = u8(i);
+        std::promise<error_code> sent, recvd;
+        {
+            std::vector<boost::asio::mutable_buffer> buffers{
+                { data.data(), 50 }, { data.data() + 50, 50 } };
+            x0.async_send({ buffers.data(), buffers.size() },
+                [&](const error_code& ec, u64) { sent.set_value(ec); });
+            buffers.assign(2, boost::asio::mutable_buffer(nullptr, 0));
+        }
+
+        for (u64 i = 0; i < 2; ++i)
+            x1Chls.push_back(client2.addChannel("x" + std::to_string(i)));
+        StripedSocket x1(std::move(x1Chls), 7);
+        boost::asio::mutable_buffer destBuff(dest.data(), dest.size());
+        x1.async_recv({ &destBuff, 1 },
+            [&](const error_code& ec, u64) { recvd.set_value(ec); });
+
+        auto sf = sent.get_future(), rf = recvd.get_future();
+        if (rf.wait_for(std::chrono::seconds(10)) != std::future_status::ready)
+            throw UnitTestFail(LOCATION);
+        if (sf.get() || rf.get() || dest != data)
+            throw UnitTestFail(LOCATION);
+    }
+
+    void BtNetwork_NetEmu_Test(const osuCrypto::CLP& cmd)
+    {
+        IOService ioService;
+        auto connect = [&](NetEmuOptions opt) {
+            boost::asio::ip::tcp::acceptor acceptor(ioService.mIoService,
+                boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+            boost::asio::ip::tcp::socket s0(ioService.mIoService), s1(ioService.mIoService);
+            s0.connect(acceptor.local_endpoint());
+            acceptor.accept(s1);
+            return std::make_pair(
+                Channel(ioService, new NetEmuSocket(new BoostSocketInterface(std::move(s0)), opt)),
+                Channel(ioService, new NetEmuSocket(new BoostSocketInterface(std::move(s1)), opt)));
+        };
+        auto emu = [](Channel& chl) { return dynamic_cast<NetEmuSocket*>(chl.mBase->mHandle.get()); };
+        using namespace std::chrono;
+
+        {
+            // the jitter does not reorder the data.
+            NetEmuOptions opt;
+            opt.mLatency = microseconds(100);
+            opt.mJitter = microseconds(300);
+            auto chls = connect(opt);
+            channelPairTest(chls.first, chls.second);
+        }
+
+        NetEmuOptions opt;
+        opt.mLatency = milliseconds(5);
+        opt.mBandwidth = 10000000;
+        auto chls = connect(opt);
+        auto& c0 = chls.first;
+        auto& c1 = chls.second;
+
+        // each round trip takes twice the latency.
+        u64 rounds = 10, v = 0;
+        auto t0 = steady_clock::now();
+        for (u64 i = 0; i < rounds; ++i)
+        {
+            c0.send(v);
+            c1.recv(v);
+            c1.send(v);
+            c0.recv(v);
+        }
+        auto t1 = steady_clock::now();
+        if (t1 - t0 < rounds * 2 * opt.mLatency)
+            throw UnitTestFail(LOCATION);
+        if (emu(c0)->rounds() != rounds || emu(c1)->rounds() != rounds)
+            throw UnitTestFail(LOCATION);
+
+        // a large message takes its size over the bandwidth, headers included.
+        std::vector<u8> big(1 << 20), r;
+        auto wire0 = emu(c0)->wireBytes();
+        t0 = steady_clock::now();
+        c0.asyncSend(big);
+        c1.recv(r);
+        t1 = steady_clock::now();
+
+        auto size = big.size() + sizeof(details::size_header_type);
+        auto packets = (size + opt.mPacketSize - 1) / opt.mPacketSize;
+        auto wire = size + packets * opt.mPacketOverhead;
+        if (emu(c0)->wireBytes() - wire0 != wire)
+            throw UnitTestFail(LOCATION);
+        if (t1 - t0 < opt.mLatency + microseconds(wire * 1000000 / opt.mBandwidth))
+            throw UnitTestFail(LOCATION);
+        if (emu(c0)->rounds() != rounds + 1)
+            throw UnitTestFail(LOCATION);
+
+        // the data on the link is delivered before the socket is closed.
+        c0.send(big);
+        c0.close();
+        c1.recv(r);
+        if (r != big)
+            throw UnitTestFail(LOCATION);
+        c1.close();
+
+        // a wrapped socket whose sends complete inline.
+        struct InlineSocket : public SocketInterface
+        {
+            std::mutex mMtx;
+            std::vector<u8> mData;
+            std::promise<void> mClosed;
+
+            void async_send(span<boost::asio::mutable_buffer> buffers, io_completion_handle&& fn) override
+            {
+                u64 n = 0;
+                {
+                    std::lock_guard<std::mutex> lock(mMtx);
+                    for (auto& b : buffers)
+                    {
+                        auto d = static_cast<u8*>(b.data());
+                        mData.insert(mData.end(), d, d + b.size());
+                        n += b.size();
+                    }
+                }
+                fn({}, n);
+            }
+
+            void async_recv(span<boost::asio::mutable_buffer>, io_completion_handle&& fn) override
+            {
+                fn(boost::asio::error::operation_not_supported, 0);
+            }
+
+            void close() override { mClosed.set_value(); }
+
+            void cancel() override {}
+        };
+
+        for (bool cancel : { false, true })
+        {
+            // after a cancel, the data on the link is dropped but the
+            // wrapped socket is still closed.
+            NetEmuOptions inlineOpt;
+            inlineOpt.mLatency = cancel ? seconds(100) : microseconds(100);
+            auto in = new InlineSocket;
+            auto closed = in->mClosed.get_future();
+            NetEmuSocket sock(in, inlineOpt);
+            sock.setIOService(ioService);
+
+            std::vector<u8> m(5000, 7);
+            for (u64 i = 0; i < 2; ++i)
+            {
+                std::promise<error_code> prom;
+                boost::asio::mutable_buffer buff(m.data(), m.size());
+                sock.async_send({ &buff, 1 }, [&](const error_code& ec, u64) { prom.set_value(ec); });
+                if (prom.get_future().get())
+                    throw UnitTestFail(LOCATION);
+            }
+            if (cancel)
+                sock.cancel();
+            sock.close();
+
+            if (closed.wait_for(seconds(10)) != std::future_status::ready)
+                throw UnitTestFail(LOCATION);
+            std::lock_guard<std::mutex> lock(in->mMtx);
+            if (in->mData.size() != (cancel ? 0 : 2 * m.size()))
+                throw UnitTestFail(LOCATION);
+        }
+    }
+
+    void BtNetwork_Telemetry_Test(const osuCrypto::CLP& cmd)
+    {
+        IOService ioService;
+        Session server(ioService, "127.0.0.1", 1215, SessionMode::Server);
+        Session client(ioService, "127.0.0.1", 1215, SessionMode::Client);
+        auto c0 = server.addChannel();
+        auto c1 = client.addChannel();
+        if (c0.getTelemetry())
+            throw UnitTestFail(LOCATION);
+
+        ChannelTelemetryOptions opt;
+        opt.mMaxMessages = 4;
+        c0.enableTelemetry(opt);
+        c1.enableTelemetry(opt);
+
+        // three rounds, c0 sends 3 messages, then c1 sends 2 and c0 one.
+        std::vector<u8> m(1000), r;
+        for (u64 i = 0; i < 3; ++i)
+        {
+            c0.asyncSend(m);
+            c1.recv(r);
+        }
+        for (u64 i = 0; i < 2; ++i)
+        {
+            c1.send(m);
+            c0.recv(r);
+        }
+        c0.send(m);
+        c1.recv(r);
+
+        // a message is recorded just after it completes, so wait for the
+        // channels to be idle.
+        c0.close();
+        c1.close();
+
+        auto t0 = c0.getTelemetry();
+        auto t1 = c1.getTelemetry();
+        if (t0->rounds() != 3 || t1->rounds() != 3)
+            throw UnitTestFail(LOCATION);
+
+        // the header of each message is counted as well.
+        auto size = m.size() + sizeof(details::size_header_type);
+        auto send = t0->direction(true);
+        auto recv = t0->direction(false);
+        if (send.mMessages != 4 || send.mBytes != 4 * size ||
+            recv.mMessages != 2 || recv.mBytes != 2 * size)
+            throw UnitTestFail(LOCATION);
+
+        u64 timeline = 0, hist = 0;
+        for (auto b : send.mTimeline)
+            timeline += b;
+        for (auto h : send.mWire)
+            hist += h;
+        if (timeline != send.mBytes || hist != send.mMessages)
+            throw UnitTestFail(LOCATION);
+
+        auto msgs = t0->messages();
+        if (msgs.size() != opt.mMaxMessages)
+            throw UnitTestFail(LOCATION);
+        for (auto& msg : msgs)
+            if (msg.mSize != size || msg.mQueued > msg.mStarted || msg.mStarted > msg.mCompleted)
+                throw UnitTestFail(LOCATION);
+        if (msgs[2].mSend == false || msgs[3].mSend == true)
+            throw UnitTestFail(LOCATION);
+
+        auto json = t0->toJson();
+        if (json.find("\"rounds\":3") == std::string::npos)
+            throw UnitTestFail(LOCATION);
+        auto trace = t0->toChromeTrace("c0");
+        if (trace.find("{\"traceEvents\":[") != 0 || trace.find("\"name\":\"recv 1004\"") == std::string::npos)
+            throw UnitTestFail(LOCATION);
+
+        // the name is escaped.
+        trace = t0->toChromeTrace("a\"b\\c\n");
+        if (trace.find("\"name\":\"a\\\"b\\\\c\\u000a\"") == std::string::npos)
+            throw UnitTestFail(LOCATION);
+
+        // the timeline is merged into at most mMaxBuckets buckets.
+        ChannelTelemetryOptions small;
+        small.mBucket = std::chrono::microseconds(1);
+        small.mMaxBuckets = 8;
+        ChannelTelemetry t2(small);
+        for (u64 i = 0; i < 4; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            auto now = ChannelTelemetry::Clock::now();
+            t2.completed(i & 1, 100, now, now);
+        }
+        auto s2 = t2.direction(true), r2 = t2.direction(false);
+        timeline = 0;
+        for (auto b : s2.mTimeline)
+            timeline += b;
+        for (auto b : r2.mTimeline)
+            timeline += b;
+        if (s2.mTimeline.size() > small.mMaxBuckets ||
+            r2.mTimeline.size() > small.mMaxBuckets ||
+            timeline != 400 ||
+            t2.bucketWidth() < std::chrono::milliseconds(3) / small.mMaxBuckets)
+            throw UnitTestFail(LOCATION);
+    }
+
+#ifdef __cpp_impl_coroutine
+    namespace
+    {
+        Task<u64> coAdd(Channel& chl, u64 v)
+        {
+            co_await coSend(chl, v);
+            co_await coRecv(chl, v);
+            co_return v;
+        }
+
+        // sends messages of growing sizes and checks that they are echoed.
+        Task<u64> coClient(Channel& chl, u64 idx, u64 rounds)
+        {
+            u64 sum = 0;
+            std::vector<u8> m, r;
+            for (u64 j = 0; j < rounds; ++j)
+            {
+                m.assign((idx * 31 + j * 7) % 300 + 1, u8(idx + j));
+                co_await coSend(chl, m);
+                co_await coRecv(chl, r);
+                if (r != m)
+                    throw UnitTestFail(LOCATION);
+
+                sum += co_await coAdd(chl, j);
+            }
+            co_return sum;
+        }
+
+        Task<> coServer(Channel& chl, u64 rounds)
+        {
+            std::vector<u8> m;
+            for (u64 j = 0; j < rounds; ++j)
+            {
+                co_await coRecv(chl, m);
+                co_await coSend(chl, m);
+
+                u64 v;
+                co_await coRecv(chl, v);
+                v += 1;
+                co_await coSend(chl, v);
+            }
+        }
+
+        Task<> coBadRecv(Channel& chl)
+        {
+            std::array<u8, 4> small;
+            co_await coRecv(chl, small);
+        }
+    }
+
+    void BtNetwork_Coroutine_Test(const osuCrypto::CLP& cmd)
+    {
+        // many protocols on a pair of sockets and the two threads of the
+        // IOService.
+        IOService ioService(2);
+        Session server(ioService, "127.0.0.1", 1216, SessionMode::Server, "co");
+        Session client(ioService, "127.0.0.1", 1216, SessionMode::Client, "co");
+        MultiplexOptions opt;
+        opt.mNumSockets = 2;
+        server.multiplex(opt);
+        client.multiplex(opt);
+
+        u64 n = cmd.getOr("n", 500), rounds = 10;
+        std::vector<Channel> c0(n), c1(n);
+        for (u64 i = 0; i < n; ++i)
+        {
+            auto name = std::to_string(i);
+            c0[i] = server.addChannel(name, name);
+            c1[i] = client.addChannel(name, name);
+        }
+
+        std::vector<std::future<u64>> f0(n);
+        std::vector<std::future<void>> f1(n);
+        for (u64 i = 0; i < n; ++i)
+        {
+            f0[i] = spawn(ioService, coClient(c0[i], i, rounds));
+            f1[i] = spawn(ioService, coServer(c1[i], rounds));
+        }
+
+        for (u64 i = 0; i < n; ++i)
+        {
+            f1[i].get();
+            if (f0[i].get() != rounds * (rounds + 1) / 2)
+                throw UnitTestFail(LOCATION);
+        }
+
+        // the errors of the operations are thrown by co_await.
+        std::array<u8, 8> big{};
+        c0[0].asyncSend(big);
+        auto bad = spawn(ioService, coBadRecv(c1[0]));
+        try
+        {
+            bad.get();
+            throw UnitTestFail(LOCATION);
+        }
+        catch (BadReceiveBufferSize&) {}
+    }
+#else
+    void BtNetwork_Coroutine_Test(const osuCrypto::CLP& cmd)
+    {
+        throw UnitTestSkipped("coroutines require C++20.");
+    }
+#endif
+
     void BtNetwork_socketAdapter_test(const osuCrypto::CLP& cmd)
     {
         struct SmallBuff
@@ -50,6 +50,18 @@ namespace tests_cryptoTools
 
     void SBO_ptr_test();
     void BtNetwork_queue_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_SendCoalescing_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_RecvReadAhead_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_ExtendedHeader_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_Stream_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_IoUring_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_Shm_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_UnixSocket_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_Multiplex_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_SocketOptions_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_NetEmu_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_Telemetry_Test(const osuCrypto::CLP& cmd);
+    void BtNetwork_Coroutine_Test(const osuCrypto::CLP& cmd);
 #else
     inline void np() { throw oc::UnitTestSkipped("ENABLE_BOOST not defined."); }
     inline void BtNetwork_Connect1_Test(const osuCrypto::CLP& cmd) { np(); }
@@ -76,6 +88,18 @@ namespace tests_cryptoTools
     inline void BtNetwork_fastCancel(const osuCrypto::CLP& cmd) { np(); }
     inline void SBO_ptr_test() { np(); }
     inline void BtNetwork_queue_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_SendCoalescing_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_RecvReadAhead_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_ExtendedHeader_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_Stream_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_IoUring_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_Shm_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_UnixSocket_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_Multiplex_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_SocketOptions_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_NetEmu_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_Telemetry_Test(const osuCrypto::CLP& cmd) { np(); }
+    inline void BtNetwork_Coroutine_Test(const osuCrypto::CLP& cmd) { np(); }
     inline void BtNetwork_socketAdapter_test(const osuCrypto::CLP& cmd) { np(); }
     inline void BtNetwork_BasicSocket_test(const osuCrypto::CLP& cmd) { np(); };
     
@@ -0,0 +1,86 @@
+#include "Commit_Tests.h"
+
+#include <cryptoTools/Crypto/Commit.h>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+    void CommitBatch_Test()
+    {
+        PRNG prng(block(8734, 2342));
+
+        // the counts cover partial and several chunks.
+        for (u64 n : { 0, 1, 7, 256, 300 })
+        {
+            std::vector<block> values(n), rand(n);
+            std::vector<Commit> comms(n);
+            prng.get(values.data(), values.size());
+
+            CommitBatch::commit(span<const block>(values), prng, rand, comms);
+            for (u64 i = 0; i < n; ++i)
+                if (comms[i] != Commit(values[i], rand[i]))
+                    throw RTE_LOC;
+
+            if (!CommitBatch::verify(span<const block>(values), rand, comms))
+                throw RTE_LOC;
+
+            if (n)
+            {
+                rand[n - 1] = rand[n - 1] ^ OneBlock;
+                if (CommitBatch::verify(span<const block>(values), rand, comms))
+                    throw RTE_LOC;
+            }
+        }
+
+        // values of other sizes.
+        std::vector<u8> bytes(33 * 10);
+        std::vector<block> rand(10);
+        std::vector<Commit> comms(10);
+        prng.get(bytes.data(), bytes.size());
+        CommitBatch::commit(bytes.data(), 33, prng, rand, comms);
+        for (u64 i = 0; i < 10; ++i)
+            if (comms[i] != Commit(span<u8>(bytes.data() + i * 33, 33), rand[i]))
+                throw RTE_LOC;
+    }
+
+    void MerkleCommit_Test()
+    {
+        PRNG prng(block(2342, 8734));
+
+        for (u64 n : { 1, 2, 3, 5, 8, 13, 300 })
+        {
+            std::vector<u64> values(n);
+            std::vector<block> rand(n);
+            prng.get(values.data(), values.size());
+
+            MerkleCommit tree;
+            tree.commit(span<const u64>(values), prng, rand);
+            auto root = tree.root();
+
+            if (!MerkleCommit::verify(span<const u64>(values), rand, root))
+                throw RTE_LOC;
+
+            for (u64 i = 0; i < n; ++i)
+            {
+                auto proof = tree.proof(i);
+                if (!MerkleCommit::verifyProof(values[i], rand[i], i, n, proof, root))
+                    throw RTE_LOC;
+
+                // the wrong value, index or path is rejected.
+                if (MerkleCommit::verifyProof(values[i] ^ 1, rand[i], i, n, proof, root))
+                    throw RTE_LOC;
+                if (n > 1 && MerkleCommit::verifyProof(values[i], rand[i], i ^ 1, n, proof, root))
+                    throw RTE_LOC;
+                if (proof.size() &&
+                    MerkleCommit::verifyProof(values[i], rand[i], i, n, span<const Commit>(proof).subspan(1), root))
+                    throw RTE_LOC;
+            }
+
+            values[n / 2] ^= 1;
+            if (MerkleCommit::verify(span<const u64>(values), rand, root))
+                throw RTE_LOC;
+        }
+    }
+}
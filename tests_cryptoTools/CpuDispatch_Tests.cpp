@@ -0,0 +1,175 @@
+#include "CpuDispatch_Tests.h"
+
+#include <cryptoTools/Common/CpuDispatch.h>
+#include <cryptoTools/Common/Finally.h>
+#include <cryptoTools/Common/TestCollection.h>
+#include <cryptoTools/Crypto/AES.h>
+#include <cryptoTools/Crypto/Blake2.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+#ifdef OC_ENABLE_CPU_DISPATCH
+    namespace
+    {
+        // compare the kernels against the compiled in AES, called directly
+        // so that they are tested even if they are not selected.
+        void checkAes(const details::AesKernels& kernels)
+        {
+            AES aes(block(2342134234, 213421341234));
+            for (u64 length = 0; length < 100; ++length)
+            {
+                std::vector<block> data(length), c0(length), c1(length);
+                for (u64 i = 0; i < length; ++i)
+                    data[i] = block(length, 3423 * i);
+
+                for (u64 i = 0; i < length; ++i)
+                    c0[i] = aes.ecbEncBlock(data[i]);
+                kernels.mEcbEncBlocks(aes.mRoundKey.data(), data.data(), length, c1.data());
+                if (c0 != c1)
+                    throw RTE_LOC;
+
+                for (u64 i = 0; i < length; ++i)
+                    c0[i] = aes.ecbEncBlock(data[i]) ^ data[i];
+                kernels.mHashBlocks(aes.mRoundKey.data(), data.data(), length, c1.data());
+                if (c0 != c1)
+                    throw RTE_LOC;
+
+                block base(length, ~0ull - 20);
+                for (u64 i = 0; i < length; ++i)
+                    c0[i] = aes.ecbEncBlock(base.add_epi64(block(i)));
+                kernels.mEcbEncCounterMode(aes.mRoundKey.data(), base, length, c1.data());
+                if (c0 != c1)
+                    throw RTE_LOC;
+            }
+        }
+
+        void checkGf128Bulk(const details::Gf128Kernels& kernels)
+        {
+            PRNG prng(block(5, 6));
+            for (u64 n = 0; n < 40; ++n)
+            {
+                std::vector<block> x(n), y(n), z(n);
+                prng.get(x.data(), n);
+                prng.get(y.data(), n);
+                auto s = prng.get<block>();
+
+                kernels.mMulBlocks(x.data(), y.data(), n, z.data());
+                for (u64 i = 0; i < n; ++i)
+                    if (z[i] != x[i].gf128Mul(y[i]))
+                        throw RTE_LOC;
+
+                kernels.mMulScalar(x.data(), s, n, z.data());
+                for (u64 i = 0; i < n; ++i)
+                    if (z[i] != x[i].gf128Mul(s))
+                        throw RTE_LOC;
+
+                block ip = ZeroBlock, xy1, xy2;
+                for (u64 i = 0; i < n; ++i)
+                    ip = ip ^ x[i].gf128Mul(y[i]);
+                kernels.mInnerProduct(x.data(), y.data(), n, xy1, xy2);
+                if (xy1.gf128Reduce(xy2) != ip)
+                    throw RTE_LOC;
+            }
+        }
+
+        void checkGf128(const details::Gf128Kernels& kernels)
+        {
+            PRNG prng(block(3, 4));
+            for (u64 i = 0; i < 100; ++i)
+            {
+                auto x = prng.get<block>();
+                auto y = prng.get<block>();
+
+                block xy1, xy2, r;
+                kernels.mMul(x, y, xy1, xy2);
+                kernels.mReduce(xy1, xy2, r);
+                if (r != x.gf128Mul(y))
+                    throw RTE_LOC;
+
+                if (r != xy1.cc_gf128Reduce(xy2))
+                    throw RTE_LOC;
+            }
+
+            checkGf128Bulk(kernels);
+        }
+
+        std::vector<block> blake2Hashes()
+        {
+            std::vector<u8> data(1000);
+            for (u64 i = 0; i < data.size(); ++i)
+                data[i] = u8(i * 31);
+
+            std::vector<block> hashes;
+            for (u64 length : { 0, 1, 127, 128, 129, 256, 1000 })
+            {
+                Blake2 hasher(sizeof(block));
+                hasher.Update(data.data(), length);
+                hashes.emplace_back();
+                hasher.Final(hashes.back());
+            }
+            return hashes;
+        }
+
+        void checkBlake2b(const details::Blake2bKernels& kernels)
+        {
+            auto expected = blake2Hashes();
+
+            auto old = details::gCpuKernels.mBlake2b;
+            Finally restore([&] { details::gCpuKernels.mBlake2b = old; });
+            details::gCpuKernels.mBlake2b = kernels;
+
+            if (blake2Hashes() != expected)
+                throw RTE_LOC;
+        }
+    }
+#endif
+
+    void CpuDispatch_Test()
+    {
+#ifdef OC_ENABLE_CPU_DISPATCH
+        auto& f = getCpuFeatures();
+        bool tested = false;
+
+        // the features of the build machine are a lower bound.
+#ifdef OC_ENABLE_AESNI
+        if (!f.mAESNI || !f.mSSE2)
+            throw RTE_LOC;
+#endif
+
+        // a cpu without any extensions should not select any kernels.
+        auto none = details::selectCpuKernels(CpuFeatures{});
+        if (none.mAes.mEcbEncBlocks || none.mGf128.mMul || none.mBlake2b.mCompress)
+            throw RTE_LOC;
+
+        auto westmere = f.mAESNI && f.mPCLMUL && f.mSSE41 && f.mSSSE3;
+        if (westmere && details::getAesniAesKernels())
+        {
+            checkAes(*details::getAesniAesKernels());
+            checkGf128(*details::getPclmulGf128Kernels());
+            checkBlake2b(*details::getSse41Blake2bKernels());
+            tested = true;
+        }
+
+        if (westmere && f.mAVX512F && f.mVAES && details::getVaesAesKernels())
+        {
+            checkAes(*details::getVaesAesKernels());
+            tested = true;
+        }
+
+        if (westmere && f.mAVX512F && f.mVPCLMULQDQ && details::getVpclmulGf128Kernels())
+        {
+            checkGf128Bulk(*details::getVpclmulGf128Kernels());
+            tested = true;
+        }
+
+        if (!tested)
+            throw UnitTestSkipped("no dispatch kernels are supported by this cpu");
+#else
+        throw UnitTestSkipped("ENABLE_CPU_DISPATCH is not defined");
+#endif
+    }
+}
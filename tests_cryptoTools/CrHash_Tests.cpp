@@ -0,0 +1,84 @@
+#include "CrHash_Tests.h"
+
+#include <cryptoTools/Crypto/CrHash.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+    void CrHash_Test()
+    {
+        PRNG prng(block(4352, 2534));
+        auto& cr = CrHash::fixedKey();
+        auto& tccr = TccrHash::fixedKey();
+
+        // the sizes cover partial and several chunks.
+        for (u64 n : { 0, 1, 5, 64, 65, 200 })
+        {
+            std::vector<block> x(n);
+            std::vector<u64> tweaks(n);
+            prng.get(x.data(), x.size());
+            prng.get(tweaks.data(), tweaks.size());
+
+            for (u64 k = 1; k <= CrHash::MaxOutputBlocks; ++k)
+            {
+                std::vector<block> y(n * k), c(n * k), t(n * k), tb(n * k);
+                cr.crHash(x, y);
+                cr.ccrHash(x, c);
+                tccr.hash(x, tweaks, t);
+                tccr.hash(x, 33, tb);
+
+                for (u64 i = 0; i < n; ++i)
+                {
+                    auto sx = CrHash::sigma(x[i]);
+                    auto pix = mAesFixedKey.ecbEncBlock(x[i]);
+                    for (u64 j = 0; j < k; ++j)
+                    {
+                        auto cj = block(j, 0);
+                        if (y[i * k + j] != mAesFixedKey.hashBlock(x[i] ^ cj))
+                            throw RTE_LOC;
+                        if (c[i * k + j] != mAesFixedKey.hashBlock(sx ^ cj))
+                            throw RTE_LOC;
+                        if (t[i * k + j] != (mAesFixedKey.ecbEncBlock(pix ^ block(j, tweaks[i])) ^ pix))
+                            throw RTE_LOC;
+                        if (tb[i * k + j] != (mAesFixedKey.ecbEncBlock(pix ^ block(j, 33 + i)) ^ pix))
+                            throw RTE_LOC;
+                    }
+
+                    if (k == 1)
+                    {
+                        if (y[i] != cr.crHash(x[i]) || c[i] != cr.ccrHash(x[i]))
+                            throw RTE_LOC;
+                        if (t[i] != tccr.hash(x[i], tweaks[i]) ||
+                            t[i] != mAesFixedKey.TmmoHashBlock(x[i], toBlock(tweaks[i])))
+                            throw RTE_LOC;
+                    }
+                }
+            }
+        }
+
+        // sigma(a || b) = (a ^ b) || a.
+        if (CrHash::sigma(block(3, 5)) != block(6, 3))
+            throw RTE_LOC;
+
+        std::vector<block> x(4), y(20), z(6);
+        bool threw = false;
+        try { CrHash::fixedKey().crHash(x, y); }
+        catch (...) { threw = true; }
+        if (!threw)
+            throw RTE_LOC;
+
+        threw = false;
+        try { TccrHash::fixedKey().hash(x, 0, z); }
+        catch (...) { threw = true; }
+        if (!threw)
+            throw RTE_LOC;
+
+        // a different key gives a different hash.
+        CrHash other(block(1, 2));
+        if (other.crHash(x[0]) == CrHash::fixedKey().crHash(x[0]))
+            throw RTE_LOC;
+    }
+}
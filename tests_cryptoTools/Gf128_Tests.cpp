@@ -0,0 +1,68 @@
+#include "Gf128_Tests.h"
+
+#include <cryptoTools/Common/Gf128.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+    void Gf128_Batch_Test()
+    {
+        PRNG prng(block(4325, 2345));
+
+        // the sizes hit the tails of the 4 and 8 wide kernels, a partial
+        // chunk of the polynomial evaluation and both inversion paths.
+        for (u64 n : { 0, 1, 2, 3, 4, 5, 8, 15, 16, 17, 18, 33, 63, 64, 65, 100, 1000 })
+        {
+            std::vector<block> x(n), y(n), z(n);
+            prng.get(x.data(), n);
+            prng.get(y.data(), n);
+            auto s = prng.get<block>();
+
+            gf128Mul(x, y, z);
+            for (u64 i = 0; i < n; ++i)
+                if (z[i] != x[i].gf128Mul(y[i]))
+                    throw RTE_LOC;
+
+            gf128Mul(x, s, z);
+            for (u64 i = 0; i < n; ++i)
+                if (z[i] != x[i].gf128Mul(s))
+                    throw RTE_LOC;
+
+            block ip = ZeroBlock;
+            for (u64 i = 0; i < n; ++i)
+                ip = ip ^ x[i].gf128Mul(y[i]);
+            if (gf128InnerProduct(x, y) != ip)
+                throw RTE_LOC;
+
+            block p = ZeroBlock;
+            for (u64 i = n; i-- > 0;)
+                p = p.gf128Mul(s) ^ x[i];
+            if (gf128PolyEval(x, s) != p)
+                throw RTE_LOC;
+
+            gf128Inv(x, z);
+            for (u64 i = 0; i < n; ++i)
+                if (z[i].gf128Mul(x[i]) != OneBlock)
+                    throw RTE_LOC;
+        }
+
+        if (gf128Inv(OneBlock) != OneBlock)
+            throw RTE_LOC;
+
+        auto g = prng.get<block>();
+        if (gf128Inv(g).gf128Mul(g) != OneBlock)
+            throw RTE_LOC;
+
+        // zero has no inverse.
+        bool threw = false;
+        std::vector<block> x(100, g), z(100);
+        x[57] = ZeroBlock;
+        try { gf128Inv(x, z); }
+        catch (...) { threw = true; }
+        if (!threw)
+            throw RTE_LOC;
+    }
+}
@@ -0,0 +1,79 @@
+#include "GgmExpander_Tests.h"
+
+#include <cryptoTools/Crypto/GgmExpander.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <algorithm>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+    void GgmExpander_Test()
+    {
+        PRNG prng(block(2342, 5423));
+        GgmExpander ggm;
+
+        // the tree counts hit the gather and row paths of expandLevel and
+        // the depths hit one or more chunks of the depth first expansion.
+        for (u64 numTrees : { 1, 3, 8, 13 })
+        {
+            for (u64 depth : { 0, 1, 5, 11, 14 })
+            {
+                std::vector<block> seeds(numTrees);
+                prng.get(seeds.data(), seeds.size());
+
+                // the reference expansion, one node at a time.
+                std::vector<block> exp(seeds);
+                for (u64 d = 0; d < depth; ++d)
+                {
+                    std::vector<block> next(exp.size() * 2);
+                    for (u64 j = 0; j < (1ull << d); ++j)
+                    {
+                        for (u64 t = 0; t < numTrees; ++t)
+                        {
+                            auto x = exp[j * numTrees + t];
+                            next[(2 * j) * numTrees + t] = ggm.mAes[0].hashBlock(x);
+                            next[(2 * j + 1) * numTrees + t] = ggm.mAes[1].hashBlock(x);
+                        }
+                    }
+                    exp = std::move(next);
+                }
+
+                std::vector<block> leaves(numTrees << depth);
+                ggm.expandLeaves(seeds, depth, leaves);
+                if (leaves != exp)
+                    throw RTE_LOC;
+
+                std::vector<block> tree(((2ull << depth) - 1) * numTrees);
+                ggm.expandTree(seeds, depth, tree);
+                if (!std::equal(exp.begin(), exp.end(), tree.end() - exp.size()))
+                    throw RTE_LOC;
+                if (depth && !std::equal(seeds.begin(), seeds.end(), tree.begin()))
+                    throw RTE_LOC;
+
+                u64 next = 0;
+                ggm.expandStream(seeds, depth, [&](u64 leafIdx, span<const block> chunk) {
+                    if (leafIdx != next || chunk.size() % numTrees)
+                        throw RTE_LOC;
+                    if (!std::equal(chunk.begin(), chunk.end(), exp.begin() + leafIdx * numTrees))
+                        throw RTE_LOC;
+                    next += chunk.size() / numTrees;
+                    });
+                if (next != (1ull << depth))
+                    throw RTE_LOC;
+            }
+        }
+
+        bool threw = false;
+        try {
+            std::vector<block> seeds(2), leaves(7);
+            ggm.expandLeaves(seeds, 2, leaves);
+        }
+        catch (std::runtime_error&) {
+            threw = true;
+        }
+        if (!threw)
+            throw RTE_LOC;
+    }
+}
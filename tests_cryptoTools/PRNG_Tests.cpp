@@ -0,0 +1,196 @@
+#include "PRNG_Tests.h"
+
+#include <cryptoTools/Crypto/PRNG.h>
+#include <cryptoTools/Common/BitVector.h>
+#include <cryptoTools/Common/TestCollection.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace tests_cryptoTools
+{
+    void PRNG_Get_Test()
+    {
+        block seed(234, 6456);
+        AES aes(seed);
+        std::vector<block> stream(4000);
+        aes.ecbEncCounterMode(0, stream);
+        auto streamu8 = (u8*)stream.data();
+
+        // the large requests are written straight to the destination when
+        // it is aligned, check that it lines up with the buffered bytes.
+        std::vector<block> dest(1000);
+        for (u64 misalign : { 0, 1, 8, 15 })
+        {
+            for (u64 prefix : { 0, 5, 16, 4096 })
+            {
+                for (u64 length : { 0, 15, 16, 17, 1000, 4096, 15000 })
+                {
+                    PRNG prng(seed);
+                    std::vector<u8> head(prefix);
+                    prng.get(head.data(), head.size());
+
+                    auto d = (u8*)dest.data() + misalign;
+                    prng.get(d, length);
+                    if (memcmp(d, streamu8 + prefix, length))
+                        throw RTE_LOC;
+
+                    u64 next;
+                    memcpy(&next, streamu8 + prefix + length, sizeof(next));
+                    if (prng.get<u64>() != next)
+                        throw RTE_LOC;
+                }
+            }
+        }
+    }
+
+    void PRNG_Seek_Test()
+    {
+        block seed(3453, 2342);
+        AES aes(seed);
+
+        // the stream is AES_seed(0) || AES_seed(1) || ...
+        u64 n = 1000;
+        std::vector<block> stream(n);
+        aes.ecbEncCounterMode(0, stream);
+        auto streamu8 = (u8*)stream.data();
+
+        PRNG prng(seed, 16);
+        std::vector<u8> bytes(n * sizeof(block));
+        prng.get(bytes.data(), bytes.size());
+        if (memcmp(bytes.data(), streamu8, bytes.size()))
+            throw RTE_LOC;
+
+        prng.seek(5);
+        if (prng.get<block>() != stream[5])
+            throw RTE_LOC;
+
+        // unaligned offsets and lengths that cross the internal chunks.
+        for (u64 offset : { 0, 1, 15, 16, 17, 333, 1024 + 7 })
+        {
+            for (u64 length : { 0, 1, 15, 16, 100, 2000 })
+            {
+                std::vector<u8> dest(length);
+                prng.getAt(offset, span<u8>(dest));
+                if (length && memcmp(dest.data(), streamu8 + offset, length))
+                    throw RTE_LOC;
+            }
+        }
+
+        bool bits[64];
+        prng.getAt(3, span<bool>(bits));
+        for (u64 i = 0; i < 64; ++i)
+            if (bits[i] != (streamu8[3 + i] & 1))
+                throw RTE_LOC;
+
+        // parallelGet must match get(...) for every thread count, including
+        // the output and the state afterwards.
+        u64 length = AES::parallelChunkSize * sizeof(block) * 3 + 5;
+        for (u64 numThreads : { 0, 1, 3 })
+        {
+            for (u64 skip : { 0, 13, 256 })
+            {
+                PRNG p0(seed), p1(seed);
+                std::vector<u8> d0(length), d1(length);
+                for (u64 i = 0; i < skip; ++i)
+                    if (p0.get<u8>() != p1.get<u8>())
+                        throw RTE_LOC;
+
+                p0.get(span<u8>(d0));
+                p1.parallelGet(span<u8>(d1), numThreads);
+                if (d0 != d1)
+                    throw RTE_LOC;
+
+                for (u64 i = 0; i < 100; ++i)
+                    if (p0.get<u32>() != p1.get<u32>())
+                        throw RTE_LOC;
+            }
+        }
+    }
+
+    void PRNG_Sampler_Test()
+    {
+        PRNG prng(block(5434, 2342));
+
+        // a loose chi-squared style check, the counts of n samples over k
+        // buckets should each be within 5 standard deviations.
+        auto checkUniform = [](const std::vector<u64>& counts, u64 n) {
+            double e = double(n) / counts.size();
+            for (auto c : counts)
+                if (std::abs(double(c) - e) > 5 * std::sqrt(e))
+                    throw RTE_LOC;
+        };
+
+        u64 n = 60000;
+        for (u64 bound : { 1, 6, 7, 1000 })
+        {
+            std::vector<u32> d32(n);
+            std::vector<u64> d64(n), counts(bound);
+            prng.getBounded(d32, u32(bound));
+            prng.getBounded(d64, bound);
+            for (u64 i = 0; i < n; ++i)
+            {
+                if (d32[i] >= bound || d64[i] >= bound)
+                    throw RTE_LOC;
+                ++counts[d32[i]];
+            }
+            if (bound < 100)
+                checkUniform(counts, n);
+        }
+
+        // a bound where the rejection is frequent.
+        u64 big = (1ull << 63) + 1;
+        std::vector<u64> d64(1000);
+        prng.getBounded(d64, big);
+        for (auto d : d64)
+            if (d >= big)
+                throw RTE_LOC;
+
+        BitVector bits(1001);
+        prng.getBits(bits);
+        if (std::abs(double(bits.hammingWeight()) - 500) > 5 * std::sqrt(250.0))
+            throw RTE_LOC;
+        if (bits.data()[bits.sizeBytes() - 1] >> 1)
+            throw RTE_LOC;
+
+        n = 100003;
+        for (double p : { 0.0, 1.0, 0.5, 0.25, 1 / 3.0, 0.001, 0.999 })
+        {
+            BitVector b(n);
+            prng.getBernoulli(b, p);
+            double w = double(b.hammingWeight());
+            double sd = std::sqrt(n * p * (1 - p));
+            if (std::abs(w - n * p) > 5 * sd + 1e-9)
+                throw RTE_LOC;
+            if (b.data()[b.sizeBytes() - 1] >> (n % 8))
+                throw RTE_LOC;
+        }
+
+        // each value should be equally likely in each position.
+        u64 size = 5, trials = 50000;
+        std::vector<u64> pos(size * size);
+        std::vector<u32> perm(size);
+        for (u64 t = 0; t < trials; ++t)
+        {
+            std::iota(perm.begin(), perm.end(), 0);
+            prng.shuffle(span<u32>(perm));
+            for (u64 i = 0; i < size; ++i)
+                ++pos[i * size + perm[i]];
+        }
+        checkUniform(pos, trials * size);
+
+        std::vector<u32> large(10000);
+        std::iota(large.begin(), large.end(), 0);
+        prng.shuffle(span<u32>(large));
+        if (std::is_sorted(large.begin(), large.end()))
+            throw RTE_LOC;
+        std::sort(large.begin(), large.end());
+        for (u32 i = 0; i < large.size(); ++i)
+            if (large[i] != i)
+                throw RTE_LOC;
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+// This file and the associated implementation has been placed in the public domain, waiving all copyright. No restrictions are placed on its use. 
+
+namespace tests_cryptoTools
+{
+    void PRNG_Get_Test();
+    void PRNG_Seek_Test();
+    void PRNG_Sampler_Test();
+}
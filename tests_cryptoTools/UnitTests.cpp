@@ -16,6 +16,13 @@
 #include "tests_cryptoTools/Ristretto255_Tests.h"
 #include "tests_cryptoTools/Curve25519Backend_Tests.h"
 #include "tests_cryptoTools/Montgomery25519_Tests.h"
+#include "tests_cryptoTools/CpuDispatch_Tests.h"
+#include "tests_cryptoTools/GgmExpander_Tests.h"
+#include "tests_cryptoTools/CrHash_Tests.h"
+#include "tests_cryptoTools/Commit_Tests.h"
+#include "tests_cryptoTools/PRNG_Tests.h"
+#include "tests_cryptoTools/Gf128_Tests.h"
+#include "tests_cryptoTools/Blake2_Tests.h"
 
 #include <cryptoTools/Common/config.h>
 using namespace osuCrypto;
@@ -50,12 +57,39 @@ namespace tests_cryptoTools
         
         th.add("BtNetwork_oneWorker_Test                ", BtNetwork_oneWorker_Test);
         th.add("BtNetwork_queue_Test                    ", BtNetwork_queue_Test);
+        th.add("BtNetwork_SendCoalescing_Test           ", BtNetwork_SendCoalescing_Test);
+        th.add("BtNetwork_RecvReadAhead_Test            ", BtNetwork_RecvReadAhead_Test);
+        th.add("BtNetwork_ExtendedHeader_Test           ", BtNetwork_ExtendedHeader_Test);
+        th.add("BtNetwork_Stream_Test                   ", BtNetwork_Stream_Test);
+        th.add("BtNetwork_IoUring_Test                  ", BtNetwork_IoUring_Test);
+        th.add("BtNetwork_Shm_Test                      ", BtNetwork_Shm_Test);
+        th.add("BtNetwork_UnixSocket_Test               ", BtNetwork_UnixSocket_Test);
+        th.add("BtNetwork_Multiplex_Test                ", BtNetwork_Multiplex_Test);
+        th.add("BtNetwork_SocketOptions_Test            ", BtNetwork_SocketOptions_Test);
+        th.add("BtNetwork_NetEmu_Test                   ", BtNetwork_NetEmu_Test);
+        th.add("BtNetwork_Telemetry_Test                ", BtNetwork_Telemetry_Test);
+        th.add("BtNetwork_Coroutine_Test                ", BtNetwork_Coroutine_Test);
         th.add("BtNetwork_socketAdapter_test            ", BtNetwork_socketAdapter_test);
         th.add("BtNetwork_BasicSocket_test              ", BtNetwork_BasicSocket_test);
 #endif
 
         th.add("block_operation_test                    ", block_operation_test);
+        th.add("Gf128_Batch_Test                        ", Gf128_Batch_Test);
         th.add("AES                                     ", AES_EncDec_Test);
+        th.add("AES_Dec_Test                            ", AES_Dec_Test);
+        th.add("AES_Parallel_Test                       ", AES_Parallel_Test);
+        th.add("AES_MultiKey_Test                       ", AES_MultiKey_Test);
+        th.add("CpuDispatch_Test                        ", CpuDispatch_Test);
+        th.add("GgmExpander_Test                        ", GgmExpander_Test);
+        th.add("CrHash_Test                             ", CrHash_Test);
+        th.add("PRNG_Get_Test                           ", PRNG_Get_Test);
+        th.add("PRNG_Seek_Test                          ", PRNG_Seek_Test);
+        th.add("PRNG_Sampler_Test                       ", PRNG_Sampler_Test);
+        th.add("Blake2_Batch_Test                       ", Blake2_Batch_Test);
+        th.add("Blake2bp_Test                           ", Blake2bp_Test);
+        th.add("Blake2Xb_Test                           ", Blake2Xb_Test);
+        th.add("CommitBatch_Test                        ", CommitBatch_Test);
+        th.add("MerkleCommit_Test                       ", MerkleCommit_Test);
 #ifdef OC_ENABLE_AESNI
         th.add("Rijndael256                             ", Rijndael256_EncDec_Test);
 #endif // ENABLE_AESNI